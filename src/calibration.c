@@ -0,0 +1,179 @@
+#include <stdlib.h>
+
+#include "vulkan/vulkan.h"
+
+#include "calibration.h"
+#include "device.h"
+#include "stopwatch.h"
+#include "util.h"
+
+/*
+* Calibrations taken per update. The one read back fastest has the smallest
+* deviation and is kept.
+*/
+#define CALIBRATION_SAMPLES 8
+
+/*
+* The domain of the clock behind vkstats_stopwatch_get_ticks().
+*/
+#if defined(_WIN32)
+#define STOPWATCH_TIME_DOMAIN VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_KHR
+#else
+#define STOPWATCH_TIME_DOMAIN VK_TIME_DOMAIN_CLOCK_MONOTONIC_RAW_KHR
+#endif
+
+static VkBool32 has_time_domains(vkstats_physical_device* physical_device, const char* function_name);
+
+void vkstats_calibration_add_extension(vkstats_device_builder* builder)
+{
+    if (!vkstats_device_builder_add_extension(builder, "VK_KHR_calibrated_timestamps"))
+    {
+        vkstats_device_builder_add_extension(builder, "VK_EXT_calibrated_timestamps");
+    }
+}
+
+void vkstats_calibration_init(vkstats_calibration* calibration, vkstats_device* device, uint32_t queue_index)
+{
+    const char* domains_function_name;
+    const char* timestamps_function_name;
+
+    clear_struct(calibration);
+    calibration->device = device;
+    calibration->queue_index = queue_index;
+    calibration->host_domain = STOPWATCH_TIME_DOMAIN;
+
+    /*
+    * The KHR and EXT extensions have the same entry points under different
+    * suffixes.
+    */
+    if (vkstats_device_has_extension(device, "VK_KHR_calibrated_timestamps"))
+    {
+        domains_function_name = "vkGetPhysicalDeviceCalibrateableTimeDomainsKHR";
+        timestamps_function_name = "vkGetCalibratedTimestampsKHR";
+    }
+    else if (vkstats_device_has_extension(device, "VK_EXT_calibrated_timestamps"))
+    {
+        domains_function_name = "vkGetPhysicalDeviceCalibrateableTimeDomainsEXT";
+        timestamps_function_name = "vkGetCalibratedTimestampsEXT";
+    }
+    else
+    {
+        return;
+    }
+
+    if (device->queue_family_properties[queue_index].timestampValidBits == 0
+        || !has_time_domains(device->physical_device, domains_function_name))
+    {
+        return;
+    }
+
+    calibration->get_calibrated_timestamps = (PFN_vkGetCalibratedTimestampsKHR)vkGetDeviceProcAddr(device->device, timestamps_function_name);
+
+    if (calibration->get_calibrated_timestamps == NULL)
+    {
+        return;
+    }
+
+    calibration->supported = VK_TRUE;
+    vkstats_calibration_update(calibration);
+}
+
+void vkstats_calibration_update(vkstats_calibration* calibration)
+{
+    VkResult result;
+    uint64_t timestamps[2];
+    uint64_t deviation;
+
+    VkCalibratedTimestampInfoKHR infos[2] = { 0 };
+    infos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_KHR;
+    infos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_KHR;
+    infos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_KHR;
+    infos[1].timeDomain = calibration->host_domain;
+
+    calibration->max_deviation = UINT64_MAX;
+
+    for (uint32_t i = 0; i < CALIBRATION_SAMPLES; i++)
+    {
+        result = calibration->get_calibrated_timestamps(calibration->device->device, array_length(infos), infos, timestamps, &deviation);
+        check_result(result, "Could not get calibrated timestamps!");
+
+        if (deviation < calibration->max_deviation)
+        {
+            calibration->device_timestamp = timestamps[0];
+            calibration->host_ticks = timestamps[1];
+            calibration->max_deviation = deviation;
+        }
+    }
+}
+
+double vkstats_calibration_get_host_ticks(const vkstats_calibration* calibration, uint64_t device_timestamp)
+{
+    vkstats_device* device = calibration->device;
+    uint32_t valid_bits = device->queue_family_properties[calibration->queue_index].timestampValidBits;
+    uint64_t mask = valid_bits >= 64 ? UINT64_MAX : (UINT64_C(1) << valid_bits) - 1;
+    uint64_t delta = (device_timestamp - calibration->device_timestamp) & mask;
+    double device_ticks = (double)delta;
+
+    /*
+    * Timestamps written before the calibration wrap around to the top of the
+    * valid range.
+    */
+    if (delta > mask / 2)
+    {
+        device_ticks -= (double)mask + 1.0;
+    }
+
+    double nanoseconds = device_ticks * device->physical_device->properties.limits.timestampPeriod;
+
+    return (double)calibration->host_ticks + nanoseconds * vkstats_stopwatch_get_frequency() / 1000000000.0;
+}
+
+/*
+* has_time_domains()
+*
+* Checks whether the device can sample its own timestamps together with the
+* stopwatch's clock.
+*
+* physical_device: the physical device to check.
+* function_name: the name of vkGetPhysicalDeviceCalibrateableTimeDomains for
+*                the enabled extension.
+*
+* Returns VK_TRUE if both time domains are calibrateable.
+*/
+static VkBool32 has_time_domains(vkstats_physical_device* physical_device, const char* function_name)
+{
+    VkResult result;
+    uint32_t domain_count = 0;
+    VkTimeDomainKHR* domains;
+    VkBool32 has_device = VK_FALSE;
+    VkBool32 has_host = VK_FALSE;
+
+    PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsKHR get_time_domains = (PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsKHR)vkGetInstanceProcAddr(physical_device->instance, function_name);
+
+    if (get_time_domains == NULL)
+    {
+        return VK_FALSE;
+    }
+
+    result = get_time_domains(physical_device->physical_device, &domain_count, NULL);
+    check_result(result, "Could not get calibrateable time domains!");
+    domains = malloc(domain_count * sizeof(domains[0]));
+
+    if (domains == NULL)
+    {
+        fatal_error("Could not allocate time domains!");
+    }
+
+    result = get_time_domains(physical_device->physical_device, &domain_count, domains);
+    check_result(result, "Could not get calibrateable time domains!");
+
+    for (uint32_t i = 0; i < domain_count; i++)
+    {
+        has_device |= domains[i] == VK_TIME_DOMAIN_DEVICE_KHR;
+        has_host |= domains[i] == STOPWATCH_TIME_DOMAIN;
+    }
+
+    free(domains);
+
+    return has_device && has_host;
+}
@@ -0,0 +1,70 @@
+#if !defined(VKSTATS_CALIBRATION_H)
+#define VKSTATS_CALIBRATION_H
+
+#include <stdint.h>
+
+#include "vulkan/vulkan.h"
+
+#include "device.h"
+
+typedef struct
+{
+    VkBool32                            supported;
+    vkstats_device*                     device;
+    uint32_t                            queue_index;
+    VkTimeDomainKHR                     host_domain;
+    PFN_vkGetCalibratedTimestampsKHR    get_calibrated_timestamps;
+    uint64_t                            device_timestamp;
+    uint64_t                            host_ticks;
+    uint64_t                            max_deviation;
+} vkstats_calibration;
+
+/*
+* vkstats_calibration_add_extension()
+*
+* Asks a device builder to enable VK_KHR_calibrated_timestamps, or
+* VK_EXT_calibrated_timestamps if only that is available.
+*
+* builder: the builder to add the extension to.
+*/
+void vkstats_calibration_add_extension(vkstats_device_builder* builder);
+
+/*
+* vkstats_calibration_init()
+*
+* Sets up correlation between device timestamps on a queue and stopwatch
+* ticks, and takes a first calibration. Calibration is unsupported if
+* neither calibrated timestamps extension is enabled, the device can't
+* sample the stopwatch's clock, or the queue has no timestamps; check the
+* supported member before using it.
+*
+* calibration: the calibration to initialize.
+* device: the device whose timestamps are correlated.
+* queue_index: the queue the timestamps are written on.
+*/
+void vkstats_calibration_init(vkstats_calibration* calibration, vkstats_device* device, uint32_t queue_index);
+
+/*
+* vkstats_calibration_update()
+*
+* Takes a fresh calibration, to keep clock drift out of long runs. Several
+* samples are taken and the one with the smallest deviation kept.
+*
+* calibration: the calibration to update.
+*/
+void vkstats_calibration_update(vkstats_calibration* calibration);
+
+/*
+* vkstats_calibration_get_host_ticks()
+*
+* Converts a device timestamp to stopwatch ticks.
+*
+* calibration: a supported calibration.
+* device_timestamp: a timestamp written on the calibration's queue.
+*
+* Returns the stopwatch ticks at which the timestamp was written. Ticks are
+* fractional since a device tick may be shorter than a stopwatch tick.
+*/
+double vkstats_calibration_get_host_ticks(const vkstats_calibration* calibration, uint64_t device_timestamp);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include <stddef.h>
+
+#include "vulkan/vulkan.h"
+
+#include "device.h"
+#include "util.h"
+#include "shaders.h"
+#include "compute_kernel.h"
+
+/*
+* The read kernel only stores when the XOR of an element's components equals
+* this. Buffers are zero filled, so it never does, but the compiler can't
+* drop the loads.
+*/
+#define READ_MAGIC 0xFFFFFFFFu
+
+/*
+* Every kernel binds a source and a destination storage buffer.
+*/
+#define KERNEL_BINDING_COUNT 2
+
+typedef struct
+{
+    uint32_t    count;
+    uint32_t    row_length;
+    uint32_t    magic;
+} kernel_parameters;
+
+void vkstats_compute_kernel_create(vkstats_compute_kernel* kernel, vkstats_device* device, vkstats_compute_kernel_type type, uint32_t workgroup_size)
+{
+    VkResult result;
+
+    vkstats_compute_kernel_create_shader(kernel, device, type);
+    kernel->workgroup_size = workgroup_size;
+    kernel->pipeline = vkstats_compute_kernel_create_pipeline(kernel, workgroup_size, VK_NULL_HANDLE);
+
+    VkDescriptorPoolSize pool_size = { 0 };
+    pool_size.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    pool_size.descriptorCount = KERNEL_BINDING_COUNT;
+
+    VkDescriptorPoolCreateInfo dp_ci = { 0 };
+    dp_ci.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    dp_ci.maxSets = 1;
+    dp_ci.pPoolSizes = &pool_size;
+    dp_ci.poolSizeCount = 1;
+    result = vkCreateDescriptorPool(device->device, &dp_ci, NULL, &kernel->descriptor_pool);
+    check_result(result, "Could not create descriptor pool!");
+
+    VkDescriptorSetAllocateInfo ds_ai = { 0 };
+    ds_ai.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    ds_ai.descriptorPool = kernel->descriptor_pool;
+    ds_ai.pSetLayouts = &kernel->set_layout;
+    ds_ai.descriptorSetCount = 1;
+    result = vkAllocateDescriptorSets(device->device, &ds_ai, &kernel->descriptor_set);
+    check_result(result, "Could not allocate descriptor set!");
+}
+
+void vkstats_compute_kernel_create_shader(vkstats_compute_kernel* kernel, vkstats_device* device, vkstats_compute_kernel_type type)
+{
+    VkResult result;
+    const uint32_t* code;
+    size_t code_size;
+
+    clear_struct(kernel);
+    kernel->device = device;
+    kernel->type = type;
+
+    switch (type)
+    {
+    case VKSTATS_COMPUTE_READ:
+        code = vkstats_shader_read;
+        code_size = vkstats_shader_read_size;
+        break;
+    case VKSTATS_COMPUTE_WRITE:
+        code = vkstats_shader_write;
+        code_size = vkstats_shader_write_size;
+        break;
+    case VKSTATS_COMPUTE_COPY:
+        code = vkstats_shader_copy;
+        code_size = vkstats_shader_copy_size;
+        break;
+    case VKSTATS_COMPUTE_READ_MODIFY_WRITE:
+        code = vkstats_shader_read_modify_write;
+        code_size = vkstats_shader_read_modify_write_size;
+        break;
+    default:
+        fatal_error("Unknown compute kernel!");
+        return;
+    }
+
+    VkShaderModuleCreateInfo sm_ci = { 0 };
+    sm_ci.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    sm_ci.pCode = code;
+    sm_ci.codeSize = code_size;
+    result = vkCreateShaderModule(device->device, &sm_ci, NULL, &kernel->shader_module);
+    check_result(result, "Could not create shader module!");
+
+    VkDescriptorSetLayoutBinding bindings[KERNEL_BINDING_COUNT] = { 0 };
+    for (uint32_t i = 0; i < array_length(bindings); i++)
+    {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo dsl_ci = { 0 };
+    dsl_ci.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    dsl_ci.pBindings = bindings;
+    dsl_ci.bindingCount = array_length(bindings);
+    result = vkCreateDescriptorSetLayout(device->device, &dsl_ci, NULL, &kernel->set_layout);
+    check_result(result, "Could not create descriptor set layout!");
+
+    VkPushConstantRange push_constant_range = { 0 };
+    push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    push_constant_range.size = sizeof(kernel_parameters);
+
+    VkPipelineLayoutCreateInfo pl_ci = { 0 };
+    pl_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pl_ci.pSetLayouts = &kernel->set_layout;
+    pl_ci.setLayoutCount = 1;
+    pl_ci.pPushConstantRanges = &push_constant_range;
+    pl_ci.pushConstantRangeCount = 1;
+    result = vkCreatePipelineLayout(device->device, &pl_ci, NULL, &kernel->pipeline_layout);
+    check_result(result, "Could not create pipeline layout!");
+}
+
+VkPipeline vkstats_compute_kernel_create_pipeline(const vkstats_compute_kernel* kernel, uint32_t workgroup_size, VkPipelineCache pipeline_cache)
+{
+    VkResult result;
+    VkPipeline pipeline;
+
+    /*
+    * The workgroup size is specialization constant 0.
+    */
+    VkSpecializationMapEntry specialization_map_entry = { 0 };
+    specialization_map_entry.constantID = 0;
+    specialization_map_entry.size = sizeof(workgroup_size);
+
+    VkSpecializationInfo specialization_info = { 0 };
+    specialization_info.pMapEntries = &specialization_map_entry;
+    specialization_info.mapEntryCount = 1;
+    specialization_info.pData = &workgroup_size;
+    specialization_info.dataSize = sizeof(workgroup_size);
+
+    VkComputePipelineCreateInfo cp_ci = { 0 };
+    cp_ci.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    cp_ci.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    cp_ci.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    cp_ci.stage.module = kernel->shader_module;
+    cp_ci.stage.pName = "main";
+    cp_ci.stage.pSpecializationInfo = &specialization_info;
+    cp_ci.layout = kernel->pipeline_layout;
+    result = vkCreateComputePipelines(kernel->device->device, pipeline_cache, 1, &cp_ci, NULL, &pipeline);
+    check_result(result, "Could not create compute pipeline!");
+
+    return pipeline;
+}
+
+const char* vkstats_compute_kernel_get_name(vkstats_compute_kernel_type type)
+{
+    switch (type)
+    {
+    case VKSTATS_COMPUTE_READ:
+        return "read";
+    case VKSTATS_COMPUTE_WRITE:
+        return "write";
+    case VKSTATS_COMPUTE_COPY:
+        return "copy";
+    case VKSTATS_COMPUTE_READ_MODIFY_WRITE:
+        return "read-modify-write";
+    default:
+        return "unknown";
+    }
+}
+
+void vkstats_compute_kernel_bind(vkstats_compute_kernel* kernel, VkBuffer source, VkBuffer destination, VkDeviceSize size)
+{
+    VkDescriptorBufferInfo buffer_infos[2] = { 0 };
+    buffer_infos[0].buffer = source;
+    buffer_infos[0].range = size;
+    buffer_infos[1].buffer = destination;
+    buffer_infos[1].range = size;
+
+    VkWriteDescriptorSet write = { 0 };
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = kernel->descriptor_set;
+    write.dstBinding = 0;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = buffer_infos;
+    write.descriptorCount = array_length(buffer_infos);
+    vkUpdateDescriptorSets(kernel->device->device, 1, &write, 0, NULL);
+
+    kernel->element_count = (uint32_t)(size / 16);
+}
+
+void vkstats_compute_kernel_dispatch(vkstats_compute_kernel* kernel, VkCommandBuffer command_buffer)
+{
+    const VkPhysicalDeviceLimits* limits = &kernel->device->physical_device->properties.limits;
+    uint32_t group_count = (kernel->element_count + kernel->workgroup_size - 1) / kernel->workgroup_size;
+
+    /*
+    * Wrap the workgroups into rows no longer than the device allows. The last
+    * row may be partially out of range, which the kernel checks for.
+    */
+    uint32_t row_group_count = group_count < limits->maxComputeWorkGroupCount[0] ? group_count : limits->maxComputeWorkGroupCount[0];
+    uint32_t row_count = (group_count + row_group_count - 1) / row_group_count;
+
+    if (row_count > limits->maxComputeWorkGroupCount[1])
+    {
+        fatal_error("Compute dispatch is too large!");
+    }
+
+    kernel_parameters parameters;
+    parameters.count = kernel->element_count;
+    parameters.row_length = row_group_count * kernel->workgroup_size;
+    parameters.magic = READ_MAGIC;
+
+    vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, kernel->pipeline);
+    vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, kernel->pipeline_layout, 0, 1, &kernel->descriptor_set, 0, NULL);
+    vkCmdPushConstants(command_buffer, kernel->pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(parameters), &parameters);
+    vkCmdDispatch(command_buffer, row_group_count, row_count, 1);
+}
+
+void vkstats_compute_kernel_destroy(vkstats_compute_kernel* kernel)
+{
+    VkDevice device = kernel->device->device;
+
+    vkDestroyDescriptorPool(device, kernel->descriptor_pool, NULL);
+    vkDestroyPipeline(device, kernel->pipeline, NULL);
+    vkDestroyPipelineLayout(device, kernel->pipeline_layout, NULL);
+    vkDestroyDescriptorSetLayout(device, kernel->set_layout, NULL);
+    vkDestroyShaderModule(device, kernel->shader_module, NULL);
+}
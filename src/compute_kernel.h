@@ -0,0 +1,121 @@
+#if !defined(VKSTATS_COMPUTE_KERNEL_H)
+#define VKSTATS_COMPUTE_KERNEL_H
+
+#include <stdint.h>
+
+#include "vulkan/vulkan.h"
+
+#include "device.h"
+
+typedef enum
+{
+    VKSTATS_COMPUTE_READ,
+    VKSTATS_COMPUTE_WRITE,
+    VKSTATS_COMPUTE_COPY,
+    VKSTATS_COMPUTE_READ_MODIFY_WRITE,
+    VKSTATS_COMPUTE_KERNEL_COUNT
+} vkstats_compute_kernel_type;
+
+/*
+* A compute pipeline that streams through storage buffers 16 bytes per
+* invocation, with its own descriptor set.
+*/
+typedef struct
+{
+    vkstats_device*             device;
+    vkstats_compute_kernel_type type;
+    uint32_t                    workgroup_size;
+    VkShaderModule              shader_module;
+    VkDescriptorSetLayout       set_layout;
+    VkPipelineLayout            pipeline_layout;
+    VkPipeline                  pipeline;
+    VkDescriptorPool            descriptor_pool;
+    VkDescriptorSet             descriptor_set;
+    uint32_t                    element_count;
+} vkstats_compute_kernel;
+
+/*
+* vkstats_compute_kernel_create()
+*
+* Creates a compute bandwidth kernel.
+*
+* kernel: the kernel to create.
+* device: the device to create the kernel on.
+* type: which kernel to create.
+* workgroup_size: the number of invocations in a workgroup.
+*/
+void vkstats_compute_kernel_create(vkstats_compute_kernel* kernel, vkstats_device* device, vkstats_compute_kernel_type type, uint32_t workgroup_size);
+
+/*
+* vkstats_compute_kernel_create_shader()
+*
+* Creates only the kernel's shader module and layouts, without compiling a
+* pipeline or allocating a descriptor set. Pipelines can then be created with
+* vkstats_compute_kernel_create_pipeline(). Destroy it with
+* vkstats_compute_kernel_destroy().
+*
+* kernel: the kernel to create.
+* device: the device to create the kernel on.
+* type: which kernel to create.
+*/
+void vkstats_compute_kernel_create_shader(vkstats_compute_kernel* kernel, vkstats_device* device, vkstats_compute_kernel_type type);
+
+/*
+* vkstats_compute_kernel_create_pipeline()
+*
+* Creates another pipeline for the kernel's shader and layout. The caller
+* owns the pipeline.
+*
+* kernel: the kernel to create the pipeline for.
+* workgroup_size: the number of invocations in a workgroup.
+* pipeline_cache: the cache to create the pipeline with, or VK_NULL_HANDLE.
+*
+* Returns the pipeline.
+*/
+VkPipeline vkstats_compute_kernel_create_pipeline(const vkstats_compute_kernel* kernel, uint32_t workgroup_size, VkPipelineCache pipeline_cache);
+
+/*
+* vkstats_compute_kernel_get_name()
+*
+* Gets the name of a kernel type.
+*
+* type: the kernel type.
+*
+* Returns the name.
+*/
+const char* vkstats_compute_kernel_get_name(vkstats_compute_kernel_type type);
+
+/*
+* vkstats_compute_kernel_bind()
+*
+* Points the kernel at its buffers. Kernels that only read or only write
+* still need both buffers. Must not be called while a command buffer that
+* dispatches the kernel is pending.
+*
+* kernel: the kernel to bind.
+* source: the buffer to read from.
+* destination: the buffer to write to.
+* size: the number of bytes to process, a multiple of 16.
+*/
+void vkstats_compute_kernel_bind(vkstats_compute_kernel* kernel, VkBuffer source, VkBuffer destination, VkDeviceSize size);
+
+/*
+* vkstats_compute_kernel_dispatch()
+*
+* Records a dispatch of the kernel over its bound buffers.
+*
+* kernel: the kernel to dispatch.
+* command_buffer: the command buffer to record into.
+*/
+void vkstats_compute_kernel_dispatch(vkstats_compute_kernel* kernel, VkCommandBuffer command_buffer);
+
+/*
+* vkstats_compute_kernel_destroy()
+*
+* Destroys a compute bandwidth kernel.
+*
+* kernel: the kernel to destroy.
+*/
+void vkstats_compute_kernel_destroy(vkstats_compute_kernel* kernel);
+
+#endif
\ No newline at end of file
@@ -1,10 +1,14 @@
 #if !defined(VKSTATS_CONFIG_H)
 #define VKSTATS_CONFIG_H
 
-#define MAX_INSTANCE_LAYER_PROPERTIES 13
-#define MAX_PHYSICAL_DEVICES 2
-#define MAX_QUEUE_FAMILIES 10
-#define MAX_QUEUES 2
+#define MAX_QUEUES 3
 #define MAX_POOLS MAX_QUEUES
+#define MAX_TRIALS 1000
+#define MAX_METRICS 8
+#define MAX_IN_FLIGHT 8
+#define MAX_THREADS 16
+#define MAX_DEVICE_EXTENSIONS 8
+#define MAX_TRACE_EVENTS (256 * 1024)
+#define MAX_PROCESS_ARGUMENTS 8
 
 #endif
@@ -0,0 +1,194 @@
+#include <string.h>
+
+#include "copy_kernels.h"
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define VKSTATS_X64
+#include <immintrin.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+static void copy_memcpy(void* destination, const void* source, size_t size);
+
+#if defined(VKSTATS_X64)
+static void copy_stream_sse2(void* destination, const void* source, size_t size);
+static TARGET_AVX2 void copy_stream_avx2(void* destination, const void* source, size_t size);
+static int cpu_supports_avx2(void);
+#endif
+
+uint32_t vkstats_get_copy_kernels(vkstats_copy_kernel* kernels)
+{
+    uint32_t count = 0;
+
+    kernels[count].name = "memcpy";
+    kernels[count].function = copy_memcpy;
+    count++;
+
+#if defined(VKSTATS_X64)
+    /*
+    * SSE2 is part of x86-64, so only AVX2 needs checking.
+    */
+    kernels[count].name = "SSE2 stream";
+    kernels[count].function = copy_stream_sse2;
+    count++;
+
+    if (cpu_supports_avx2())
+    {
+        kernels[count].name = "AVX2 stream";
+        kernels[count].function = copy_stream_avx2;
+        count++;
+    }
+#endif
+
+    return count;
+}
+
+/*
+* copy_memcpy()
+*
+* Copies with the C library's memcpy.
+*
+* destination: where to copy to.
+* source: where to copy from.
+* size: the number of bytes to copy.
+*/
+static void copy_memcpy(void* destination, const void* source, size_t size)
+{
+    memcpy(destination, source, size);
+}
+
+#if defined(VKSTATS_X64)
+
+/*
+* copy_stream_sse2()
+*
+* Copies with 16-byte non-temporal stores, which bypass the cache and fill
+* write-combining buffers in whole lines. The unaligned head and tail are
+* copied with memcpy.
+*
+* destination: where to copy to.
+* source: where to copy from.
+* size: the number of bytes to copy.
+*/
+static void copy_stream_sse2(void* destination, const void* source, size_t size)
+{
+    uint8_t* d = destination;
+    const uint8_t* s = source;
+    size_t head = (16 - ((uintptr_t)d & 15)) & 15;
+
+    if (head > size)
+    {
+        head = size;
+    }
+
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    size -= head;
+
+    while (size >= 64)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*)(s + 0));
+        __m128i b = _mm_loadu_si128((const __m128i*)(s + 16));
+        __m128i c = _mm_loadu_si128((const __m128i*)(s + 32));
+        __m128i e = _mm_loadu_si128((const __m128i*)(s + 48));
+        _mm_stream_si128((__m128i*)(d + 0), a);
+        _mm_stream_si128((__m128i*)(d + 16), b);
+        _mm_stream_si128((__m128i*)(d + 32), c);
+        _mm_stream_si128((__m128i*)(d + 48), e);
+        d += 64;
+        s += 64;
+        size -= 64;
+    }
+
+    _mm_sfence();
+    memcpy(d, s, size);
+}
+
+/*
+* copy_stream_avx2()
+*
+* Copies with 32-byte non-temporal stores. The unaligned head and tail are
+* copied with memcpy.
+*
+* destination: where to copy to.
+* source: where to copy from.
+* size: the number of bytes to copy.
+*/
+static TARGET_AVX2 void copy_stream_avx2(void* destination, const void* source, size_t size)
+{
+    uint8_t* d = destination;
+    const uint8_t* s = source;
+    size_t head = (32 - ((uintptr_t)d & 31)) & 31;
+
+    if (head > size)
+    {
+        head = size;
+    }
+
+    memcpy(d, s, head);
+    d += head;
+    s += head;
+    size -= head;
+
+    while (size >= 128)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*)(s + 0));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(s + 32));
+        __m256i c = _mm256_loadu_si256((const __m256i*)(s + 64));
+        __m256i e = _mm256_loadu_si256((const __m256i*)(s + 96));
+        _mm256_stream_si256((__m256i*)(d + 0), a);
+        _mm256_stream_si256((__m256i*)(d + 32), b);
+        _mm256_stream_si256((__m256i*)(d + 64), c);
+        _mm256_stream_si256((__m256i*)(d + 96), e);
+        d += 128;
+        s += 128;
+        size -= 128;
+    }
+
+    _mm_sfence();
+    memcpy(d, s, size);
+}
+
+/*
+* cpu_supports_avx2()
+*
+* Checks that the CPU has AVX2 and that the OS saves the YMM registers.
+*
+* Returns non-zero if AVX2 can be used.
+*/
+static int cpu_supports_avx2(void)
+{
+#if defined(_MSC_VER)
+    int info[4];
+
+    __cpuid(info, 1);
+
+    /*
+    * OSXSAVE and AVX, then check the OS enabled XMM and YMM state.
+    */
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+    {
+        return 0;
+    }
+
+    if ((_xgetbv(0) & 6) != 6)
+    {
+        return 0;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif
@@ -0,0 +1,38 @@
+#if !defined(VKSTATS_COPY_KERNELS_H)
+#define VKSTATS_COPY_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define MAX_COPY_KERNELS 3
+
+/*
+* vkstats_copy_kernel_function
+*
+* Copies memory. The regions must not overlap.
+*
+* destination: where to copy to.
+* source: where to copy from.
+* size: the number of bytes to copy.
+*/
+typedef void (*vkstats_copy_kernel_function)(void* destination, const void* source, size_t size);
+
+typedef struct
+{
+    const char*                     name;
+    vkstats_copy_kernel_function    function;
+} vkstats_copy_kernel;
+
+/*
+* vkstats_get_copy_kernels()
+*
+* Gets the copy kernels the CPU supports. Plain memcpy is always first; the
+* non-temporal streaming kernels follow, from least to most capable.
+*
+* kernels: an array of MAX_COPY_KERNELS that the kernels will be placed in.
+*
+* Returns the number of kernels.
+*/
+uint32_t vkstats_get_copy_kernels(vkstats_copy_kernel* kernels);
+
+#endif
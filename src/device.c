@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 
 #include "vulkan/vulkan.h"
 
@@ -6,6 +7,8 @@
 #include "device.h"
 #include "util.h"
 #include "physical_device.h"
+#include "stopwatch.h"
+#include "trace.h"
 
 void vkstats_device_builder_init(vkstats_device_builder* builder, vkstats_physical_device* physical_device)
 {
@@ -26,25 +29,46 @@ void vkstats_device_builder_add_queue(vkstats_device_builder* builder, VkQueueFl
     }
 }
 
+VkBool32 vkstats_device_builder_add_extension(vkstats_device_builder* builder, const char* extension_name)
+{
+    if (!vkstats_physical_device_has_extension(builder->physical_device, extension_name))
+    {
+        return VK_FALSE;
+    }
+
+    if (builder->extension_count < array_length(builder->extensions))
+    {
+        builder->extensions[builder->extension_count] = extension_name;
+        builder->extension_count++;
+    }
+    else
+    {
+        fatal_error("Maximum device extensions is too small!");
+    }
+
+    return VK_TRUE;
+}
+
 void vkstats_device_builder_build(vkstats_device_builder* builder, vkstats_device* device)
 {
     VkResult result;
-    const float queue_priority = 0.0f;
+    const float queue_priorities[MAX_QUEUES] = { 0.0f };
     uint32_t queue_family_property_count = 1;
-    VkQueueFamilyProperties queue_family_properties[MAX_QUEUE_FAMILIES];
+    VkQueueFamilyProperties* queue_family_properties;
     VkDeviceQueueCreateInfo queue_create_infos[MAX_QUEUES] = { 0 };
+    uint32_t queue_create_info_count = 0;
+    uint32_t queue_indices[MAX_QUEUES];
 
     vkGetPhysicalDeviceQueueFamilyProperties(builder->physical_device->physical_device, &queue_family_property_count, NULL);
+    queue_family_properties = malloc(queue_family_property_count * sizeof(queue_family_properties[0]));
 
-    if (queue_family_property_count > MAX_QUEUE_FAMILIES)
+    if (queue_family_properties == NULL)
     {
-        fatal_error("Max queue families is too small!");
+        fatal_error("Could not allocate queue family properties!");
     }
 
     vkGetPhysicalDeviceQueueFamilyProperties(builder->physical_device->physical_device, &queue_family_property_count, queue_family_properties);
 
-    queue_create_infos[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-
     for (uint32_t i = 0; i < builder->queue_count; i++)
     {
         uint32_t best_queue_family_index = UINT_MAX;
@@ -72,52 +96,121 @@ void vkstats_device_builder_build(vkstats_device_builder* builder, vkstats_devic
             fatal_error("Could not create required queues!");
         }
 
-        queue_create_infos[i].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queue_create_infos[i].queueFamilyIndex = best_queue_family_index;
-        queue_create_infos[i].queueCount = 1;
-        queue_create_infos[i].pQueuePriorities = &queue_priority;
-        
-        if(best_queue_family_index < array_length(queue_family_properties))
+        /*
+        * A queue family may only appear once in the create infos, so queues
+        * that land on the same family share one. When the family runs out of
+        * queues (lavapipe only exposes one), the extra requests alias the
+        * last queue created in it.
+        */
+        uint32_t create_info_index;
+
+        for (create_info_index = 0; create_info_index < queue_create_info_count; create_info_index++)
         {
+            if (queue_create_infos[create_info_index].queueFamilyIndex == best_queue_family_index)
+            {
+                break;
+            }
+        }
+
+        if (create_info_index == queue_create_info_count)
+        {
+            queue_create_infos[create_info_index].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            queue_create_infos[create_info_index].queueFamilyIndex = best_queue_family_index;
+            queue_create_infos[create_info_index].queueCount = 0;
+            queue_create_infos[create_info_index].pQueuePriorities = queue_priorities;
+            queue_create_info_count++;
+        }
+
+        if(best_queue_family_index < queue_family_property_count)
+        {
+            if (queue_create_infos[create_info_index].queueCount < queue_family_properties[best_queue_family_index].queueCount)
+            {
+                queue_create_infos[create_info_index].queueCount++;
+            }
+
             device->queue_flags[i] = queue_family_properties[best_queue_family_index].queueFlags;
+            device->queue_family_properties[i] = queue_family_properties[best_queue_family_index];
         }
+
+        device->queue_family_indices[i] = best_queue_family_index;
+        queue_indices[i] = queue_create_infos[create_info_index].queueCount - 1;
+    }
+
+    free(queue_family_properties);
+
+    /*
+    * Synchronization2 is only enabled where the device supports it, and the
+    * experiments that use vkQueueSubmit2 check for it.
+    */
+    VkPhysicalDeviceVulkan13Features supported_vulkan13_features = { 0 };
+    supported_vulkan13_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+    if (builder->physical_device->properties.apiVersion >= VK_API_VERSION_1_3)
+    {
+        VkPhysicalDeviceFeatures2 supported_features = { 0 };
+        supported_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supported_features.pNext = &supported_vulkan13_features;
+        vkGetPhysicalDeviceFeatures2(builder->physical_device->physical_device, &supported_features);
     }
 
+    device->synchronization2 = supported_vulkan13_features.synchronization2;
+
+    VkPhysicalDeviceVulkan13Features vulkan13_features = { 0 };
+    vulkan13_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    vulkan13_features.synchronization2 = device->synchronization2;
+
     VkPhysicalDeviceVulkan12Features physical_device_features = { 0 };
     physical_device_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
     physical_device_features.timelineSemaphore = VK_TRUE;
+    physical_device_features.pNext = device->synchronization2 ? &vulkan13_features : NULL;
 
     VkDeviceCreateInfo create_info = { 0 };
     create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
     create_info.pNext = &physical_device_features;
     create_info.pQueueCreateInfos = queue_create_infos;
-    create_info.queueCreateInfoCount = builder->queue_count;
+    create_info.queueCreateInfoCount = queue_create_info_count;
+    create_info.ppEnabledExtensionNames = builder->extensions;
+    create_info.enabledExtensionCount = builder->extension_count;
 
+    double frequency = vkstats_stopwatch_get_frequency();
+    uint64_t start_ticks = vkstats_stopwatch_get_ticks();
     result = vkCreateDevice(builder->physical_device->physical_device, &create_info, NULL, &device->device);
+    uint64_t end_ticks = vkstats_stopwatch_get_ticks();
     check_result(result, "Could not create device!");
 
+    device->create_time = (double)(end_ticks - start_ticks) / frequency * 1000.0;
+    vkstats_trace_host_event("startup", "vkCreateDevice", start_ticks, end_ticks, builder->extension_count);
+
+    device->physical_device = builder->physical_device;
     device->queue_count = builder->queue_count;
+    device->extension_count = builder->extension_count;
 
-    for (uint32_t i = 0; i < builder->queue_count; i++)
+    for (uint32_t i = 0; i < builder->extension_count; i++)
     {
-        vkGetDeviceQueue(device->device, queue_create_infos[i].queueFamilyIndex, 0, &device->queues[i]);
+        device->extensions[i] = builder->extensions[i];
     }
 
     for (uint32_t i = 0; i < builder->queue_count; i++)
     {
-        device->queue_family_indices[i] = queue_create_infos[i].queueFamilyIndex;
+        vkGetDeviceQueue(device->device, device->queue_family_indices[i], queue_indices[i], &device->queues[i]);
     }
 
     VkCommandPoolCreateInfo command_pool_ci = { 0 };
     command_pool_ci.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    start_ticks = vkstats_stopwatch_get_ticks();
+
     for (uint32_t i = 0; i < builder->queue_count; i++)
     {
-        command_pool_ci.queueFamilyIndex = queue_create_infos[i].queueFamilyIndex;
+        command_pool_ci.queueFamilyIndex = device->queue_family_indices[i];
         command_pool_ci.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
         result = vkCreateCommandPool(device->device, &command_pool_ci, NULL, &device->command_pools[i]);
         check_result(result, "Failed to create command pool!");
     }
 
+    end_ticks = vkstats_stopwatch_get_ticks();
+    device->command_pool_time = (double)(end_ticks - start_ticks) / frequency * 1000.0;
+    vkstats_trace_host_event("startup", "Command pools", start_ticks, end_ticks, builder->queue_count);
+
     device->device_local_memory_index = UINT_MAX;
     device->host_visible_memory_index = UINT_MAX;
 
@@ -138,6 +231,28 @@ void vkstats_device_builder_build(vkstats_device_builder* builder, vkstats_devic
         }
     }
 
+    /*
+    * Unified memory devices (lavapipe, most integrated GPUs) have no memory
+    * type that is only device local or only host visible, so fall back to the
+    * first type that provides the required flags.
+    */
+    for (uint32_t i = 0; i < builder->physical_device->memory_properties.memoryTypeCount; i++)
+    {
+        VkMemoryPropertyFlags flags = builder->physical_device->memory_properties.memoryTypes[i].propertyFlags;
+
+        if (device->device_local_memory_index == UINT_MAX && (flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+        {
+            device->device_local_memory_index = i;
+        }
+
+        if (device->host_visible_memory_index == UINT_MAX
+            && (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+            && (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+        {
+            device->host_visible_memory_index = i;
+        }
+    }
+
     if (device->device_local_memory_index == UINT_MAX || device->host_visible_memory_index == UINT_MAX)
     {
         fatal_error("Could not find necessary memory types!");
@@ -154,3 +269,102 @@ void vkstats_device_destroy(vkstats_device* device)
 
     vkDestroyDevice(device->device, NULL);
 }
+
+VkBool32 vkstats_device_has_extension(vkstats_device* device, const char* extension_name)
+{
+    for (uint32_t i = 0; i < device->extension_count; i++)
+    {
+        if (strcmp(extension_name, device->extensions[i]) == 0)
+        {
+            return VK_TRUE;
+        }
+    }
+
+    return VK_FALSE;
+}
+
+VkSemaphore vkstats_device_create_timeline_semaphore(vkstats_device* device)
+{
+    VkResult result;
+    VkSemaphore semaphore;
+
+    VkSemaphoreTypeCreateInfo st_ci = { 0 };
+    st_ci.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    st_ci.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+
+    VkSemaphoreCreateInfo s_ci = { 0 };
+    s_ci.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    s_ci.pNext = &st_ci;
+    result = vkCreateSemaphore(device->device, &s_ci, NULL, &semaphore);
+    check_result(result, "Could not create semaphore!");
+
+    return semaphore;
+}
+
+void vkstats_device_wait_semaphore(vkstats_device* device, VkSemaphore semaphore, uint64_t value)
+{
+    VkResult result;
+
+    VkSemaphoreWaitInfo s_wi = { 0 };
+    s_wi.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    s_wi.pSemaphores = &semaphore;
+    s_wi.pValues = &value;
+    s_wi.semaphoreCount = 1;
+
+    uint64_t start_ticks = vkstats_stopwatch_get_ticks();
+    result = vkWaitSemaphores(device->device, &s_wi, UINT64_MAX);
+    vkstats_trace_host_event("wait", "vkWaitSemaphores", start_ticks, vkstats_stopwatch_get_ticks(), value);
+    check_result(result, "Could not wait for semaphore!");
+}
+
+void vkstats_device_submit(vkstats_device* device, uint32_t queue_index, const VkSubmitInfo* submit_info, uint64_t value)
+{
+    VkResult result;
+
+    uint64_t start_ticks = vkstats_stopwatch_get_ticks();
+    result = vkQueueSubmit(device->queues[queue_index], 1, submit_info, VK_NULL_HANDLE);
+    vkstats_trace_host_event("submit", "vkQueueSubmit", start_ticks, vkstats_stopwatch_get_ticks(), value);
+    check_result(result, "Could not submit queue!");
+}
+
+VkCommandBuffer vkstats_device_allocate_command_buffer(vkstats_device* device, uint32_t queue_index)
+{
+    VkResult result;
+    VkCommandBuffer command_buffer;
+
+    VkCommandBufferAllocateInfo cb_ci = { 0 };
+    cb_ci.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cb_ci.commandBufferCount = 1;
+    cb_ci.commandPool = device->command_pools[queue_index];
+    result = vkAllocateCommandBuffers(device->device, &cb_ci, &command_buffer);
+    check_result(result, "Could not allocate command buffer!");
+
+    return command_buffer;
+}
+
+VkBuffer vkstats_device_create_buffer(vkstats_device* device, VkDeviceSize size, VkBufferUsageFlags usage, uint32_t queue_index)
+{
+    VkResult result;
+    VkBuffer buffer;
+
+    VkBufferCreateInfo b_ci = { 0 };
+    b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    b_ci.usage = usage;
+    b_ci.pQueueFamilyIndices = &device->queue_family_indices[queue_index];
+    b_ci.queueFamilyIndexCount = 1;
+    b_ci.size = size;
+    b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    result = vkCreateBuffer(device->device, &b_ci, NULL, &buffer);
+    check_result(result, "Could not create buffer!");
+
+    return buffer;
+}
+
+double vkstats_device_get_timestamp_elapsed(vkstats_device* device, uint32_t queue_index, const uint64_t timestamps[2])
+{
+    uint32_t valid_bits = device->queue_family_properties[queue_index].timestampValidBits;
+    uint64_t mask = valid_bits >= 64 ? UINT64_MAX : (UINT64_C(1) << valid_bits) - 1;
+    uint64_t ticks = (timestamps[1] - timestamps[0]) & mask;
+
+    return (double)ticks * device->physical_device->properties.limits.timestampPeriod / 1000000.0;
+}
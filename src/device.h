@@ -8,16 +8,27 @@
 #include "config.h"
 #include "physical_device.h"
 
+/*
+* The times record how long each phase of building the device took, in
+* milliseconds.
+*/
 typedef struct
 {
-    VkDevice        device;
-    VkQueue         queues[MAX_QUEUES];
-    uint32_t        queue_count;
-    VkQueueFlags    queue_flags[MAX_QUEUES];
-    uint32_t        queue_family_indices[MAX_QUEUES];
-    VkCommandPool   command_pools[MAX_POOLS];
-    uint32_t        device_local_memory_index;
-    uint32_t        host_visible_memory_index;
+    VkDevice                    device;
+    vkstats_physical_device*    physical_device;
+    VkQueue                     queues[MAX_QUEUES];
+    uint32_t                    queue_count;
+    VkQueueFlags                queue_flags[MAX_QUEUES];
+    uint32_t                    queue_family_indices[MAX_QUEUES];
+    VkQueueFamilyProperties     queue_family_properties[MAX_QUEUES];
+    VkCommandPool               command_pools[MAX_POOLS];
+    uint32_t                    device_local_memory_index;
+    uint32_t                    host_visible_memory_index;
+    VkBool32                    synchronization2;
+    const char*                 extensions[MAX_DEVICE_EXTENSIONS];
+    uint32_t                    extension_count;
+    double                      create_time;
+    double                      command_pool_time;
 } vkstats_device;
 
 typedef struct
@@ -26,6 +37,8 @@ typedef struct
     vkstats_physical_device*    physical_device;
     VkQueueFlags                queues[MAX_QUEUES];
     uint32_t                    queue_count;
+    const char*                 extensions[MAX_DEVICE_EXTENSIONS];
+    uint32_t                    extension_count;
 } vkstats_device_builder;
 
 /*
@@ -50,6 +63,19 @@ void vkstats_device_builder_init(vkstats_device_builder* builder, vkstats_physic
 */
 void vkstats_device_builder_add_queue(vkstats_device_builder* builder, VkQueueFlags flags);
 
+/*
+* vkstats_device_builder_add_extension()
+*
+* Adds a device extension to be enabled, if the physical device supports it.
+*
+* builder: the builder to add an extension to.
+* extension_name: the extension to enable. Must be a string literal or
+*                 otherwise outlive the device.
+*
+* Returns VK_TRUE if the extension is supported and will be enabled.
+*/
+VkBool32 vkstats_device_builder_add_extension(vkstats_device_builder* builder, const char* extension_name);
+
 /*
 * vkstats_device_builder_build()
 * 
@@ -60,6 +86,94 @@ void vkstats_device_builder_add_queue(vkstats_device_builder* builder, VkQueueFl
 */
 void vkstats_device_builder_build(vkstats_device_builder* builder, vkstats_device* device);
 
+/*
+* vkstats_device_has_extension()
+*
+* Checks whether a device extension was enabled on the device.
+*
+* device: the device to check.
+* extension_name: the extension to check for.
+*
+* Returns VK_TRUE if the extension is enabled.
+*/
+VkBool32 vkstats_device_has_extension(vkstats_device* device, const char* extension_name);
+
+/*
+* vkstats_device_create_timeline_semaphore()
+*
+* Creates a timeline semaphore with an initial value of zero.
+*
+* device: the device to create the semaphore on.
+*
+* Returns the semaphore.
+*/
+VkSemaphore vkstats_device_create_timeline_semaphore(vkstats_device* device);
+
+/*
+* vkstats_device_wait_semaphore()
+*
+* Blocks until a timeline semaphore reaches a value.
+*
+* device: the device that owns the semaphore.
+* semaphore: the timeline semaphore to wait on.
+* value: the value to wait for.
+*/
+void vkstats_device_wait_semaphore(vkstats_device* device, VkSemaphore semaphore, uint64_t value);
+
+/*
+* vkstats_device_submit()
+*
+* Submits a batch to a queue with no fence, and records the submit on the
+* trace. Aborts the application if the submit fails.
+*
+* device: the device that owns the queue.
+* queue_index: the index of the queue to submit to.
+* submit_info: the batch to submit.
+* value: a number to attach to the trace event, such as a size in bytes.
+*/
+void vkstats_device_submit(vkstats_device* device, uint32_t queue_index, const VkSubmitInfo* submit_info, uint64_t value);
+
+/*
+* vkstats_device_allocate_command_buffer()
+*
+* Allocates a primary command buffer from a queue's command pool.
+*
+* device: the device to allocate from.
+* queue_index: the index of the queue whose pool to allocate from.
+*
+* Returns the command buffer.
+*/
+VkCommandBuffer vkstats_device_allocate_command_buffer(vkstats_device* device, uint32_t queue_index);
+
+/*
+* vkstats_device_create_buffer()
+*
+* Creates a buffer owned exclusively by a queue's family. No memory is bound.
+*
+* device: the device to create the buffer on.
+* size: the size of the buffer.
+* usage: the buffer usage flags.
+* queue_index: the index of the queue that will use the buffer.
+*
+* Returns the buffer.
+*/
+VkBuffer vkstats_device_create_buffer(vkstats_device* device, VkDeviceSize size, VkBufferUsageFlags usage, uint32_t queue_index);
+
+/*
+* vkstats_device_get_timestamp_elapsed()
+*
+* Converts a pair of device timestamps to elapsed time. Only the low
+* timestampValidBits of each timestamp are meaningful, so the difference is
+* masked to handle wraparound.
+*
+* device: the device the timestamps were written on.
+* queue_index: the index of the queue the timestamps were written on.
+* timestamps: the start and end timestamps, in ticks.
+*
+* Returns the elapsed time in milliseconds.
+*/
+double vkstats_device_get_timestamp_elapsed(vkstats_device* device, uint32_t queue_index, const uint64_t timestamps[2]);
+
 /*
 * vkstats_device_destroy()
 * 
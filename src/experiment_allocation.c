@@ -0,0 +1,405 @@
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "vulkan/vulkan.h"
+
+#include "config.h"
+#include "device.h"
+#include "util.h"
+#include "stopwatch.h"
+#include "harness.h"
+#include "thread.h"
+#include "trace.h"
+#include "experiments.h"
+
+#define MIN_ALLOCATION_SIZE (UINT64_C(4) * UINT64_C(1024))
+#define THREADED_ALLOCATION_SIZE (UINT64_C(64) * UINT64_C(1024))
+#define ALLOCATIONS_PER_THREAD 64
+
+/*
+* Memory property flags this experiment knows how to allocate from.
+*/
+#define ALLOCATION_MEMORY_FLAGS (VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT)
+
+#define ALLOCATION_BUFFER_USAGE (VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT)
+
+typedef enum
+{
+    STEP_CREATE_BUFFER,
+    STEP_GET_REQUIREMENTS,
+    STEP_ALLOCATE,
+    STEP_BIND,
+    STEP_DESTROY_BUFFER,
+    STEP_FREE,
+    STEP_COUNT
+} allocation_step;
+
+static const char* step_names[STEP_COUNT] =
+{
+    "vkCreateBuffer",
+    "vkGetBufferMemoryRequirements",
+    "vkAllocateMemory",
+    "vkBindBufferMemory",
+    "vkDestroyBuffer",
+    "vkFreeMemory",
+};
+
+typedef struct
+{
+    vkstats_device*     device;
+    uint32_t            queue_index;
+    uint32_t            memory_type_index;
+    VkDeviceSize        size;
+} allocation_trial;
+
+typedef struct
+{
+    vkstats_device*     device;
+    uint32_t            memory_type_index;
+    vkstats_barrier*    barrier;
+    uint64_t            start_ticks;
+    uint64_t            end_ticks;
+    vkstats_thread      thread;
+} allocation_worker;
+
+typedef struct
+{
+    vkstats_device*     device;
+    uint32_t            memory_type_index;
+    uint32_t            thread_count;
+    allocation_worker   workers[MAX_THREADS];
+} threaded_allocation_trial;
+
+static VkBool32 try_allocation(vkstats_device* device, uint32_t queue_index, uint32_t memory_type_index, VkDeviceSize size);
+static void run_allocation_trial(void* context, double* results);
+static void run_threaded_allocation_trial(void* context, double* results);
+static void run_allocation_worker(void* context);
+
+void vkstats_experiment_allocation_latency(vkstats_device* device, uint32_t queue_index, vkstats_harness* harness)
+{
+    VkPhysicalDeviceMemoryProperties* memory_properties = &device->physical_device->memory_properties;
+    VkMemoryRequirements requirements;
+    vkstats_statistics statistics[STEP_COUNT];
+    uint32_t max_thread_count;
+    char label[96];
+
+    printf("\n");
+    printf("Running allocation latency experiment.\n");
+    vkstats_harness_begin_experiment(harness, "allocation_latency", device, queue_index);
+    printf("Largest allocation: %" PRIu64 " bytes\n", device->physical_device->max_memory_allocation_size);
+
+    /*
+    * Find out which memory types buffers can live in.
+    */
+    VkBuffer buffer = vkstats_device_create_buffer(device, MIN_ALLOCATION_SIZE, ALLOCATION_BUFFER_USAGE, queue_index);
+    vkGetBufferMemoryRequirements(device->device, buffer, &requirements);
+    vkDestroyBuffer(device->device, buffer, NULL);
+
+    allocation_trial trial;
+    trial.device = device;
+    trial.queue_index = queue_index;
+
+    for (uint32_t i = 0; i < memory_properties->memoryTypeCount; i++)
+    {
+        VkMemoryType* memory_type = &memory_properties->memoryTypes[i];
+
+        if (!(requirements.memoryTypeBits & (1u << i))
+            || (memory_type->propertyFlags & ~ALLOCATION_MEMORY_FLAGS)
+            || memory_type->propertyFlags == 0)
+        {
+            continue;
+        }
+
+        /*
+        * Stop at the largest allocation the device allows, or half the heap,
+        * whichever is smaller, so there's room left for everything else.
+        */
+        VkDeviceSize max_size = memory_properties->memoryHeaps[memory_type->heapIndex].size / 2;
+
+        if (device->physical_device->max_memory_allocation_size < max_size)
+        {
+            max_size = device->physical_device->max_memory_allocation_size;
+        }
+
+        printf("\n");
+        printf("Memory type %u (heap %u, flags 0x%x), median us (p99 us):\n", i, memory_type->heapIndex, memory_type->propertyFlags);
+        printf("%14s %12s %12s %20s %12s %12s %12s\n", "Size", "Create", "Requirements", "Allocate", "Bind", "Destroy", "Free");
+
+        vkstats_harness_set_memory_types(harness, i, VKSTATS_NO_MEMORY_TYPE);
+        trial.memory_type_index = i;
+
+        for (VkDeviceSize size = MIN_ALLOCATION_SIZE; size <= max_size; size *= 4)
+        {
+            /*
+            * The heap may be too fragmented or in use by others to hand out
+            * the size, and that ends the sweep for this type.
+            */
+            if (!try_allocation(device, queue_index, i, size))
+            {
+                printf("%14" PRIu64 " could not be allocated, stopping.\n", size);
+                break;
+            }
+
+            trial.size = size;
+            vkstats_harness_run(harness, run_allocation_trial, &trial, STEP_COUNT, statistics);
+
+            for (uint32_t j = 0; j < STEP_COUNT; j++)
+            {
+                snprintf(label, sizeof(label), "%s, type %u, %" PRIu64 " bytes", step_names[j], i, size);
+                vkstats_harness_record(harness, label, &statistics[j], size);
+            }
+
+            printf("%14" PRIu64 " %12.2f %12.2f %9.2f (%8.2f) %12.2f %12.2f %12.2f\n",
+                size,
+                statistics[STEP_CREATE_BUFFER].median * 1000.0,
+                statistics[STEP_GET_REQUIREMENTS].median * 1000.0,
+                statistics[STEP_ALLOCATE].median * 1000.0,
+                statistics[STEP_ALLOCATE].p99 * 1000.0,
+                statistics[STEP_BIND].median * 1000.0,
+                statistics[STEP_DESTROY_BUFFER].median * 1000.0,
+                statistics[STEP_FREE].median * 1000.0);
+        }
+    }
+
+    /*
+    * Many threads allocating at once. If the driver takes a global lock, the
+    * wall time grows with the thread count instead of staying flat.
+    */
+    max_thread_count = vkstats_get_cpu_count();
+
+    if (max_thread_count > MAX_THREADS)
+    {
+        max_thread_count = MAX_THREADS;
+    }
+
+    threaded_allocation_trial threaded_trial;
+    clear_struct(&threaded_trial);
+    threaded_trial.device = device;
+    threaded_trial.memory_type_index = device->device_local_memory_index;
+
+    vkstats_harness_set_memory_types(harness, device->device_local_memory_index, VKSTATS_NO_MEMORY_TYPE);
+
+    printf("\n");
+    printf("Concurrent allocate/free of %" PRIu64 " bytes, %u per thread:\n", THREADED_ALLOCATION_SIZE, ALLOCATIONS_PER_THREAD);
+    printf("%8s %12s %16s %10s\n", "Threads", "Median ms", "Allocations/s", "Scaling");
+
+    double single_rate = 0.0;
+
+    for (uint32_t thread_count = 1; thread_count <= max_thread_count; thread_count *= 2)
+    {
+        vkstats_statistics threaded_statistics;
+
+        threaded_trial.thread_count = thread_count;
+        vkstats_harness_run(harness, run_threaded_allocation_trial, &threaded_trial, 1, &threaded_statistics);
+
+        snprintf(label, sizeof(label), "Allocate/free x%u, %u threads", ALLOCATIONS_PER_THREAD, thread_count);
+        vkstats_harness_record(harness, label, &threaded_statistics, THREADED_ALLOCATION_SIZE);
+
+        double rate = (double)thread_count * ALLOCATIONS_PER_THREAD / (threaded_statistics.median / 1000.0);
+
+        if (thread_count == 1)
+        {
+            single_rate = rate;
+        }
+
+        printf("%8u %12.3f %16.0f %9.2fx\n", thread_count, threaded_statistics.median, rate, rate / single_rate);
+    }
+}
+
+/*
+* try_allocation()
+*
+* Checks whether a buffer of the given size can be created and backed by the
+* memory type right now.
+*
+* device: the device to allocate from.
+* queue_index: the queue the buffer is created for.
+* memory_type_index: the memory type to allocate from.
+* size: the size to allocate.
+*
+* Returns VK_TRUE if the allocation succeeded.
+*/
+static VkBool32 try_allocation(vkstats_device* device, uint32_t queue_index, uint32_t memory_type_index, VkDeviceSize size)
+{
+    VkResult result;
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    VkMemoryRequirements requirements;
+
+    VkBufferCreateInfo b_ci = { 0 };
+    b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    b_ci.usage = ALLOCATION_BUFFER_USAGE;
+    b_ci.pQueueFamilyIndices = &device->queue_family_indices[queue_index];
+    b_ci.queueFamilyIndexCount = 1;
+    b_ci.size = size;
+    b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    result = vkCreateBuffer(device->device, &b_ci, NULL, &buffer);
+
+    if (result != VK_SUCCESS)
+    {
+        return VK_FALSE;
+    }
+
+    vkGetBufferMemoryRequirements(device->device, buffer, &requirements);
+
+    VkMemoryAllocateInfo m_ai = { 0 };
+    m_ai.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    m_ai.allocationSize = requirements.size;
+    m_ai.memoryTypeIndex = memory_type_index;
+    result = vkAllocateMemory(device->device, &m_ai, NULL, &memory);
+
+    if (result == VK_SUCCESS)
+    {
+        vkFreeMemory(device->device, memory, NULL);
+    }
+
+    vkDestroyBuffer(device->device, buffer, NULL);
+
+    return result == VK_SUCCESS;
+}
+
+/*
+* run_allocation_trial()
+*
+* Creates a buffer, allocates memory for it and binds it, then tears it all
+* down again, timing each call on its own.
+*
+* context: an allocation_trial.
+* results: the time of each call, indexed by allocation_step.
+*/
+static void run_allocation_trial(void* context, double* results)
+{
+    VkResult result;
+    allocation_trial* trial = context;
+    vkstats_device* device = trial->device;
+    double frequency = vkstats_stopwatch_get_frequency();
+    uint64_t ticks[STEP_COUNT + 1];
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    VkMemoryRequirements requirements;
+
+    VkBufferCreateInfo b_ci = { 0 };
+    b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    b_ci.usage = ALLOCATION_BUFFER_USAGE;
+    b_ci.pQueueFamilyIndices = &device->queue_family_indices[trial->queue_index];
+    b_ci.queueFamilyIndexCount = 1;
+    b_ci.size = trial->size;
+    b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkMemoryAllocateInfo m_ai = { 0 };
+    m_ai.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    m_ai.memoryTypeIndex = trial->memory_type_index;
+
+    ticks[STEP_CREATE_BUFFER] = vkstats_stopwatch_get_ticks();
+    result = vkCreateBuffer(device->device, &b_ci, NULL, &buffer);
+    ticks[STEP_GET_REQUIREMENTS] = vkstats_stopwatch_get_ticks();
+    check_result(result, "Could not create buffer!");
+
+    vkGetBufferMemoryRequirements(device->device, buffer, &requirements);
+    ticks[STEP_ALLOCATE] = vkstats_stopwatch_get_ticks();
+
+    m_ai.allocationSize = requirements.size;
+    result = vkAllocateMemory(device->device, &m_ai, NULL, &memory);
+    ticks[STEP_BIND] = vkstats_stopwatch_get_ticks();
+    check_result(result, "Could not allocate memory!");
+
+    result = vkBindBufferMemory(device->device, buffer, memory, 0);
+    ticks[STEP_DESTROY_BUFFER] = vkstats_stopwatch_get_ticks();
+    check_result(result, "Could not bind buffer memory!");
+
+    vkDestroyBuffer(device->device, buffer, NULL);
+    ticks[STEP_FREE] = vkstats_stopwatch_get_ticks();
+
+    vkFreeMemory(device->device, memory, NULL);
+    ticks[STEP_COUNT] = vkstats_stopwatch_get_ticks();
+
+    for (uint32_t i = 0; i < STEP_COUNT; i++)
+    {
+        results[i] = (double)(ticks[i + 1] - ticks[i]) / frequency * 1000.0;
+        vkstats_trace_host_event("allocation", step_names[i], ticks[i], ticks[i + 1], trial->size);
+    }
+}
+
+/*
+* run_threaded_allocation_trial()
+*
+* Starts the threads, lets them all allocate at once, and measures from when
+* the first one started until the last one finished.
+*
+* context: a threaded_allocation_trial.
+* results: the wall time.
+*/
+static void run_threaded_allocation_trial(void* context, double* results)
+{
+    threaded_allocation_trial* trial = context;
+    vkstats_barrier barrier;
+    uint64_t start_ticks = UINT64_MAX;
+    uint64_t end_ticks = 0;
+
+    vkstats_barrier_init(&barrier, trial->thread_count);
+
+    for (uint32_t i = 0; i < trial->thread_count; i++)
+    {
+        allocation_worker* worker = &trial->workers[i];
+
+        worker->device = trial->device;
+        worker->memory_type_index = trial->memory_type_index;
+        worker->barrier = &barrier;
+        vkstats_thread_create(&worker->thread, run_allocation_worker, worker);
+    }
+
+    for (uint32_t i = 0; i < trial->thread_count; i++)
+    {
+        allocation_worker* worker = &trial->workers[i];
+
+        vkstats_thread_join(&worker->thread);
+
+        if (worker->start_ticks < start_ticks)
+        {
+            start_ticks = worker->start_ticks;
+        }
+
+        if (worker->end_ticks > end_ticks)
+        {
+            end_ticks = worker->end_ticks;
+        }
+    }
+
+    vkstats_barrier_destroy(&barrier);
+
+    results[0] = (double)(end_ticks - start_ticks) / vkstats_stopwatch_get_frequency() * 1000.0;
+}
+
+/*
+* run_allocation_worker()
+*
+* Host thread that allocates and frees memory ALLOCATIONS_PER_THREAD times,
+* once every thread is ready.
+*
+* context: an allocation_worker.
+*/
+static void run_allocation_worker(void* context)
+{
+    VkResult result;
+    allocation_worker* worker = context;
+    VkDeviceMemory memory;
+
+    VkMemoryAllocateInfo m_ai = { 0 };
+    m_ai.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    m_ai.allocationSize = THREADED_ALLOCATION_SIZE;
+    m_ai.memoryTypeIndex = worker->memory_type_index;
+
+    vkstats_barrier_wait(worker->barrier);
+    worker->start_ticks = vkstats_stopwatch_get_ticks();
+
+    for (uint32_t i = 0; i < ALLOCATIONS_PER_THREAD; i++)
+    {
+        uint64_t start_ticks = vkstats_stopwatch_get_ticks();
+        result = vkAllocateMemory(worker->device->device, &m_ai, NULL, &memory);
+        vkstats_trace_host_event("allocation", "vkAllocateMemory", start_ticks, vkstats_stopwatch_get_ticks(), THREADED_ALLOCATION_SIZE);
+        check_result(result, "Could not allocate memory!");
+        vkFreeMemory(worker->device->device, memory, NULL);
+    }
+
+    worker->end_ticks = vkstats_stopwatch_get_ticks();
+}
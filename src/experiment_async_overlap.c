@@ -0,0 +1,428 @@
+#include <math.h>
+#include <stdio.h>
+
+#include "vulkan/vulkan.h"
+
+#include "config.h"
+#include "device.h"
+#include "util.h"
+#include "stopwatch.h"
+#include "harness.h"
+#include "memory_arena.h"
+#include "compute_kernel.h"
+#include "trace.h"
+#include "experiments.h"
+
+#define OVERLAP_BUFFER_SIZE (UINT64_C(64) * UINT64_C(1024) * UINT64_C(1024))
+#define OVERLAP_WORKGROUP_SIZE 64
+
+/*
+* Each side repeats its work until it runs for about this long on its own, so
+* the two sides are balanced and the overlap has room to show.
+*/
+#define OVERLAP_TARGET_TIME 20.0
+#define MAX_OVERLAP_REPEATS 256
+
+typedef enum
+{
+    SIDE_COMPUTE,
+    SIDE_TRANSFER,
+    SIDE_COUNT
+} overlap_side;
+
+static const char* side_names[SIDE_COUNT] =
+{
+    "Compute side",
+    "Transfer side",
+};
+
+typedef struct
+{
+    uint32_t                queue_index;
+    VkPipelineStageFlags    wait_stage;
+    VkCommandBuffer         command_buffer;
+    uint32_t                repeat_count;
+    VkSemaphore             done_semaphore;
+    uint64_t                done_value;
+    VkBool32                active;
+} overlap_queue;
+
+typedef struct
+{
+    vkstats_device*         device;
+    vkstats_compute_kernel  kernel;
+    VkBuffer                transfer_source;
+    VkBuffer                transfer_destination;
+    overlap_queue           queues[SIDE_COUNT];
+    VkSemaphore             start_semaphore;
+    uint64_t                start_value;
+} overlap_trial;
+
+static void record_side(overlap_trial* trial, overlap_side side);
+static void calibrate_side(overlap_trial* trial, overlap_side side);
+static void run_overlap_trial(void* context, double* results);
+
+void vkstats_experiment_async_overlap(vkstats_device* device, uint32_t compute_queue_index, uint32_t transfer_queue_index, vkstats_harness* harness)
+{
+    vkstats_statistics statistics[SIDE_COUNT + 1][SIDE_COUNT + 1];
+    uint64_t bytes[SIDE_COUNT];
+    char label[96];
+
+    printf("\n");
+    printf("Running async overlap experiment, compute on queue %u (family %u), transfer on queue %u (family %u).\n",
+        compute_queue_index, device->queue_family_indices[compute_queue_index],
+        transfer_queue_index, device->queue_family_indices[transfer_queue_index]);
+    vkstats_harness_begin_experiment(harness, "async_overlap", device, compute_queue_index);
+    vkstats_harness_set_memory_types(harness, device->host_visible_memory_index, device->device_local_memory_index);
+
+    if (!(device->queue_flags[compute_queue_index] & VK_QUEUE_COMPUTE_BIT))
+    {
+        printf("Queue does not support compute, skipping.\n");
+        return;
+    }
+
+    /*
+    * Work on one VkQueue runs in submission order, so there is nothing to
+    * overlap when both sides land on the same queue.
+    */
+    if (device->queues[compute_queue_index] == device->queues[transfer_queue_index])
+    {
+        printf("Queues %u and %u are the same queue, skipping.\n", compute_queue_index, transfer_queue_index);
+        return;
+    }
+
+    overlap_trial trial;
+    clear_struct(&trial);
+    trial.device = device;
+    trial.start_semaphore = vkstats_device_create_timeline_semaphore(device);
+    trial.queues[SIDE_COMPUTE].queue_index = compute_queue_index;
+    trial.queues[SIDE_COMPUTE].wait_stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    trial.queues[SIDE_TRANSFER].queue_index = transfer_queue_index;
+    trial.queues[SIDE_TRANSFER].wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+
+    /*
+    * The compute side streams between two device-local buffers; the transfer
+    * side uploads from host-visible memory, like a background streaming
+    * upload would.
+    */
+    vkstats_memory_arena arena;
+    vkstats_memory_arena_init(&arena, device);
+
+    VkBufferCreateInfo b_ci = { 0 };
+    b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    b_ci.pQueueFamilyIndices = &device->queue_family_indices[compute_queue_index];
+    b_ci.queueFamilyIndexCount = 1;
+    b_ci.size = OVERLAP_BUFFER_SIZE;
+    b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    b_ci.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    vkstats_memory_arena_reserve(&arena, &b_ci, device->device_local_memory_index);
+    vkstats_memory_arena_reserve(&arena, &b_ci, device->device_local_memory_index);
+    b_ci.pQueueFamilyIndices = &device->queue_family_indices[transfer_queue_index];
+    b_ci.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    vkstats_memory_arena_reserve(&arena, &b_ci, device->host_visible_memory_index);
+    b_ci.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    vkstats_memory_arena_reserve(&arena, &b_ci, device->device_local_memory_index);
+    vkstats_memory_arena_allocate(&arena);
+
+    VkBuffer compute_source = vkstats_device_create_buffer(device, OVERLAP_BUFFER_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, compute_queue_index);
+    VkBuffer compute_destination = vkstats_device_create_buffer(device, OVERLAP_BUFFER_SIZE, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, compute_queue_index);
+    trial.transfer_source = vkstats_device_create_buffer(device, OVERLAP_BUFFER_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, transfer_queue_index);
+    trial.transfer_destination = vkstats_device_create_buffer(device, OVERLAP_BUFFER_SIZE, VK_BUFFER_USAGE_TRANSFER_DST_BIT, transfer_queue_index);
+    vkstats_memory_arena_bind_buffer(&arena, compute_source, device->device_local_memory_index);
+    vkstats_memory_arena_bind_buffer(&arena, compute_destination, device->device_local_memory_index);
+    vkstats_memory_arena_bind_buffer(&arena, trial.transfer_source, device->host_visible_memory_index);
+    vkstats_memory_arena_bind_buffer(&arena, trial.transfer_destination, device->device_local_memory_index);
+
+    vkstats_compute_kernel_create(&trial.kernel, device, VKSTATS_COMPUTE_COPY, OVERLAP_WORKGROUP_SIZE);
+    vkstats_compute_kernel_bind(&trial.kernel, compute_source, compute_destination, OVERLAP_BUFFER_SIZE);
+
+    for (uint32_t i = 0; i < SIDE_COUNT; i++)
+    {
+        overlap_queue* queue = &trial.queues[i];
+
+        queue->command_buffer = vkstats_device_allocate_command_buffer(device, queue->queue_index);
+        queue->done_semaphore = vkstats_device_create_timeline_semaphore(device);
+        calibrate_side(&trial, (overlap_side)i);
+        bytes[i] = OVERLAP_BUFFER_SIZE * trial.queues[i].repeat_count;
+    }
+
+    printf("Compute runs %u copy dispatches, transfer runs %u copies, of %u MiB each.\n",
+        trial.queues[SIDE_COMPUTE].repeat_count, trial.queues[SIDE_TRANSFER].repeat_count, (uint32_t)(OVERLAP_BUFFER_SIZE / (1024 * 1024)));
+
+    /*
+    * Each side alone, then both released by the same host signal. Metric 0 is
+    * the time until the last side finished, the others the time each side
+    * took, all measured on the host from the release.
+    */
+    for (uint32_t i = 0; i <= SIDE_COUNT; i++)
+    {
+        trial.queues[SIDE_COMPUTE].active = i == SIDE_COMPUTE || i == SIDE_COUNT;
+        trial.queues[SIDE_TRANSFER].active = i == SIDE_TRANSFER || i == SIDE_COUNT;
+        vkstats_harness_run(harness, run_overlap_trial, &trial, SIDE_COUNT + 1, statistics[i]);
+    }
+
+    snprintf(label, sizeof(label), "Compute alone, queue %u", compute_queue_index);
+    vkstats_harness_report_bandwidth(harness, label, &statistics[SIDE_COMPUTE][SIDE_COMPUTE + 1], bytes[SIDE_COMPUTE]);
+    snprintf(label, sizeof(label), "Transfer alone, queue %u", transfer_queue_index);
+    vkstats_harness_report_bandwidth(harness, label, &statistics[SIDE_TRANSFER][SIDE_TRANSFER + 1], bytes[SIDE_TRANSFER]);
+    snprintf(label, sizeof(label), "Compute with transfer, queue %u", compute_queue_index);
+    vkstats_harness_report_bandwidth(harness, label, &statistics[SIDE_COUNT][SIDE_COMPUTE + 1], bytes[SIDE_COMPUTE]);
+    snprintf(label, sizeof(label), "Transfer with compute, queue %u", transfer_queue_index);
+    vkstats_harness_report_bandwidth(harness, label, &statistics[SIDE_COUNT][SIDE_TRANSFER + 1], bytes[SIDE_TRANSFER]);
+    snprintf(label, sizeof(label), "Together, queues %u and %u", compute_queue_index, transfer_queue_index);
+    vkstats_harness_report_bandwidth(harness, label, &statistics[SIDE_COUNT][0], bytes[SIDE_COMPUTE] + bytes[SIDE_TRANSFER]);
+
+    /*
+    * With perfect overlap the pair takes as long as the longer side alone;
+    * fully serialized, it takes the sum. Efficiency is the share of the
+    * shorter side that was hidden, so 1 is perfect overlap and 0 is none.
+    */
+    double compute_time = statistics[SIDE_COMPUTE][SIDE_COMPUTE + 1].median;
+    double transfer_time = statistics[SIDE_TRANSFER][SIDE_TRANSFER + 1].median;
+    double together_time = statistics[SIDE_COUNT][0].median;
+    double hideable_time = compute_time < transfer_time ? compute_time : transfer_time;
+
+    printf("Overlap efficiency: %.2f (serial %.3f ms, ideal %.3f ms, together %.3f ms)\n",
+        (compute_time + transfer_time - together_time) / hideable_time,
+        compute_time + transfer_time,
+        compute_time + transfer_time - hideable_time,
+        together_time);
+    printf("Compute slowdown: %.2fx, transfer slowdown: %.2fx\n",
+        statistics[SIDE_COUNT][SIDE_COMPUTE + 1].median / compute_time,
+        statistics[SIDE_COUNT][SIDE_TRANSFER + 1].median / transfer_time);
+
+    for (uint32_t i = 0; i < SIDE_COUNT; i++)
+    {
+        overlap_queue* queue = &trial.queues[i];
+
+        vkFreeCommandBuffers(device->device, device->command_pools[queue->queue_index], 1, &queue->command_buffer);
+        vkDestroySemaphore(device->device, queue->done_semaphore, NULL);
+    }
+
+    vkstats_compute_kernel_destroy(&trial.kernel);
+    vkDestroyBuffer(device->device, compute_source, NULL);
+    vkDestroyBuffer(device->device, compute_destination, NULL);
+    vkDestroyBuffer(device->device, trial.transfer_source, NULL);
+    vkDestroyBuffer(device->device, trial.transfer_destination, NULL);
+    vkstats_memory_arena_destroy(&arena);
+    vkDestroySemaphore(device->device, trial.start_semaphore, NULL);
+}
+
+/*
+* record_side()
+*
+* Records one side's command buffer: repeat_count copy dispatches for compute,
+* or repeat_count buffer copies for transfer. Repeats are separated by
+* barriers, since they all write the same buffer.
+*
+* trial: the trial to record for.
+* side: the side to record.
+*/
+static void record_side(overlap_trial* trial, overlap_side side)
+{
+    overlap_queue* queue = &trial->queues[side];
+
+    VkCommandBufferBeginInfo cb_bi = { 0 };
+    cb_bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    VkMemoryBarrier memory_barrier = { 0 };
+    memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+
+    VkBufferCopy buffer_copy = { 0 };
+    buffer_copy.size = OVERLAP_BUFFER_SIZE;
+
+    vkResetCommandBuffer(queue->command_buffer, 0);
+    vkBeginCommandBuffer(queue->command_buffer, &cb_bi);
+
+    for (uint32_t i = 0; i < queue->repeat_count; i++)
+    {
+        if (side == SIDE_COMPUTE)
+        {
+            if (i > 0)
+            {
+                memory_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                memory_barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                vkCmdPipelineBarrier(queue->command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &memory_barrier, 0, NULL, 0, NULL);
+            }
+
+            vkstats_compute_kernel_dispatch(&trial->kernel, queue->command_buffer);
+        }
+        else
+        {
+            if (i > 0)
+            {
+                memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                vkCmdPipelineBarrier(queue->command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &memory_barrier, 0, NULL, 0, NULL);
+            }
+
+            vkCmdCopyBuffer(queue->command_buffer, trial->transfer_source, trial->transfer_destination, 1, &buffer_copy);
+        }
+    }
+
+    vkEndCommandBuffer(queue->command_buffer);
+}
+
+/*
+* calibrate_side()
+*
+* Times one repeat of a side on its own, then records it with enough repeats
+* to run for about OVERLAP_TARGET_TIME.
+*
+* trial: the trial to calibrate.
+* side: the side to calibrate.
+*/
+static void calibrate_side(overlap_trial* trial, overlap_side side)
+{
+    overlap_queue* queue = &trial->queues[side];
+    double results[SIDE_COUNT + 1];
+
+    for (uint32_t i = 0; i < SIDE_COUNT; i++)
+    {
+        trial->queues[i].active = i == (uint32_t)side;
+    }
+
+    queue->repeat_count = 1;
+    record_side(trial, side);
+
+    /*
+    * The first run pays for paging the buffers in, so only the second is
+    * used.
+    */
+    run_overlap_trial(trial, results);
+    run_overlap_trial(trial, results);
+
+    double repeat_count = ceil(OVERLAP_TARGET_TIME / results[side + 1]);
+    queue->repeat_count = repeat_count > MAX_OVERLAP_REPEATS ? MAX_OVERLAP_REPEATS : (uint32_t)repeat_count;
+    record_side(trial, side);
+}
+
+/*
+* run_overlap_trial()
+*
+* Submits every active side behind a shared start semaphore, releases them
+* all with one host signal, and records when each finishes.
+*
+* context: an overlap_trial.
+* results: the time until the last active side finished, followed by the
+*          time each side took. Inactive sides report zero.
+*/
+static void run_overlap_trial(void* context, double* results)
+{
+    VkResult result;
+    overlap_trial* trial = context;
+    vkstats_device* device = trial->device;
+    double frequency = vkstats_stopwatch_get_frequency();
+    VkSemaphore pending_semaphores[SIDE_COUNT];
+    uint64_t pending_values[SIDE_COUNT];
+    VkBool32 finished[SIDE_COUNT];
+
+    vkDeviceWaitIdle(device->device);
+    trial->start_value++;
+
+    for (uint32_t i = 0; i < SIDE_COUNT; i++)
+    {
+        overlap_queue* queue = &trial->queues[i];
+
+        results[i + 1] = 0.0;
+        finished[i] = !queue->active;
+
+        if (!queue->active)
+        {
+            continue;
+        }
+
+        queue->done_value++;
+
+        VkTimelineSemaphoreSubmitInfo ts_si = { 0 };
+        ts_si.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        ts_si.pWaitSemaphoreValues = &trial->start_value;
+        ts_si.waitSemaphoreValueCount = 1;
+        ts_si.pSignalSemaphoreValues = &queue->done_value;
+        ts_si.signalSemaphoreValueCount = 1;
+
+        VkSubmitInfo si = { 0 };
+        si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        si.pNext = &ts_si;
+        si.pCommandBuffers = &queue->command_buffer;
+        si.commandBufferCount = 1;
+        si.pWaitSemaphores = &trial->start_semaphore;
+        si.waitSemaphoreCount = 1;
+        si.pSignalSemaphores = &queue->done_semaphore;
+        si.signalSemaphoreCount = 1;
+        si.pWaitDstStageMask = &queue->wait_stage;
+
+        uint64_t submit_ticks = vkstats_stopwatch_get_ticks();
+        result = vkQueueSubmit(device->queues[queue->queue_index], 1, &si, VK_NULL_HANDLE);
+        vkstats_trace_host_event("submit", "vkQueueSubmit", submit_ticks, vkstats_stopwatch_get_ticks(), queue->repeat_count);
+        check_result(result, "Could not submit queue!");
+    }
+
+    VkSemaphoreSignalInfo s_si = { 0 };
+    s_si.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+    s_si.value = trial->start_value;
+    s_si.semaphore = trial->start_semaphore;
+
+    uint64_t start_ticks = vkstats_stopwatch_get_ticks();
+    result = vkSignalSemaphore(device->device, &s_si);
+    check_result(result, "Could not signal semaphore!");
+
+    /*
+    * Wait for whichever side finishes first, so each side's time is taken as
+    * soon as it completes rather than after the other.
+    */
+    for (;;)
+    {
+        uint32_t pending_count = 0;
+
+        for (uint32_t i = 0; i < SIDE_COUNT; i++)
+        {
+            if (!finished[i])
+            {
+                pending_semaphores[pending_count] = trial->queues[i].done_semaphore;
+                pending_values[pending_count] = trial->queues[i].done_value;
+                pending_count++;
+            }
+        }
+
+        if (pending_count == 0)
+        {
+            break;
+        }
+
+        VkSemaphoreWaitInfo s_wi = { 0 };
+        s_wi.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        s_wi.flags = VK_SEMAPHORE_WAIT_ANY_BIT;
+        s_wi.pSemaphores = pending_semaphores;
+        s_wi.pValues = pending_values;
+        s_wi.semaphoreCount = pending_count;
+
+        result = vkWaitSemaphores(device->device, &s_wi, UINT64_MAX);
+        check_result(result, "Could not wait for semaphores!");
+
+        uint64_t end_ticks = vkstats_stopwatch_get_ticks();
+
+        for (uint32_t i = 0; i < SIDE_COUNT; i++)
+        {
+            overlap_queue* queue = &trial->queues[i];
+            uint64_t value;
+
+            if (finished[i])
+            {
+                continue;
+            }
+
+            result = vkGetSemaphoreCounterValue(device->device, queue->done_semaphore, &value);
+            check_result(result, "Could not get semaphore value!");
+
+            if (value >= queue->done_value)
+            {
+                results[i + 1] = (double)(end_ticks - start_ticks) / frequency * 1000.0;
+                finished[i] = VK_TRUE;
+                vkstats_trace_host_event("wait", side_names[i], start_ticks, end_ticks, queue->repeat_count);
+            }
+        }
+    }
+
+    results[0] = results[SIDE_COMPUTE + 1] > results[SIDE_TRANSFER + 1] ? results[SIDE_COMPUTE + 1] : results[SIDE_TRANSFER + 1];
+}
@@ -0,0 +1,441 @@
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "vulkan/vulkan.h"
+
+#include "config.h"
+#include "device.h"
+#include "util.h"
+#include "stopwatch.h"
+#include "harness.h"
+#include "memory_arena.h"
+#include "compute_kernel.h"
+#include "thread.h"
+#include "trace.h"
+#include "experiments.h"
+
+/*
+* Each cycle is a copy, a barrier, a dispatch and another barrier. The
+* dispatch is four commands itself: bind pipeline, bind descriptor sets,
+* push constants and dispatch. The cycles are split evenly between the
+* threads.
+*/
+#define RECORDING_CYCLES 4096
+#define COMMANDS_PER_CYCLE 7
+#define RECORDING_BUFFER_SIZE 4096
+#define RECORDING_COPY_SIZE 256
+#define RECORDING_WORKGROUP_SIZE 64
+
+typedef enum
+{
+    MODE_PRIMARY,
+    MODE_SECONDARY,
+    MODE_RESET_POOL,
+    MODE_RESUBMIT,
+    MODE_COUNT
+} recording_mode;
+
+static const char* mode_names[MODE_COUNT] =
+{
+    "Primary",
+    "Secondary",
+    "Reset pool",
+    "Resubmit",
+};
+
+struct recording_trial;
+
+typedef struct
+{
+    struct recording_trial* trial;
+    VkCommandPool           command_pool;
+    VkCommandPool           transient_pool;
+    VkCommandBuffer         primary;
+    VkCommandBuffer         secondary;
+    VkCommandBuffer         transient;
+    VkCommandBuffer         prerecorded;
+    vkstats_barrier*        barrier;
+    uint64_t                start_ticks;
+    uint64_t                end_ticks;
+    vkstats_thread          thread;
+} recording_worker;
+
+typedef struct recording_trial
+{
+    vkstats_device*         device;
+    uint32_t                queue_index;
+    recording_mode          mode;
+    uint32_t                thread_count;
+    uint32_t                cycle_count;
+    VkBuffer                buffers[3];
+    vkstats_compute_kernel  kernel;
+    VkCommandBuffer         command_buffer;
+    VkSemaphore             semaphore;
+    uint64_t                semaphore_value;
+    recording_worker        workers[MAX_THREADS];
+} recording_trial;
+
+static void record_cycles(recording_trial* trial, VkCommandBuffer command_buffer, uint32_t cycle_count);
+static void run_recording_trial(void* context, double* results);
+static void run_recording_worker(void* context);
+
+void vkstats_experiment_command_recording(vkstats_device* device, uint32_t queue_index, vkstats_harness* harness)
+{
+    VkResult result;
+    char label[64];
+
+    printf("\n");
+    printf("Running command recording experiment on queue %u (family %u).\n", queue_index, device->queue_family_indices[queue_index]);
+    vkstats_harness_begin_experiment(harness, "command_recording", device, queue_index);
+    vkstats_harness_set_memory_types(harness, device->device_local_memory_index, device->device_local_memory_index);
+
+    if (!(device->queue_flags[queue_index] & VK_QUEUE_COMPUTE_BIT))
+    {
+        printf("Queue can't dispatch, skipping.\n");
+        return;
+    }
+
+    uint32_t max_thread_count = vkstats_get_cpu_count();
+
+    if (max_thread_count > MAX_THREADS)
+    {
+        max_thread_count = MAX_THREADS;
+    }
+
+    recording_trial trial;
+    clear_struct(&trial);
+    trial.device = device;
+    trial.queue_index = queue_index;
+    trial.command_buffer = vkstats_device_allocate_command_buffer(device, queue_index);
+    trial.semaphore = vkstats_device_create_timeline_semaphore(device);
+
+    /*
+    * The commands only touch a few small buffers, so recording rather than
+    * execution dominates.
+    */
+    vkstats_memory_arena arena;
+    vkstats_memory_arena_init(&arena, device);
+
+    VkBufferCreateInfo b_ci = { 0 };
+    b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    b_ci.pQueueFamilyIndices = &device->queue_family_indices[queue_index];
+    b_ci.queueFamilyIndexCount = 1;
+    b_ci.size = RECORDING_BUFFER_SIZE;
+    b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    b_ci.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+    for (uint32_t i = 0; i < array_length(trial.buffers); i++)
+    {
+        vkstats_memory_arena_reserve(&arena, &b_ci, device->device_local_memory_index);
+    }
+
+    vkstats_memory_arena_allocate(&arena);
+
+    for (uint32_t i = 0; i < array_length(trial.buffers); i++)
+    {
+        trial.buffers[i] = vkstats_device_create_buffer(device, RECORDING_BUFFER_SIZE, b_ci.usage, queue_index);
+        vkstats_memory_arena_bind_buffer(&arena, trial.buffers[i], device->device_local_memory_index);
+    }
+
+    vkstats_compute_kernel_create(&trial.kernel, device, VKSTATS_COMPUTE_COPY, RECORDING_WORKGROUP_SIZE);
+    vkstats_compute_kernel_bind(&trial.kernel, trial.buffers[1], trial.buffers[2], RECORDING_BUFFER_SIZE);
+
+    /*
+    * Every thread gets a pool whose buffers are reset one at a time, and a
+    * transient pool that's only ever reset as a whole.
+    */
+    VkCommandPoolCreateInfo cp_ci = { 0 };
+    cp_ci.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    cp_ci.queueFamilyIndex = device->queue_family_indices[queue_index];
+
+    VkCommandBufferAllocateInfo cb_ai = { 0 };
+    cb_ai.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cb_ai.commandBufferCount = 1;
+
+    for (uint32_t i = 0; i < max_thread_count; i++)
+    {
+        recording_worker* worker = &trial.workers[i];
+
+        worker->trial = &trial;
+
+        cp_ci.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        result = vkCreateCommandPool(device->device, &cp_ci, NULL, &worker->command_pool);
+        check_result(result, "Could not create command pool!");
+
+        cp_ci.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        result = vkCreateCommandPool(device->device, &cp_ci, NULL, &worker->transient_pool);
+        check_result(result, "Could not create command pool!");
+
+        cb_ai.commandPool = worker->command_pool;
+        cb_ai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        result = vkAllocateCommandBuffers(device->device, &cb_ai, &worker->primary);
+        check_result(result, "Could not allocate command buffers!");
+        result = vkAllocateCommandBuffers(device->device, &cb_ai, &worker->prerecorded);
+        check_result(result, "Could not allocate command buffers!");
+
+        cb_ai.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        result = vkAllocateCommandBuffers(device->device, &cb_ai, &worker->secondary);
+        check_result(result, "Could not allocate command buffers!");
+
+        cb_ai.commandPool = worker->transient_pool;
+        cb_ai.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        result = vkAllocateCommandBuffers(device->device, &cb_ai, &worker->transient);
+        check_result(result, "Could not allocate command buffers!");
+    }
+
+    printf("Recording %u commands per trial.\n", RECORDING_CYCLES * COMMANDS_PER_CYCLE);
+    printf("\n");
+    printf("Millions of commands/s and scaling efficiency:\n");
+    printf("%8s", "Threads");
+
+    for (uint32_t mode = 0; mode < MODE_COUNT; mode++)
+    {
+        printf(" %17s", mode_names[mode]);
+    }
+
+    printf("\n");
+
+    double single_rates[MODE_COUNT] = { 0 };
+
+    for (uint32_t thread_count = 1; thread_count <= max_thread_count; thread_count *= 2)
+    {
+        trial.thread_count = thread_count;
+        trial.cycle_count = RECORDING_CYCLES / thread_count;
+
+        /*
+        * The resubmitted buffers are recorded once per thread count, outside
+        * the trials.
+        */
+        VkCommandBufferBeginInfo cb_bi = { 0 };
+        cb_bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+        for (uint32_t i = 0; i < thread_count; i++)
+        {
+            vkBeginCommandBuffer(trial.workers[i].prerecorded, &cb_bi);
+            record_cycles(&trial, trial.workers[i].prerecorded, trial.cycle_count);
+            vkEndCommandBuffer(trial.workers[i].prerecorded);
+        }
+
+        printf("%8u", thread_count);
+
+        for (uint32_t mode = 0; mode < MODE_COUNT; mode++)
+        {
+            vkstats_statistics statistics;
+
+            trial.mode = (recording_mode)mode;
+            vkstats_harness_run(harness, run_recording_trial, &trial, 1, &statistics);
+
+            snprintf(label, sizeof(label), "%s recording, %u threads", mode_names[mode], thread_count);
+            vkstats_harness_record(harness, label, &statistics, 0);
+
+            double rate = (double)RECORDING_CYCLES * COMMANDS_PER_CYCLE / (statistics.median / 1000.0);
+
+            if (thread_count == 1)
+            {
+                single_rates[mode] = rate;
+            }
+
+            printf(" %10.2f %5.2f", rate / 1000000.0, rate / (single_rates[mode] * thread_count));
+        }
+
+        printf("\n");
+    }
+
+    vkDeviceWaitIdle(device->device);
+
+    for (uint32_t i = 0; i < max_thread_count; i++)
+    {
+        vkDestroyCommandPool(device->device, trial.workers[i].command_pool, NULL);
+        vkDestroyCommandPool(device->device, trial.workers[i].transient_pool, NULL);
+    }
+
+    vkstats_compute_kernel_destroy(&trial.kernel);
+
+    for (uint32_t i = 0; i < array_length(trial.buffers); i++)
+    {
+        vkDestroyBuffer(device->device, trial.buffers[i], NULL);
+    }
+
+    vkstats_memory_arena_destroy(&arena);
+    vkFreeCommandBuffers(device->device, device->command_pools[queue_index], 1, &trial.command_buffer);
+    vkDestroySemaphore(device->device, trial.semaphore, NULL);
+}
+
+/*
+* record_cycles()
+*
+* Records copy, barrier, dispatch, barrier cycles. The trailing barrier
+* orders each cycle before the next, including across command buffers.
+*
+* trial: the recording_trial with the buffers and kernel to use.
+* command_buffer: the command buffer to record into.
+* cycle_count: the number of cycles to record.
+*/
+static void record_cycles(recording_trial* trial, VkCommandBuffer command_buffer, uint32_t cycle_count)
+{
+    VkBufferCopy buffer_copy = { 0 };
+    buffer_copy.size = RECORDING_COPY_SIZE;
+
+    VkMemoryBarrier memory_barrier = { 0 };
+    memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    memory_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+    VkPipelineStageFlags stages = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+    for (uint32_t i = 0; i < cycle_count; i++)
+    {
+        vkCmdCopyBuffer(command_buffer, trial->buffers[0], trial->buffers[1], 1, &buffer_copy);
+        vkCmdPipelineBarrier(command_buffer, stages, stages, 0, 1, &memory_barrier, 0, NULL, 0, NULL);
+        vkstats_compute_kernel_dispatch(&trial->kernel, command_buffer);
+        vkCmdPipelineBarrier(command_buffer, stages, stages, 0, 1, &memory_barrier, 0, NULL, 0, NULL);
+    }
+}
+
+/*
+* run_recording_trial()
+*
+* Records on every thread at once, then submits everything in one batch. For
+* secondary buffers, the primary that executes them is recorded after the
+* threads finish. Resubmitting skips the threads entirely. The time runs from
+* the first thread starting until the submit returns, and the queue is
+* drained afterwards.
+*
+* context: a recording_trial.
+* results: the host time.
+*/
+static void run_recording_trial(void* context, double* results)
+{
+    VkResult result;
+    recording_trial* trial = context;
+    vkstats_device* device = trial->device;
+    VkCommandBuffer command_buffers[MAX_THREADS];
+    uint32_t command_buffer_count = trial->thread_count;
+    uint64_t start_ticks = UINT64_MAX;
+    uint64_t end_ticks;
+
+    if (trial->mode == MODE_RESUBMIT)
+    {
+        start_ticks = vkstats_stopwatch_get_ticks();
+    }
+    else
+    {
+        vkstats_barrier barrier;
+        vkstats_barrier_init(&barrier, trial->thread_count);
+
+        for (uint32_t i = 0; i < trial->thread_count; i++)
+        {
+            trial->workers[i].barrier = &barrier;
+            vkstats_thread_create(&trial->workers[i].thread, run_recording_worker, &trial->workers[i]);
+        }
+
+        for (uint32_t i = 0; i < trial->thread_count; i++)
+        {
+            vkstats_thread_join(&trial->workers[i].thread);
+
+            if (trial->workers[i].start_ticks < start_ticks)
+            {
+                start_ticks = trial->workers[i].start_ticks;
+            }
+        }
+
+        vkstats_barrier_destroy(&barrier);
+    }
+
+    for (uint32_t i = 0; i < trial->thread_count; i++)
+    {
+        recording_worker* worker = &trial->workers[i];
+
+        command_buffers[i] = trial->mode == MODE_PRIMARY ? worker->primary
+                           : trial->mode == MODE_SECONDARY ? worker->secondary
+                           : trial->mode == MODE_RESET_POOL ? worker->transient
+                           : worker->prerecorded;
+    }
+
+    if (trial->mode == MODE_SECONDARY)
+    {
+        VkCommandBufferBeginInfo cb_bi = { 0 };
+        cb_bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        cb_bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkBeginCommandBuffer(trial->command_buffer, &cb_bi);
+        vkCmdExecuteCommands(trial->command_buffer, trial->thread_count, command_buffers);
+        vkEndCommandBuffer(trial->command_buffer);
+
+        command_buffers[0] = trial->command_buffer;
+        command_buffer_count = 1;
+    }
+
+    trial->semaphore_value++;
+
+    VkTimelineSemaphoreSubmitInfo ts_si = { 0 };
+    ts_si.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    ts_si.pSignalSemaphoreValues = &trial->semaphore_value;
+    ts_si.signalSemaphoreValueCount = 1;
+
+    VkSubmitInfo si = { 0 };
+    si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    si.pNext = &ts_si;
+    si.pCommandBuffers = command_buffers;
+    si.commandBufferCount = command_buffer_count;
+    si.pSignalSemaphores = &trial->semaphore;
+    si.signalSemaphoreCount = 1;
+
+    uint64_t submit_ticks = vkstats_stopwatch_get_ticks();
+    result = vkQueueSubmit(device->queues[trial->queue_index], 1, &si, VK_NULL_HANDLE);
+    end_ticks = vkstats_stopwatch_get_ticks();
+    check_result(result, "Could not submit queue!");
+
+    vkstats_trace_host_event("submit", "vkQueueSubmit", submit_ticks, end_ticks, command_buffer_count);
+    vkstats_trace_host_event("recording", mode_names[trial->mode], start_ticks, submit_ticks, trial->thread_count);
+    vkstats_device_wait_semaphore(device, trial->semaphore, trial->semaphore_value);
+
+    results[0] = (double)(end_ticks - start_ticks) / vkstats_stopwatch_get_frequency() * 1000.0;
+}
+
+/*
+* run_recording_worker()
+*
+* Host thread that records its share of the cycles into its own command
+* buffer, once every thread is ready.
+*
+* context: a recording_worker.
+*/
+static void run_recording_worker(void* context)
+{
+    recording_worker* worker = context;
+    recording_trial* trial = worker->trial;
+    VkCommandBuffer command_buffer;
+
+    VkCommandBufferInheritanceInfo cb_ii = { 0 };
+    cb_ii.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
+    VkCommandBufferBeginInfo cb_bi = { 0 };
+    cb_bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    cb_bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkstats_barrier_wait(worker->barrier);
+    worker->start_ticks = vkstats_stopwatch_get_ticks();
+
+    if (trial->mode == MODE_SECONDARY)
+    {
+        command_buffer = worker->secondary;
+        cb_bi.pInheritanceInfo = &cb_ii;
+    }
+    else if (trial->mode == MODE_RESET_POOL)
+    {
+        command_buffer = worker->transient;
+        vkResetCommandPool(trial->device->device, worker->transient_pool, 0);
+    }
+    else
+    {
+        command_buffer = worker->primary;
+    }
+
+    vkBeginCommandBuffer(command_buffer, &cb_bi);
+    record_cycles(trial, command_buffer, trial->cycle_count);
+    vkEndCommandBuffer(command_buffer);
+
+    worker->end_ticks = vkstats_stopwatch_get_ticks();
+    vkstats_trace_host_event("recording", mode_names[trial->mode], worker->start_ticks, worker->end_ticks, trial->cycle_count);
+}
@@ -0,0 +1,170 @@
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "vulkan/vulkan.h"
+
+#include "config.h"
+#include "device.h"
+#include "util.h"
+#include "harness.h"
+#include "memory_arena.h"
+#include "queue_timer.h"
+#include "compute_kernel.h"
+#include "experiments.h"
+
+#define MIN_COMPUTE_SIZE (UINT64_C(1024) * UINT64_C(1024))
+#define MAX_COMPUTE_SIZE (UINT64_C(256) * UINT64_C(1024) * UINT64_C(1024))
+#define COMPUTE_BUFFER_USAGE (VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT)
+
+/*
+* Workgroup sizes swept when none is given. Sizes the device doesn't support
+* are skipped.
+*/
+static const uint32_t default_workgroup_sizes[] = { 64, 128, 256, 512, 1024 };
+
+void vkstats_experiment_compute_bandwidth(vkstats_device* device, uint32_t queue_index, uint32_t workgroup_size, vkstats_harness* harness)
+{
+    const VkPhysicalDeviceLimits* limits = &device->physical_device->properties.limits;
+    uint32_t max_workgroup_size = limits->maxComputeWorkGroupSize[0] < limits->maxComputeWorkGroupInvocations ? limits->maxComputeWorkGroupSize[0] : limits->maxComputeWorkGroupInvocations;
+    vkstats_compute_kernel kernels[array_length(default_workgroup_sizes)][VKSTATS_COMPUTE_KERNEL_COUNT];
+    uint32_t workgroup_sizes[array_length(default_workgroup_sizes)];
+    uint32_t workgroup_size_count = 0;
+    char label[96];
+
+    printf("\n");
+    printf("Running compute bandwidth experiment on queue %u (family %u).\n", queue_index, device->queue_family_indices[queue_index]);
+    vkstats_harness_begin_experiment(harness, "compute_bandwidth", device, queue_index);
+    vkstats_harness_set_memory_types(harness, device->device_local_memory_index, device->device_local_memory_index);
+
+    if (!(device->queue_flags[queue_index] & VK_QUEUE_COMPUTE_BIT))
+    {
+        printf("Queue does not support compute, skipping.\n");
+        return;
+    }
+
+    if (workgroup_size != 0)
+    {
+        if (workgroup_size > max_workgroup_size)
+        {
+            fatal_error("Workgroup size is too large for the device!");
+        }
+
+        workgroup_sizes[0] = workgroup_size;
+        workgroup_size_count = 1;
+    }
+    else
+    {
+        for (uint32_t i = 0; i < array_length(default_workgroup_sizes); i++)
+        {
+            if (default_workgroup_sizes[i] <= max_workgroup_size)
+            {
+                workgroup_sizes[workgroup_size_count] = default_workgroup_sizes[i];
+                workgroup_size_count++;
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < workgroup_size_count; i++)
+    {
+        for (uint32_t j = 0; j < VKSTATS_COMPUTE_KERNEL_COUNT; j++)
+        {
+            vkstats_compute_kernel_create(&kernels[i][j], device, (vkstats_compute_kernel_type)j, workgroup_sizes[i]);
+        }
+    }
+
+    vkstats_queue_timer timer;
+    vkstats_queue_timer_init(&timer, device, queue_index);
+
+    /*
+    * Bandwidth is reported against the buffer size, so copy and
+    * read-modify-write move twice the reported bytes through memory, the
+    * same as vkCmdCopyBuffer.
+    */
+    printf("Bandwidth is buffer size over %s time.\n", timer.metric_count > 1 ? "device" : "host");
+
+    vkstats_memory_arena arena;
+    vkstats_memory_arena_init(&arena, device);
+
+    VkBufferCreateInfo b_ci = { 0 };
+    b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    b_ci.pQueueFamilyIndices = &device->queue_family_indices[queue_index];
+    b_ci.queueFamilyIndexCount = 1;
+    b_ci.size = MAX_COMPUTE_SIZE;
+    b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    b_ci.usage = COMPUTE_BUFFER_USAGE;
+    vkstats_memory_arena_reserve(&arena, &b_ci, device->device_local_memory_index);
+    vkstats_memory_arena_reserve(&arena, &b_ci, device->device_local_memory_index);
+    vkstats_memory_arena_allocate(&arena);
+
+    /*
+    * maxStorageBufferRange can be as small as 128 MiB, so larger sizes are
+    * only run where the device allows them.
+    */
+    for (VkDeviceSize size = MIN_COMPUTE_SIZE; size <= MAX_COMPUTE_SIZE && size <= limits->maxStorageBufferRange; size *= 4)
+    {
+        VkBuffer source_buffer = vkstats_device_create_buffer(device, size, COMPUTE_BUFFER_USAGE, queue_index);
+        VkBuffer destination_buffer = vkstats_device_create_buffer(device, size, COMPUTE_BUFFER_USAGE, queue_index);
+
+        vkstats_memory_arena_reset(&arena);
+        vkstats_memory_arena_bind_buffer(&arena, source_buffer, device->device_local_memory_index);
+        vkstats_memory_arena_bind_buffer(&arena, destination_buffer, device->device_local_memory_index);
+
+        vkstats_statistics statistics[2];
+        double results[2];
+
+        /*
+        * Zero both buffers so the read kernel never matches its magic value.
+        */
+        vkstats_queue_timer_begin(&timer);
+        vkCmdFillBuffer(timer.command_buffer, source_buffer, 0, size, 0);
+        vkCmdFillBuffer(timer.command_buffer, destination_buffer, 0, size, 0);
+        vkstats_queue_timer_end(&timer);
+        vkstats_queue_timer_run(&timer, results);
+
+        /*
+        * vkCmdCopyBuffer on the same queue and buffers, for reference.
+        */
+        VkBufferCopy buffer_copy = { 0 };
+        buffer_copy.size = size;
+
+        vkstats_queue_timer_begin(&timer);
+        vkCmdCopyBuffer(timer.command_buffer, source_buffer, destination_buffer, 1, &buffer_copy);
+        vkstats_queue_timer_end(&timer);
+
+        vkstats_harness_run(harness, vkstats_queue_timer_run, &timer, timer.metric_count, statistics);
+
+        snprintf(label, sizeof(label), "vkCmdCopyBuffer %" PRIu64 " bytes", size);
+        vkstats_harness_report_bandwidth(harness, label, &statistics[timer.metric_count - 1], size);
+
+        for (uint32_t i = 0; i < workgroup_size_count; i++)
+        {
+            for (uint32_t j = 0; j < VKSTATS_COMPUTE_KERNEL_COUNT; j++)
+            {
+                vkstats_compute_kernel_bind(&kernels[i][j], source_buffer, destination_buffer, size);
+
+                vkstats_queue_timer_begin(&timer);
+                vkstats_compute_kernel_dispatch(&kernels[i][j], timer.command_buffer);
+                vkstats_queue_timer_end(&timer);
+
+                vkstats_harness_run(harness, vkstats_queue_timer_run, &timer, timer.metric_count, statistics);
+
+                snprintf(label, sizeof(label), "Compute %s %" PRIu64 " bytes, workgroup %u", vkstats_compute_kernel_get_name(kernels[i][j].type), size, workgroup_sizes[i]);
+                vkstats_harness_report_bandwidth(harness, label, &statistics[timer.metric_count - 1], size);
+            }
+        }
+
+        vkDestroyBuffer(device->device, source_buffer, NULL);
+        vkDestroyBuffer(device->device, destination_buffer, NULL);
+    }
+
+    vkstats_memory_arena_destroy(&arena);
+    vkstats_queue_timer_destroy(&timer);
+
+    for (uint32_t i = 0; i < workgroup_size_count; i++)
+    {
+        for (uint32_t j = 0; j < VKSTATS_COMPUTE_KERNEL_COUNT; j++)
+        {
+            vkstats_compute_kernel_destroy(&kernels[i][j]);
+        }
+    }
+}
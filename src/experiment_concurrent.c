@@ -0,0 +1,273 @@
+#include <stdio.h>
+
+#include "vulkan/vulkan.h"
+
+#include "config.h"
+#include "device.h"
+#include "util.h"
+#include "stopwatch.h"
+#include "harness.h"
+#include "memory_arena.h"
+#include "thread.h"
+#include "experiments.h"
+
+#define CONCURRENT_COPY_SIZE (UINT64_C(128) * UINT64_C(1024) * UINT64_C(1024))
+
+typedef struct
+{
+    vkstats_device*     device;
+    uint32_t            queue_index;
+    VkCommandBuffer     command_buffer;
+    VkBuffer            source_buffer;
+    VkBuffer            destination_buffer;
+    VkSemaphore         start_semaphore;
+    uint64_t            start_value;
+    VkSemaphore         done_semaphore;
+    uint64_t            done_value;
+    vkstats_barrier*    barrier;
+    uint64_t            end_ticks;
+    vkstats_thread      thread;
+} queue_worker;
+
+typedef struct
+{
+    vkstats_device*     device;
+    queue_worker        workers[MAX_QUEUES];
+    uint32_t            active_count;
+    VkSemaphore         start_semaphore;
+    uint64_t            start_value;
+} concurrent_trial;
+
+static void run_concurrent_trial(void* context, double* results);
+static void run_queue_worker(void* context);
+
+void vkstats_experiment_concurrent_queue_transfer(vkstats_device* device, vkstats_harness* harness)
+{
+    uint32_t queue_indices[MAX_QUEUES];
+    uint32_t queue_count = 0;
+
+    printf("\n");
+    printf("Running concurrent queue transfer experiment.\n");
+    vkstats_harness_begin_experiment(harness, "concurrent_queue_transfer", device, VKSTATS_NO_QUEUE);
+    vkstats_harness_set_memory_types(harness, device->host_visible_memory_index, device->device_local_memory_index);
+
+    /*
+    * Queues that alias the same VkQueue (when a family has fewer queues than
+    * were requested) can't be submitted to from two threads, so only the
+    * first of them takes part.
+    */
+    for (uint32_t i = 0; i < device->queue_count; i++)
+    {
+        uint32_t j;
+
+        for (j = 0; j < queue_count; j++)
+        {
+            if (device->queues[queue_indices[j]] == device->queues[i])
+            {
+                break;
+            }
+        }
+
+        if (j < queue_count)
+        {
+            printf("Queue %u aliases queue %u, skipping.\n", i, queue_indices[j]);
+            continue;
+        }
+
+        queue_indices[queue_count] = i;
+        queue_count++;
+    }
+
+    if (queue_count + 1 > MAX_METRICS)
+    {
+        fatal_error("Maximum metrics is too small!");
+    }
+
+    printf("\n");
+
+    concurrent_trial trial;
+    clear_struct(&trial);
+    trial.device = device;
+    trial.start_semaphore = vkstats_device_create_timeline_semaphore(device);
+
+    vkstats_memory_arena arena;
+    vkstats_memory_arena_init(&arena, device);
+
+    for (uint32_t i = 0; i < queue_count; i++)
+    {
+        VkBufferCreateInfo b_ci = { 0 };
+        b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        b_ci.pQueueFamilyIndices = &device->queue_family_indices[queue_indices[i]];
+        b_ci.queueFamilyIndexCount = 1;
+        b_ci.size = CONCURRENT_COPY_SIZE;
+        b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        b_ci.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        vkstats_memory_arena_reserve(&arena, &b_ci, device->host_visible_memory_index);
+        b_ci.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        vkstats_memory_arena_reserve(&arena, &b_ci, device->device_local_memory_index);
+    }
+
+    vkstats_memory_arena_allocate(&arena);
+
+    /*
+    * Every queue gets its own buffers, its own command buffer from its own
+    * pool, and its own semaphore to signal completion on.
+    */
+    VkCommandBufferBeginInfo cb_bi = { 0 };
+    cb_bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    for (uint32_t i = 0; i < queue_count; i++)
+    {
+        queue_worker* worker = &trial.workers[i];
+
+        worker->device = device;
+        worker->queue_index = queue_indices[i];
+        worker->start_semaphore = trial.start_semaphore;
+        worker->done_semaphore = vkstats_device_create_timeline_semaphore(device);
+        worker->source_buffer = vkstats_device_create_buffer(device, CONCURRENT_COPY_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, worker->queue_index);
+        worker->destination_buffer = vkstats_device_create_buffer(device, CONCURRENT_COPY_SIZE, VK_BUFFER_USAGE_TRANSFER_DST_BIT, worker->queue_index);
+        vkstats_memory_arena_bind_buffer(&arena, worker->source_buffer, device->host_visible_memory_index);
+        vkstats_memory_arena_bind_buffer(&arena, worker->destination_buffer, device->device_local_memory_index);
+
+        worker->command_buffer = vkstats_device_allocate_command_buffer(device, worker->queue_index);
+
+        VkBufferCopy buffer_copy = { 0 };
+        buffer_copy.size = CONCURRENT_COPY_SIZE;
+
+        vkBeginCommandBuffer(worker->command_buffer, &cb_bi);
+        vkCmdCopyBuffer(worker->command_buffer, worker->source_buffer, worker->destination_buffer, 1, &buffer_copy);
+        vkEndCommandBuffer(worker->command_buffer);
+    }
+
+    for (uint32_t active_count = 1; active_count <= queue_count; active_count++)
+    {
+        vkstats_statistics statistics[MAX_METRICS];
+        char label[64];
+
+        trial.active_count = active_count;
+        vkstats_harness_run(harness, run_concurrent_trial, &trial, active_count + 1, statistics);
+
+        printf("%u active queue(s):\n", active_count);
+
+        for (uint32_t i = 0; i < active_count; i++)
+        {
+            snprintf(label, sizeof(label), "  Queue %u (family %u), %u active", trial.workers[i].queue_index, device->queue_family_indices[trial.workers[i].queue_index], active_count);
+            vkstats_harness_report_bandwidth(harness, label, &statistics[i + 1], CONCURRENT_COPY_SIZE);
+        }
+
+        snprintf(label, sizeof(label), "  Aggregate, %u active", active_count);
+        vkstats_harness_report_bandwidth(harness, label, &statistics[0], CONCURRENT_COPY_SIZE * active_count);
+    }
+
+    for (uint32_t i = 0; i < queue_count; i++)
+    {
+        queue_worker* worker = &trial.workers[i];
+
+        vkFreeCommandBuffers(device->device, device->command_pools[worker->queue_index], 1, &worker->command_buffer);
+        vkDestroyBuffer(device->device, worker->source_buffer, NULL);
+        vkDestroyBuffer(device->device, worker->destination_buffer, NULL);
+        vkDestroySemaphore(device->device, worker->done_semaphore, NULL);
+    }
+
+    vkstats_memory_arena_destroy(&arena);
+    vkDestroySemaphore(device->device, trial.start_semaphore, NULL);
+}
+
+/*
+* run_concurrent_trial()
+*
+* Starts a thread per active queue, waits for all of them to submit their
+* copy, then releases every queue at once with a single host signal.
+*
+* context: a concurrent_trial.
+* results: the time until the last queue finished, followed by the time each
+*          queue took.
+*/
+static void run_concurrent_trial(void* context, double* results)
+{
+    VkResult result;
+    concurrent_trial* trial = context;
+    vkstats_barrier barrier;
+    uint64_t start_ticks;
+    double frequency = vkstats_stopwatch_get_frequency();
+
+    vkDeviceWaitIdle(trial->device->device);
+    vkstats_barrier_init(&barrier, trial->active_count + 1);
+    trial->start_value++;
+
+    for (uint32_t i = 0; i < trial->active_count; i++)
+    {
+        queue_worker* worker = &trial->workers[i];
+
+        worker->start_value = trial->start_value;
+        worker->done_value++;
+        worker->barrier = &barrier;
+        vkstats_thread_create(&worker->thread, run_queue_worker, worker);
+    }
+
+    vkstats_barrier_wait(&barrier);
+
+    VkSemaphoreSignalInfo s_si = { 0 };
+    s_si.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+    s_si.value = trial->start_value;
+    s_si.semaphore = trial->start_semaphore;
+
+    start_ticks = vkstats_stopwatch_get_ticks();
+    result = vkSignalSemaphore(trial->device->device, &s_si);
+    check_result(result, "Could not signal semaphore!");
+
+    results[0] = 0.0;
+
+    for (uint32_t i = 0; i < trial->active_count; i++)
+    {
+        queue_worker* worker = &trial->workers[i];
+
+        vkstats_thread_join(&worker->thread);
+        results[i + 1] = (double)(worker->end_ticks - start_ticks) / frequency * 1000.0;
+
+        if (results[i + 1] > results[0])
+        {
+            results[0] = results[i + 1];
+        }
+    }
+
+    vkstats_barrier_destroy(&barrier);
+}
+
+/*
+* run_queue_worker()
+*
+* Host thread for one queue. Submits the queue's copy behind the shared start
+* semaphore, then waits for it to complete and records when it did.
+*
+* context: a queue_worker.
+*/
+static void run_queue_worker(void* context)
+{
+    queue_worker* worker = context;
+
+    VkTimelineSemaphoreSubmitInfo ts_si = { 0 };
+    ts_si.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    ts_si.pWaitSemaphoreValues = &worker->start_value;
+    ts_si.waitSemaphoreValueCount = 1;
+    ts_si.pSignalSemaphoreValues = &worker->done_value;
+    ts_si.signalSemaphoreValueCount = 1;
+
+    VkPipelineStageFlags wait_destination_stage_mask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    VkSubmitInfo si = { 0 };
+    si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    si.pNext = &ts_si;
+    si.pCommandBuffers = &worker->command_buffer;
+    si.commandBufferCount = 1;
+    si.pWaitSemaphores = &worker->start_semaphore;
+    si.waitSemaphoreCount = 1;
+    si.pSignalSemaphores = &worker->done_semaphore;
+    si.signalSemaphoreCount = 1;
+    si.pWaitDstStageMask = &wait_destination_stage_mask;
+
+    vkstats_device_submit(worker->device, worker->queue_index, &si, CONCURRENT_COPY_SIZE);
+
+    vkstats_barrier_wait(worker->barrier);
+    vkstats_device_wait_semaphore(worker->device, worker->done_semaphore, worker->done_value);
+    worker->end_ticks = vkstats_stopwatch_get_ticks();
+}
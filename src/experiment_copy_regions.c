@@ -0,0 +1,356 @@
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "vulkan/vulkan.h"
+
+#include "device.h"
+#include "util.h"
+#include "stopwatch.h"
+#include "harness.h"
+#include "memory_arena.h"
+#include "calibration.h"
+#include "trace.h"
+#include "experiments.h"
+
+#define REGION_TOTAL_SIZE (UINT64_C(32) * UINT64_C(1024) * UINT64_C(1024))
+#define MAX_REGION_COUNT 1024
+#define REGION_COUNT_STEPS 6
+#define MAX_ALIGNMENTS 5
+#define MAX_ALIGNMENT 256
+
+/*
+* Shades for the heat maps, from slowest to fastest relative to the fastest
+* cell of the map.
+*/
+static const char heat_shades[] = " .:-=+*#%@";
+
+typedef struct
+{
+    vkstats_device*     device;
+    uint32_t            queue_index;
+    VkCommandBuffer     command_buffers[MAX_REGION_COUNT];
+    uint32_t            command_buffer_count;
+    VkSemaphore         semaphore;
+    uint64_t            semaphore_value;
+    VkQueryPool         query_pool;
+    vkstats_calibration calibration;
+    vkstats_stopwatch*  stopwatch;
+} region_trial;
+
+static void record_copies(region_trial* trial, VkBuffer source_buffer, VkBuffer destination_buffer, const VkBufferCopy* regions, uint32_t region_count, VkBool32 per_region);
+static void run_region_trial(void* context, double* results);
+static void print_heat_map(const char* title, const VkDeviceSize* alignments, uint32_t alignment_count, double bandwidths[REGION_COUNT_STEPS][MAX_ALIGNMENTS]);
+
+void vkstats_experiment_copy_regions(vkstats_device* device, uint32_t queue_index, vkstats_harness* harness)
+{
+    VkResult result;
+    VkDeviceSize alignments[MAX_ALIGNMENTS] = { 1, 4, 16, MAX_ALIGNMENT };
+    uint32_t alignment_count = 4;
+    VkBufferCopy regions[MAX_REGION_COUNT];
+    double bandwidths[2][REGION_COUNT_STEPS][MAX_ALIGNMENTS];
+    char label[96];
+
+    vkstats_stopwatch stopwatch;
+    vkstats_stopwatch_init(&stopwatch);
+
+    printf("\n");
+    printf("Running copy region experiment on queue %u (family %u).\n", queue_index, device->queue_family_indices[queue_index]);
+    vkstats_harness_begin_experiment(harness, "copy_regions", device, queue_index);
+    vkstats_harness_set_memory_types(harness, device->host_visible_memory_index, device->device_local_memory_index);
+
+    /*
+    * The device's preferred alignment joins the list unless it's already on
+    * it.
+    */
+    VkDeviceSize optimal_alignment = device->physical_device->properties.limits.optimalBufferCopyOffsetAlignment;
+    VkBool32 listed = VK_FALSE;
+
+    for (uint32_t i = 0; i < alignment_count; i++)
+    {
+        listed |= alignments[i] == optimal_alignment;
+    }
+
+    if (!listed && optimal_alignment > 0 && optimal_alignment <= MAX_ALIGNMENT)
+    {
+        alignments[alignment_count] = optimal_alignment;
+        alignment_count++;
+    }
+
+    printf("Copying %" PRIu64 " bytes, optimal offset alignment %" PRIu64 ".\n", REGION_TOTAL_SIZE, optimal_alignment);
+
+    region_trial trial;
+    clear_struct(&trial);
+    trial.device = device;
+    trial.queue_index = queue_index;
+    trial.semaphore = vkstats_device_create_timeline_semaphore(device);
+    trial.stopwatch = &stopwatch;
+    vkstats_calibration_init(&trial.calibration, device, queue_index);
+
+    VkCommandBufferAllocateInfo cb_ai = { 0 };
+    cb_ai.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    cb_ai.commandBufferCount = MAX_REGION_COUNT;
+    cb_ai.commandPool = device->command_pools[queue_index];
+    result = vkAllocateCommandBuffers(device->device, &cb_ai, trial.command_buffers);
+    check_result(result, "Could not allocate command buffers!");
+
+    if (device->queue_family_properties[queue_index].timestampValidBits > 0)
+    {
+        VkQueryPoolCreateInfo qp_ci = { 0 };
+        qp_ci.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        qp_ci.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        qp_ci.queryCount = 2;
+        result = vkCreateQueryPool(device->device, &qp_ci, NULL, &trial.query_pool);
+        check_result(result, "Could not create query pool!");
+    }
+
+    /*
+    * The buffers have room past the total for the largest offset.
+    */
+    VkDeviceSize buffer_size = REGION_TOTAL_SIZE + MAX_ALIGNMENT;
+
+    vkstats_memory_arena arena;
+    vkstats_memory_arena_init(&arena, device);
+
+    VkBufferCreateInfo b_ci = { 0 };
+    b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    b_ci.pQueueFamilyIndices = &device->queue_family_indices[queue_index];
+    b_ci.queueFamilyIndexCount = 1;
+    b_ci.size = buffer_size;
+    b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    b_ci.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    vkstats_memory_arena_reserve(&arena, &b_ci, device->host_visible_memory_index);
+    b_ci.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    vkstats_memory_arena_reserve(&arena, &b_ci, device->device_local_memory_index);
+    vkstats_memory_arena_allocate(&arena);
+
+    VkBuffer source_buffer = vkstats_device_create_buffer(device, buffer_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, queue_index);
+    VkBuffer destination_buffer = vkstats_device_create_buffer(device, buffer_size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue_index);
+    vkstats_memory_arena_bind_buffer(&arena, source_buffer, device->host_visible_memory_index);
+    vkstats_memory_arena_bind_buffer(&arena, destination_buffer, device->device_local_memory_index);
+
+    /*
+    * Mode 0 records every region into one vkCmdCopyBuffer in one command
+    * buffer. Mode 1 gives every region its own command buffer, all of them
+    * submitted together.
+    */
+    for (uint32_t mode = 0; mode < 2; mode++)
+    {
+        uint32_t region_count = 1;
+
+        for (uint32_t step = 0; step < REGION_COUNT_STEPS; step++, region_count *= 4)
+        {
+            VkDeviceSize chunk_size = REGION_TOTAL_SIZE / region_count;
+
+            for (uint32_t i = 0; i < alignment_count; i++)
+            {
+                vkstats_statistics statistics[2];
+
+                /*
+                * Chunks are whole powers of two, so starting at the alignment
+                * puts every offset on a multiple of it and no larger power
+                * of two below the chunk size.
+                */
+                for (uint32_t j = 0; j < region_count; j++)
+                {
+                    regions[j].srcOffset = alignments[i] + j * chunk_size;
+                    regions[j].dstOffset = alignments[i] + j * chunk_size;
+                    regions[j].size = chunk_size;
+                }
+
+                record_copies(&trial, source_buffer, destination_buffer, regions, region_count, mode == 1);
+                vkstats_harness_run(harness, run_region_trial, &trial, trial.query_pool != VK_NULL_HANDLE ? 2 : 1, statistics);
+
+                vkstats_statistics* best = trial.query_pool != VK_NULL_HANDLE ? &statistics[1] : &statistics[0];
+                bandwidths[mode][step][i] = vkstats_get_bandwidth(REGION_TOTAL_SIZE, best->median);
+
+                snprintf(label, sizeof(label), "%s, %u regions, alignment %" PRIu64, mode == 0 ? "One command buffer" : "Command buffer per region", region_count, alignments[i]);
+                vkstats_harness_record(harness, label, best, REGION_TOTAL_SIZE);
+            }
+        }
+    }
+
+    print_heat_map("One command buffer, GB/s", alignments, alignment_count, bandwidths[0]);
+    print_heat_map("Command buffer per region, GB/s", alignments, alignment_count, bandwidths[1]);
+
+    vkDeviceWaitIdle(device->device);
+    vkDestroyBuffer(device->device, source_buffer, NULL);
+    vkDestroyBuffer(device->device, destination_buffer, NULL);
+    vkstats_memory_arena_destroy(&arena);
+
+    if (trial.query_pool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(device->device, trial.query_pool, NULL);
+    }
+
+    vkFreeCommandBuffers(device->device, device->command_pools[queue_index], MAX_REGION_COUNT, trial.command_buffers);
+    vkDestroySemaphore(device->device, trial.semaphore, NULL);
+}
+
+/*
+* record_copies()
+*
+* Records the regions, either all into the first command buffer or one per
+* command buffer. Timestamps go at the start of the first command buffer and
+* the end of the last.
+*
+* trial: the region_trial to record into.
+* source_buffer: the buffer to copy from.
+* destination_buffer: the buffer to copy to.
+* regions: the regions to copy.
+* region_count: the number of regions.
+* per_region: whether each region gets its own command buffer.
+*/
+static void record_copies(region_trial* trial, VkBuffer source_buffer, VkBuffer destination_buffer, const VkBufferCopy* regions, uint32_t region_count, VkBool32 per_region)
+{
+    trial->command_buffer_count = per_region ? region_count : 1;
+
+    VkCommandBufferBeginInfo cb_bi = { 0 };
+    cb_bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    for (uint32_t i = 0; i < trial->command_buffer_count; i++)
+    {
+        VkCommandBuffer command_buffer = trial->command_buffers[i];
+
+        vkBeginCommandBuffer(command_buffer, &cb_bi);
+
+        if (i == 0 && trial->query_pool != VK_NULL_HANDLE)
+        {
+            vkCmdResetQueryPool(command_buffer, trial->query_pool, 0, 2);
+            vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, trial->query_pool, 0);
+        }
+
+        if (per_region)
+        {
+            vkCmdCopyBuffer(command_buffer, source_buffer, destination_buffer, 1, &regions[i]);
+        }
+        else
+        {
+            vkCmdCopyBuffer(command_buffer, source_buffer, destination_buffer, region_count, regions);
+        }
+
+        if (i + 1 == trial->command_buffer_count && trial->query_pool != VK_NULL_HANDLE)
+        {
+            vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, trial->query_pool, 1);
+        }
+
+        vkEndCommandBuffer(command_buffer);
+    }
+}
+
+/*
+* run_region_trial()
+*
+* Submits the recorded command buffers in one batch and waits for them.
+*
+* context: a region_trial.
+* results: the host time, followed by the device time if the queue supports
+*          timestamps.
+*/
+static void run_region_trial(void* context, double* results)
+{
+    VkResult result;
+    region_trial* trial = context;
+    vkstats_device* device = trial->device;
+    VkBool32 trace_queue = vkstats_trace_is_enabled() && trial->calibration.supported;
+
+    trial->semaphore_value++;
+
+    VkTimelineSemaphoreSubmitInfo ts_si = { 0 };
+    ts_si.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    ts_si.pSignalSemaphoreValues = &trial->semaphore_value;
+    ts_si.signalSemaphoreValueCount = 1;
+
+    VkSubmitInfo si = { 0 };
+    si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    si.pNext = &ts_si;
+    si.pCommandBuffers = trial->command_buffers;
+    si.commandBufferCount = trial->command_buffer_count;
+    si.pSignalSemaphores = &trial->semaphore;
+    si.signalSemaphoreCount = 1;
+
+    vkDeviceWaitIdle(device->device);
+
+    /*
+    * Placing the copies on the trace needs a fresh calibration, which isn't
+    * worth taking when nothing is traced.
+    */
+    if (trace_queue)
+    {
+        vkstats_calibration_update(&trial->calibration);
+    }
+
+    vkstats_stopwatch_start(trial->stopwatch);
+    vkstats_device_submit(device, trial->queue_index, &si, trial->command_buffer_count);
+    vkstats_device_wait_semaphore(device, trial->semaphore, trial->semaphore_value);
+    results[0] = vkstats_stopwatch_stop(trial->stopwatch);
+
+    if (trial->query_pool != VK_NULL_HANDLE)
+    {
+        uint64_t timestamps[2];
+        result = vkGetQueryPoolResults(device->device, trial->query_pool, 0, 2, sizeof(timestamps), timestamps, sizeof(timestamps[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+        check_result(result, "Could not get query pool results!");
+
+        results[1] = vkstats_device_get_timestamp_elapsed(device, trial->queue_index, timestamps);
+
+        if (trace_queue)
+        {
+            vkstats_trace_queue_event("vkCmdCopyBuffer",
+                device->queues[trial->queue_index],
+                vkstats_calibration_get_host_ticks(&trial->calibration, timestamps[0]),
+                vkstats_calibration_get_host_ticks(&trial->calibration, timestamps[1]),
+                trial->command_buffer_count);
+        }
+    }
+}
+
+/*
+* print_heat_map()
+*
+* Prints bandwidth by chunk size and alignment, each cell shaded by how
+* close it comes to the fastest cell.
+*
+* title: printed above the map.
+* alignments: the alignment of each column.
+* alignment_count: the number of columns.
+* bandwidths: the bandwidth of each cell, in GB/s.
+*/
+static void print_heat_map(const char* title, const VkDeviceSize* alignments, uint32_t alignment_count, double bandwidths[REGION_COUNT_STEPS][MAX_ALIGNMENTS])
+{
+    double peak = 0.0;
+    uint32_t shade_count = (uint32_t)sizeof(heat_shades) - 1;
+
+    for (uint32_t i = 0; i < REGION_COUNT_STEPS; i++)
+    {
+        for (uint32_t j = 0; j < alignment_count; j++)
+        {
+            peak = bandwidths[i][j] > peak ? bandwidths[i][j] : peak;
+        }
+    }
+
+    printf("\n");
+    printf("%s:\n", title);
+    printf("%8s %12s", "Regions", "Chunk");
+
+    for (uint32_t j = 0; j < alignment_count; j++)
+    {
+        printf(" %7" PRIu64 "B", alignments[j]);
+    }
+
+    printf("\n");
+
+    uint32_t region_count = 1;
+
+    for (uint32_t i = 0; i < REGION_COUNT_STEPS; i++, region_count *= 4)
+    {
+        printf("%8u %12" PRIu64, region_count, REGION_TOTAL_SIZE / region_count);
+
+        for (uint32_t j = 0; j < alignment_count; j++)
+        {
+            uint32_t shade = peak > 0.0 ? (uint32_t)(bandwidths[i][j] / peak * (shade_count - 1) + 0.5) : 0;
+
+            printf(" %6.2f %c", bandwidths[i][j], heat_shades[shade]);
+        }
+
+        printf("\n");
+    }
+}
@@ -0,0 +1,485 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vulkan/vulkan.h"
+
+#include "device.h"
+#include "util.h"
+#include "stopwatch.h"
+#include "harness.h"
+#include "memory_arena.h"
+#include "file.h"
+#include "trace.h"
+#include "experiments.h"
+
+#define FILE_UPLOAD_SIZE (UINT64_C(256) * UINT64_C(1024) * UINT64_C(1024))
+#define FILE_CHUNK_SIZE (UINT64_C(8) * UINT64_C(1024) * UINT64_C(1024))
+#define STAGING_SLOTS 4
+
+typedef struct
+{
+    vkstats_device*                         device;
+    uint32_t                                queue_index;
+    vkstats_file*                           file;
+    VkBool32                                cold;
+    VkCommandBuffer                         command_buffers[STAGING_SLOTS];
+    VkSemaphore                             semaphore;
+    uint64_t                                semaphore_value;
+    VkBuffer                                destination_buffer;
+    VkBuffer                                staging_buffer;
+    uint8_t*                                staging_mapped;
+    uint8_t*                                bounce;
+    PFN_vkGetMemoryHostPointerPropertiesEXT get_host_pointer_properties;
+    VkExternalMemoryHandleTypeFlagBits      handle_type;
+    VkDeviceSize                            import_alignment;
+    vkstats_stopwatch*                      stopwatch;
+} file_trial;
+
+static VkBool32 find_import_handle_type(file_trial* trial, vkstats_file* file);
+static void submit_copy(file_trial* trial, uint32_t slot, VkBuffer source_buffer, VkDeviceSize source_offset, VkDeviceSize destination_offset, VkDeviceSize size);
+static void run_staged_trial(void* context, double* results);
+static void run_import_trial(void* context, double* results);
+
+void vkstats_experiment_file_upload(vkstats_device* device, uint32_t device_index, uint32_t queue_index, vkstats_harness* harness)
+{
+    char label[64];
+    char name[64];
+    char path[VKSTATS_FILE_MAX_PATH];
+
+    vkstats_stopwatch stopwatch;
+    vkstats_stopwatch_init(&stopwatch);
+
+    printf("\n");
+    printf("Running file upload experiment on queue %u (family %u).\n", queue_index, device->queue_family_indices[queue_index]);
+    vkstats_harness_begin_experiment(harness, "file_upload", device, queue_index);
+    vkstats_harness_set_memory_types(harness, device->host_visible_memory_index, device->device_local_memory_index);
+
+    /*
+    * Every device gets its own file, since --all-devices runs this on all of
+    * them at once.
+    */
+    snprintf(name, sizeof(name), "vkstats_file_upload_%u.bin", device_index);
+    vkstats_file_get_temp_path(path, name);
+
+    if (!vkstats_file_write_pattern(path, FILE_UPLOAD_SIZE))
+    {
+        printf("Could not write %s, skipping the experiment.\n", path);
+        return;
+    }
+
+    file_trial trial;
+    clear_struct(&trial);
+    trial.device = device;
+    trial.queue_index = queue_index;
+    trial.semaphore = vkstats_device_create_timeline_semaphore(device);
+    trial.stopwatch = &stopwatch;
+
+    for (uint32_t i = 0; i < STAGING_SLOTS; i++)
+    {
+        trial.command_buffers[i] = vkstats_device_allocate_command_buffer(device, queue_index);
+    }
+
+    /*
+    * The staging buffer is the only one bound to its memory, so it starts at
+    * the beginning of the mapping.
+    */
+    vkstats_memory_arena arena;
+    vkstats_memory_arena_init(&arena, device);
+
+    VkBufferCreateInfo b_ci = { 0 };
+    b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    b_ci.pQueueFamilyIndices = &device->queue_family_indices[queue_index];
+    b_ci.queueFamilyIndexCount = 1;
+    b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    b_ci.size = FILE_UPLOAD_SIZE;
+    b_ci.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    vkstats_memory_arena_reserve(&arena, &b_ci, device->device_local_memory_index);
+    b_ci.size = FILE_CHUNK_SIZE * STAGING_SLOTS;
+    b_ci.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    vkstats_memory_arena_reserve(&arena, &b_ci, device->host_visible_memory_index);
+    vkstats_memory_arena_allocate(&arena);
+
+    trial.destination_buffer = vkstats_device_create_buffer(device, FILE_UPLOAD_SIZE, VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue_index);
+    trial.staging_buffer = vkstats_device_create_buffer(device, FILE_CHUNK_SIZE * STAGING_SLOTS, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, queue_index);
+    vkstats_memory_arena_bind_buffer(&arena, trial.destination_buffer, device->device_local_memory_index);
+    VkDeviceSize staging_offset = vkstats_memory_arena_bind_buffer(&arena, trial.staging_buffer, device->host_visible_memory_index);
+    trial.staging_mapped = (uint8_t*)vkstats_memory_arena_map(&arena, device->host_visible_memory_index) + staging_offset;
+
+    trial.bounce = malloc(FILE_CHUNK_SIZE);
+
+    if (trial.bounce == NULL)
+    {
+        fatal_error("Could not allocate bounce buffer!");
+    }
+
+    vkstats_file buffered_file;
+    vkstats_file direct_file;
+
+    if (!vkstats_file_open(&buffered_file, path, VK_FALSE))
+    {
+        fatal_error("Could not open file!");
+    }
+
+    /*
+    * Unbuffered reads go straight into the staging memory, which needs to be
+    * aligned for them.
+    */
+    VkBool32 direct_supported = (uintptr_t)trial.staging_mapped % VKSTATS_FILE_ALIGNMENT == 0;
+
+    if (!direct_supported)
+    {
+        printf("Staging memory isn't aligned for unbuffered reads, skipping them.\n");
+    }
+    else if (!vkstats_file_open(&direct_file, path, VK_TRUE))
+    {
+        printf("The file system doesn't support unbuffered reads, skipping them.\n");
+        direct_supported = VK_FALSE;
+    }
+    else if (!vkstats_file_try_read(&direct_file, 0, trial.staging_mapped, VKSTATS_FILE_ALIGNMENT))
+    {
+        /*
+        * Some drivers back the mapping with device pages the kernel can't
+        * read into directly.
+        */
+        printf("Staging memory can't take unbuffered reads, skipping them.\n");
+        vkstats_file_close(&direct_file);
+        direct_supported = VK_FALSE;
+    }
+
+    VkBool32 import_supported = vkstats_device_has_extension(device, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME) && find_import_handle_type(&trial, &buffered_file);
+
+    if (!import_supported)
+    {
+        printf("Mapped files can't be imported, skipping zero-copy uploads.\n");
+    }
+
+    /*
+    * Warm runs read from the operating system's cache. Cold runs evict the
+    * file before every trial, where the platform allows it, so they include
+    * the disk.
+    */
+    VkBool32 evict_supported = vkstats_file_evict(&buffered_file);
+
+    if (!evict_supported)
+    {
+        printf("The file can't be evicted from the cache, skipping cold runs.\n");
+    }
+
+    for (uint32_t pass = 0; pass < (evict_supported ? 2u : 1u); pass++)
+    {
+        const char* temperature = pass == 0 ? "warm" : "cold";
+        vkstats_statistics statistics;
+
+        trial.cold = pass == 1;
+
+        /*
+        * The warm pass needs the file cached before its first trial.
+        */
+        if (!trial.cold)
+        {
+            for (uint64_t offset = 0; offset < FILE_UPLOAD_SIZE; offset += FILE_CHUNK_SIZE)
+            {
+                vkstats_file_read(&buffered_file, offset, trial.bounce, FILE_CHUNK_SIZE);
+            }
+        }
+
+        trial.file = &buffered_file;
+        vkstats_harness_run(harness, run_staged_trial, &trial, 1, &statistics);
+        snprintf(label, sizeof(label), "Read and copy to staging (%s)", temperature);
+        vkstats_harness_report_bandwidth(harness, label, &statistics, FILE_UPLOAD_SIZE);
+
+        if (direct_supported)
+        {
+            uint8_t* bounce = trial.bounce;
+
+            trial.file = &direct_file;
+            trial.bounce = NULL;
+            vkstats_harness_run(harness, run_staged_trial, &trial, 1, &statistics);
+            snprintf(label, sizeof(label), "Unbuffered read into staging (%s)", temperature);
+            vkstats_harness_report_bandwidth(harness, label, &statistics, FILE_UPLOAD_SIZE);
+            trial.bounce = bounce;
+        }
+
+        if (import_supported)
+        {
+            trial.file = &buffered_file;
+            vkstats_harness_run(harness, run_import_trial, &trial, 1, &statistics);
+            snprintf(label, sizeof(label), "Imported file mapping (%s)", temperature);
+            vkstats_harness_report_bandwidth(harness, label, &statistics, FILE_UPLOAD_SIZE);
+        }
+    }
+
+    vkDeviceWaitIdle(device->device);
+
+    if (direct_supported)
+    {
+        vkstats_file_close(&direct_file);
+    }
+
+    vkstats_file_close(&buffered_file);
+    vkstats_file_delete(path);
+    free(trial.bounce);
+
+    vkDestroyBuffer(device->device, trial.destination_buffer, NULL);
+    vkDestroyBuffer(device->device, trial.staging_buffer, NULL);
+    vkstats_memory_arena_destroy(&arena);
+    vkFreeCommandBuffers(device->device, device->command_pools[queue_index], STAGING_SLOTS, trial.command_buffers);
+    vkDestroySemaphore(device->device, trial.semaphore, NULL);
+}
+
+/*
+* find_import_handle_type()
+*
+* Maps the file and checks whether the device can import the mapping, first
+* as a host allocation and then as foreign memory, which some drivers want
+* for file mappings.
+*
+* trial: the file_trial to fill in the handle type, import alignment and
+*        function pointer of.
+* file: the file to try.
+*
+* Returns VK_TRUE if either handle type works.
+*/
+static VkBool32 find_import_handle_type(file_trial* trial, vkstats_file* file)
+{
+    static const VkExternalMemoryHandleTypeFlagBits handle_types[] =
+    {
+        VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT,
+        VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_MAPPED_FOREIGN_MEMORY_BIT_EXT
+    };
+
+    vkstats_device* device = trial->device;
+    VkBool32 found = VK_FALSE;
+
+    VkPhysicalDeviceExternalMemoryHostPropertiesEXT host_properties = { 0 };
+    host_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+
+    VkPhysicalDeviceProperties2 properties2 = { 0 };
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &host_properties;
+    vkGetPhysicalDeviceProperties2(device->physical_device->physical_device, &properties2);
+
+    trial->import_alignment = host_properties.minImportedHostPointerAlignment;
+    trial->get_host_pointer_properties = (PFN_vkGetMemoryHostPointerPropertiesEXT)vkGetDeviceProcAddr(device->device, "vkGetMemoryHostPointerPropertiesEXT");
+
+    if (trial->get_host_pointer_properties == NULL || trial->import_alignment == 0 || FILE_UPLOAD_SIZE % trial->import_alignment != 0)
+    {
+        return VK_FALSE;
+    }
+
+    printf("Imported host pointer alignment: %" PRIu64 " bytes\n", trial->import_alignment);
+
+    void* mapped = vkstats_file_map(file, trial->import_alignment);
+
+    for (uint32_t i = 0; i < array_length(handle_types) && !found; i++)
+    {
+        VkMemoryHostPointerPropertiesEXT pointer_properties = { 0 };
+        pointer_properties.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+
+        if (trial->get_host_pointer_properties(device->device, handle_types[i], mapped, &pointer_properties) == VK_SUCCESS
+            && pointer_properties.memoryTypeBits != 0)
+        {
+            trial->handle_type = handle_types[i];
+            found = VK_TRUE;
+        }
+    }
+
+    vkstats_file_unmap(file, mapped);
+
+    return found;
+}
+
+/*
+* submit_copy()
+*
+* Records a copy into the destination buffer and submits it, signaling the
+* next semaphore value.
+*
+* trial: the file_trial to submit on.
+* slot: the command buffer to record into.
+* source_buffer: the buffer to copy from.
+* source_offset: where in the source buffer to start.
+* destination_offset: where in the destination buffer to start.
+* size: the number of bytes to copy.
+*/
+static void submit_copy(file_trial* trial, uint32_t slot, VkBuffer source_buffer, VkDeviceSize source_offset, VkDeviceSize destination_offset, VkDeviceSize size)
+{
+    VkCommandBuffer command_buffer = trial->command_buffers[slot];
+
+    VkCommandBufferBeginInfo cb_bi = { 0 };
+    cb_bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    cb_bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VkBufferCopy buffer_copy = { 0 };
+    buffer_copy.srcOffset = source_offset;
+    buffer_copy.dstOffset = destination_offset;
+    buffer_copy.size = size;
+
+    vkBeginCommandBuffer(command_buffer, &cb_bi);
+    vkCmdCopyBuffer(command_buffer, source_buffer, trial->destination_buffer, 1, &buffer_copy);
+    vkEndCommandBuffer(command_buffer);
+
+    trial->semaphore_value++;
+
+    VkTimelineSemaphoreSubmitInfo ts_si = { 0 };
+    ts_si.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    ts_si.pSignalSemaphoreValues = &trial->semaphore_value;
+    ts_si.signalSemaphoreValueCount = 1;
+
+    VkSubmitInfo si = { 0 };
+    si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    si.pNext = &ts_si;
+    si.pCommandBuffers = &command_buffer;
+    si.commandBufferCount = 1;
+    si.pSignalSemaphores = &trial->semaphore;
+    si.signalSemaphoreCount = 1;
+
+    vkstats_device_submit(trial->device, trial->queue_index, &si, size);
+}
+
+/*
+* run_staged_trial()
+*
+* Streams the file through the staging slots chunk by chunk, reading the
+* next chunk while earlier ones are copied. Reads through the bounce buffer
+* and copies into staging if there is one, otherwise reads straight into
+* staging.
+*
+* context: a file_trial.
+* results: the time from the first read until the last copy completes.
+*/
+static void run_staged_trial(void* context, double* results)
+{
+    file_trial* trial = context;
+    vkstats_device* device = trial->device;
+    uint64_t first_value = trial->semaphore_value;
+    uint32_t chunk = 0;
+
+    if (trial->cold)
+    {
+        vkstats_file_evict(trial->file);
+    }
+
+    vkstats_stopwatch_start(trial->stopwatch);
+
+    for (uint64_t offset = 0; offset < FILE_UPLOAD_SIZE; offset += FILE_CHUNK_SIZE, chunk++)
+    {
+        uint32_t slot = chunk % STAGING_SLOTS;
+        uint8_t* staging = trial->staging_mapped + slot * FILE_CHUNK_SIZE;
+
+        /*
+        * Wait for the copy that last used this slot.
+        */
+        if (chunk >= STAGING_SLOTS)
+        {
+            vkstats_device_wait_semaphore(device, trial->semaphore, first_value + chunk - STAGING_SLOTS + 1);
+        }
+
+        if (trial->bounce != NULL)
+        {
+            vkstats_file_read(trial->file, offset, trial->bounce, FILE_CHUNK_SIZE);
+            memcpy(staging, trial->bounce, FILE_CHUNK_SIZE);
+        }
+        else
+        {
+            vkstats_file_read(trial->file, offset, staging, FILE_CHUNK_SIZE);
+        }
+
+        submit_copy(trial, slot, trial->staging_buffer, slot * FILE_CHUNK_SIZE, offset, FILE_CHUNK_SIZE);
+    }
+
+    vkstats_device_wait_semaphore(device, trial->semaphore, trial->semaphore_value);
+    results[0] = vkstats_stopwatch_stop(trial->stopwatch);
+}
+
+/*
+* run_import_trial()
+*
+* Maps the file, imports the mapping as device memory and copies all of it
+* in one go. Timing stops once the copy completes, so releasing the import
+* isn't counted.
+*
+* context: a file_trial.
+* results: the time from mapping the file until the copy completes.
+*/
+static void run_import_trial(void* context, double* results)
+{
+    VkResult result;
+    file_trial* trial = context;
+    vkstats_device* device = trial->device;
+    VkBuffer source_buffer;
+    VkDeviceMemory memory;
+
+    if (trial->cold)
+    {
+        vkstats_file_evict(trial->file);
+    }
+
+    vkstats_stopwatch_start(trial->stopwatch);
+
+    void* mapped = vkstats_file_map(trial->file, trial->import_alignment);
+
+    VkMemoryHostPointerPropertiesEXT pointer_properties = { 0 };
+    pointer_properties.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+    result = trial->get_host_pointer_properties(device->device, trial->handle_type, mapped, &pointer_properties);
+    check_result(result, "Could not get host pointer properties!");
+
+    VkExternalMemoryBufferCreateInfo emb_ci = { 0 };
+    emb_ci.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO;
+    emb_ci.handleTypes = trial->handle_type;
+
+    VkBufferCreateInfo b_ci = { 0 };
+    b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    b_ci.pNext = &emb_ci;
+    b_ci.pQueueFamilyIndices = &device->queue_family_indices[trial->queue_index];
+    b_ci.queueFamilyIndexCount = 1;
+    b_ci.size = FILE_UPLOAD_SIZE;
+    b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    b_ci.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    result = vkCreateBuffer(device->device, &b_ci, NULL, &source_buffer);
+    check_result(result, "Could not create buffer!");
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(device->device, source_buffer, &requirements);
+
+    uint32_t memory_type_bits = requirements.memoryTypeBits & pointer_properties.memoryTypeBits;
+    uint32_t memory_type_index = 0;
+
+    if (memory_type_bits == 0)
+    {
+        fatal_error("No memory type can hold the imported file!");
+    }
+
+    while (!(memory_type_bits & (1u << memory_type_index)))
+    {
+        memory_type_index++;
+    }
+
+    VkImportMemoryHostPointerInfoEXT import_info = { 0 };
+    import_info.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT;
+    import_info.handleType = trial->handle_type;
+    import_info.pHostPointer = mapped;
+
+    VkMemoryAllocateInfo m_ai = { 0 };
+    m_ai.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    m_ai.pNext = &import_info;
+    m_ai.allocationSize = FILE_UPLOAD_SIZE;
+    m_ai.memoryTypeIndex = memory_type_index;
+    uint64_t import_ticks = vkstats_stopwatch_get_ticks();
+    result = vkAllocateMemory(device->device, &m_ai, NULL, &memory);
+    vkstats_trace_host_event("allocation", "Import file mapping", import_ticks, vkstats_stopwatch_get_ticks(), FILE_UPLOAD_SIZE);
+    check_result(result, "Could not import file mapping!");
+
+    result = vkBindBufferMemory(device->device, source_buffer, memory, 0);
+    check_result(result, "Could not bind buffer memory!");
+
+    submit_copy(trial, 0, source_buffer, 0, 0, FILE_UPLOAD_SIZE);
+    vkstats_device_wait_semaphore(device, trial->semaphore, trial->semaphore_value);
+    results[0] = vkstats_stopwatch_stop(trial->stopwatch);
+
+    vkDestroyBuffer(device->device, source_buffer, NULL);
+    vkFreeMemory(device->device, memory, NULL);
+    vkstats_file_unmap(trial->file, mapped);
+}
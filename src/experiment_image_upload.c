@@ -0,0 +1,366 @@
+#include <stdio.h>
+
+#include "vulkan/vulkan.h"
+
+#include "config.h"
+#include "device.h"
+#include "util.h"
+#include "stopwatch.h"
+#include "harness.h"
+#include "memory_arena.h"
+#include "queue_timer.h"
+#include "trace.h"
+#include "experiments.h"
+
+#define IMAGE_SIZE_COUNT 3
+#define MAX_MIP_LEVELS 16
+
+typedef struct
+{
+    VkFormat        format;
+    const char*     name;
+    uint32_t        block_size;
+    uint32_t        block_extent;
+} image_format;
+
+/*
+* The formats to upload. Block compressed formats store block_size bytes per
+* block_extent x block_extent texels, the others are one texel per block.
+*/
+static const image_format image_formats[] =
+{
+    { VK_FORMAT_R8G8B8A8_UNORM, "RGBA8", 4, 1 },
+    { VK_FORMAT_BC7_UNORM_BLOCK, "BC7", 16, 4 },
+    { VK_FORMAT_R16_SFLOAT, "R16F", 2, 1 },
+    { VK_FORMAT_R32G32B32A32_SFLOAT, "RGBA32F", 16, 1 },
+};
+
+static const uint32_t image_sizes[IMAGE_SIZE_COUNT] = { 256, 1024, 2048 };
+
+typedef struct
+{
+    VkBufferImageCopy   regions[MAX_MIP_LEVELS];
+    uint32_t            mip_level_count;
+    VkDeviceSize        buffer_size;
+    uint64_t            bytes;
+    uint64_t            texels;
+} mip_chain_layout;
+
+static void get_mip_chain_layout(vkstats_device* device, const image_format* format, uint32_t size, mip_chain_layout* layout);
+static uint32_t get_image_memory_type(vkstats_device* device, uint32_t memory_type_bits);
+static void report_image_result(vkstats_harness* harness, const char* label, const vkstats_statistics* statistics, const mip_chain_layout* layout);
+
+void vkstats_experiment_image_upload(vkstats_device* device, uint32_t queue_index, vkstats_harness* harness)
+{
+    VkResult result;
+    VkPhysicalDevice physical_device = device->physical_device->physical_device;
+    VkExtent3D granularity = device->queue_family_properties[queue_index].minImageTransferGranularity;
+    VkBool32 format_supported[array_length(image_formats)];
+    mip_chain_layout layout;
+    VkDeviceSize staging_size = 0;
+    char label[96];
+
+    printf("\n");
+    printf("Running image upload experiment on queue %u (family %u).\n", queue_index, device->queue_family_indices[queue_index]);
+    vkstats_harness_begin_experiment(harness, "image_upload", device, queue_index);
+
+    /*
+    * Every copy covers a whole mip level from its origin, which satisfies any
+    * granularity, including 0x0x0 (whole mip levels only).
+    */
+    printf("Minimum image transfer granularity: %ux%ux%u\n", granularity.width, granularity.height, granularity.depth);
+
+    /*
+    * Only formats that optimal tiled images can be copied to and from in both
+    * directions at every size are run. BC7 needs textureCompressionBC, so it
+    * is commonly missing on mobile devices.
+    */
+    for (uint32_t i = 0; i < array_length(image_formats); i++)
+    {
+        VkFormatProperties format_properties;
+        VkImageFormatProperties image_format_properties;
+        VkFormatFeatureFlags required = VK_FORMAT_FEATURE_TRANSFER_SRC_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+
+        vkGetPhysicalDeviceFormatProperties(physical_device, image_formats[i].format, &format_properties);
+        result = vkGetPhysicalDeviceImageFormatProperties(physical_device, image_formats[i].format, VK_IMAGE_TYPE_2D, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 0, &image_format_properties);
+
+        format_supported[i] = (format_properties.optimalTilingFeatures & required) == required
+            && result == VK_SUCCESS
+            && image_format_properties.maxExtent.width >= image_sizes[IMAGE_SIZE_COUNT - 1]
+            && image_format_properties.maxExtent.height >= image_sizes[IMAGE_SIZE_COUNT - 1];
+
+        if (!format_supported[i])
+        {
+            printf("%s is not supported, skipping.\n", image_formats[i].name);
+            continue;
+        }
+
+        get_mip_chain_layout(device, &image_formats[i], image_sizes[IMAGE_SIZE_COUNT - 1], &layout);
+
+        if (layout.buffer_size > staging_size)
+        {
+            staging_size = layout.buffer_size;
+        }
+    }
+
+    if (staging_size == 0)
+    {
+        return;
+    }
+
+    /*
+    * One staging buffer, big enough for the largest mip chain, is used in
+    * both directions.
+    */
+    vkstats_memory_arena arena;
+    vkstats_memory_arena_init(&arena, device);
+
+    VkBufferCreateInfo b_ci = { 0 };
+    b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    b_ci.pQueueFamilyIndices = &device->queue_family_indices[queue_index];
+    b_ci.queueFamilyIndexCount = 1;
+    b_ci.size = staging_size;
+    b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    b_ci.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    vkstats_memory_arena_reserve(&arena, &b_ci, device->host_visible_memory_index);
+    vkstats_memory_arena_allocate(&arena);
+
+    VkBuffer staging_buffer;
+    result = vkCreateBuffer(device->device, &b_ci, NULL, &staging_buffer);
+    check_result(result, "Could not create buffer!");
+    vkstats_memory_arena_bind_buffer(&arena, staging_buffer, device->host_visible_memory_index);
+
+    vkstats_queue_timer timer;
+    vkstats_queue_timer_init(&timer, device, queue_index);
+
+    for (uint32_t i = 0; i < array_length(image_formats); i++)
+    {
+        const image_format* format = &image_formats[i];
+
+        if (!format_supported[i])
+        {
+            continue;
+        }
+
+        for (uint32_t j = 0; j < IMAGE_SIZE_COUNT; j++)
+        {
+            uint32_t size = image_sizes[j];
+
+            get_mip_chain_layout(device, format, size, &layout);
+
+            VkImageCreateInfo i_ci = { 0 };
+            i_ci.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            i_ci.imageType = VK_IMAGE_TYPE_2D;
+            i_ci.format = format->format;
+            i_ci.extent.width = size;
+            i_ci.extent.height = size;
+            i_ci.extent.depth = 1;
+            i_ci.mipLevels = layout.mip_level_count;
+            i_ci.arrayLayers = 1;
+            i_ci.samples = VK_SAMPLE_COUNT_1_BIT;
+            i_ci.tiling = VK_IMAGE_TILING_OPTIMAL;
+            i_ci.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+            i_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            i_ci.pQueueFamilyIndices = &device->queue_family_indices[queue_index];
+            i_ci.queueFamilyIndexCount = 1;
+            i_ci.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            VkImage image;
+            result = vkCreateImage(device->device, &i_ci, NULL, &image);
+            check_result(result, "Could not create image!");
+
+            VkMemoryRequirements requirements;
+            vkGetImageMemoryRequirements(device->device, image, &requirements);
+
+            VkMemoryAllocateInfo m_ai = { 0 };
+            m_ai.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            m_ai.allocationSize = requirements.size;
+            m_ai.memoryTypeIndex = get_image_memory_type(device, requirements.memoryTypeBits);
+
+            VkDeviceMemory memory;
+            uint64_t start_ticks = vkstats_stopwatch_get_ticks();
+            result = vkAllocateMemory(device->device, &m_ai, NULL, &memory);
+            vkstats_trace_host_event("allocation", "vkAllocateMemory", start_ticks, vkstats_stopwatch_get_ticks(), requirements.size);
+            check_result(result, "Could not allocate memory!");
+
+            result = vkBindImageMemory(device->device, image, memory, 0);
+            check_result(result, "Could not bind image memory!");
+
+            VkImageMemoryBarrier barrier = { 0 };
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = image;
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.levelCount = layout.mip_level_count;
+            barrier.subresourceRange.layerCount = 1;
+
+            uint32_t image_memory_type = m_ai.memoryTypeIndex;
+
+            /*
+            * Upload. The image starts every trial in the undefined layout,
+            * since its contents are overwritten, and ends it ready to be read
+            * back.
+            */
+            vkstats_queue_timer_begin(&timer);
+
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            vkCmdPipelineBarrier(timer.command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+            vkCmdCopyBufferToImage(timer.command_buffer, staging_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout.mip_level_count, layout.regions);
+
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            vkCmdPipelineBarrier(timer.command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+            vkstats_queue_timer_end(&timer);
+
+            vkstats_statistics statistics[2];
+
+            vkstats_harness_set_memory_types(harness, device->host_visible_memory_index, image_memory_type);
+            vkstats_harness_run(harness, vkstats_queue_timer_run, &timer, timer.metric_count, statistics);
+
+            snprintf(label, sizeof(label), "Upload %s %ux%u, %u mips", format->name, size, size, layout.mip_level_count);
+            report_image_result(harness, label, &statistics[timer.metric_count - 1], &layout);
+
+            /*
+            * Read back. The last upload left the image in the transfer source
+            * layout, and reading doesn't change it.
+            */
+            vkstats_queue_timer_begin(&timer);
+            vkCmdCopyImageToBuffer(timer.command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, staging_buffer, layout.mip_level_count, layout.regions);
+            vkstats_queue_timer_end(&timer);
+
+            vkstats_harness_set_memory_types(harness, image_memory_type, device->host_visible_memory_index);
+            vkstats_harness_run(harness, vkstats_queue_timer_run, &timer, timer.metric_count, statistics);
+
+            snprintf(label, sizeof(label), "Readback %s %ux%u, %u mips", format->name, size, size, layout.mip_level_count);
+            report_image_result(harness, label, &statistics[timer.metric_count - 1], &layout);
+
+            vkDestroyImage(device->device, image, NULL);
+            vkFreeMemory(device->device, memory, NULL);
+        }
+    }
+
+    vkstats_queue_timer_destroy(&timer);
+    vkDestroyBuffer(device->device, staging_buffer, NULL);
+    vkstats_memory_arena_destroy(&arena);
+}
+
+/*
+* get_mip_chain_layout()
+*
+* Lays out a full mip chain in a staging buffer. Each level starts at
+* optimalBufferCopyOffsetAlignment and each row at
+* optimalBufferCopyRowPitchAlignment, both rounded up to a whole block.
+*
+* device: the device the copies will run on.
+* format: the image format.
+* size: the width and height of the top mip level.
+* layout: the copy regions and sizes will be placed here.
+*/
+static void get_mip_chain_layout(vkstats_device* device, const image_format* format, uint32_t size, mip_chain_layout* layout)
+{
+    const VkPhysicalDeviceLimits* limits = &device->physical_device->properties.limits;
+    VkDeviceSize offset_alignment = limits->optimalBufferCopyOffsetAlignment;
+    VkDeviceSize row_pitch_alignment = limits->optimalBufferCopyRowPitchAlignment;
+    VkDeviceSize offset = 0;
+
+    /*
+    * Buffer offsets must also be a multiple of the block size and of 4. All of
+    * these are powers of two, so the largest is a multiple of the others.
+    */
+    if (offset_alignment < format->block_size)
+    {
+        offset_alignment = format->block_size;
+    }
+    if (offset_alignment < 4)
+    {
+        offset_alignment = 4;
+    }
+    if (row_pitch_alignment < format->block_size)
+    {
+        row_pitch_alignment = format->block_size;
+    }
+
+    clear_struct(layout);
+
+    for (uint32_t extent = size; extent > 0 && layout->mip_level_count < MAX_MIP_LEVELS; extent /= 2)
+    {
+        VkBufferImageCopy* region = &layout->regions[layout->mip_level_count];
+        uint32_t blocks = (extent + format->block_extent - 1) / format->block_extent;
+        VkDeviceSize row_pitch = align_up((VkDeviceSize)blocks * format->block_size, row_pitch_alignment);
+
+        offset = align_up(offset, offset_alignment);
+
+        region->bufferOffset = offset;
+        region->bufferRowLength = (uint32_t)(row_pitch / format->block_size) * format->block_extent;
+        region->bufferImageHeight = 0;
+        region->imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region->imageSubresource.mipLevel = layout->mip_level_count;
+        region->imageSubresource.layerCount = 1;
+        region->imageExtent.width = extent;
+        region->imageExtent.height = extent;
+        region->imageExtent.depth = 1;
+
+        offset += row_pitch * blocks;
+        layout->bytes += (uint64_t)blocks * blocks * format->block_size;
+        layout->texels += (uint64_t)extent * extent;
+        layout->mip_level_count++;
+    }
+
+    layout->buffer_size = offset;
+}
+
+/*
+* get_image_memory_type()
+*
+* Picks a device-local memory type for an image.
+*
+* device: the device the image was created on.
+* memory_type_bits: the memory types the image supports.
+*
+* Returns the memory type index.
+*/
+static uint32_t get_image_memory_type(vkstats_device* device, uint32_t memory_type_bits)
+{
+    VkPhysicalDeviceMemoryProperties* memory_properties = &device->physical_device->memory_properties;
+
+    if (memory_type_bits & (1u << device->device_local_memory_index))
+    {
+        return device->device_local_memory_index;
+    }
+
+    for (uint32_t i = 0; i < memory_properties->memoryTypeCount; i++)
+    {
+        if ((memory_type_bits & (1u << i)) && (memory_properties->memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+        {
+            return i;
+        }
+    }
+
+    fatal_error("Could not find a memory type for the image!");
+    return UINT_MAX;
+}
+
+/*
+* report_image_result()
+*
+* Reports the bandwidth of an image copy, and prints its texel rate at the
+* median.
+*
+* harness: the harness to report with.
+* label: describes the copy.
+* statistics: time statistics, in milliseconds.
+* layout: the mip chain that was copied.
+*/
+static void report_image_result(vkstats_harness* harness, const char* label, const vkstats_statistics* statistics, const mip_chain_layout* layout)
+{
+    vkstats_harness_report_bandwidth(harness, label, statistics, layout->bytes);
+    printf("%s: median %.2f Gtexels/s\n", label, vkstats_get_bandwidth(layout->texels, statistics->median));
+}
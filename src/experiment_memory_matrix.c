@@ -0,0 +1,280 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "vulkan/vulkan.h"
+
+#include "config.h"
+#include "device.h"
+#include "util.h"
+#include "stopwatch.h"
+#include "harness.h"
+#include "memory_arena.h"
+#include "experiments.h"
+
+#define MATRIX_SIZE_COUNT 4
+
+/*
+* Memory property flags the matrix knows how to allocate from. Types with any
+* other flag (protected, lazily allocated, vendor extensions) are skipped.
+*/
+#define MATRIX_MEMORY_FLAGS (VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT)
+
+static const VkDeviceSize matrix_sizes[MATRIX_SIZE_COUNT] =
+{
+    UINT64_C(64) * UINT64_C(1024),
+    UINT64_C(1024) * UINT64_C(1024),
+    UINT64_C(16) * UINT64_C(1024) * UINT64_C(1024),
+    UINT64_C(64) * UINT64_C(1024) * UINT64_C(1024),
+};
+
+typedef struct
+{
+    vkstats_device*     device;
+    uint32_t            queue_index;
+    VkCommandBuffer     command_buffer;
+    VkSemaphore         semaphore;
+    uint64_t            semaphore_value;
+    vkstats_stopwatch*  stopwatch;
+} copy_trial;
+
+static void run_copy_trial(void* context, double* results);
+static void format_memory_flags(VkMemoryPropertyFlags flags, char* text, size_t text_size);
+
+void vkstats_experiment_memory_type_matrix(vkstats_device* device, uint32_t queue_index, vkstats_harness* harness)
+{
+    VkPhysicalDeviceMemoryProperties* memory_properties = &device->physical_device->memory_properties;
+    double bandwidths[MATRIX_SIZE_COUNT][VK_MAX_MEMORY_TYPES][VK_MAX_MEMORY_TYPES];
+    uint32_t types[VK_MAX_MEMORY_TYPES];
+    uint32_t type_count = 0;
+    VkMemoryRequirements source_requirements;
+    VkMemoryRequirements destination_requirements;
+    VkBuffer buffer;
+    char flags_text[64];
+    char label[64];
+
+    vkstats_stopwatch stopwatch;
+    vkstats_stopwatch_init(&stopwatch);
+
+    printf("\n");
+    printf("Running memory type transfer matrix experiment on queue %u (family %u).\n", queue_index, device->queue_family_indices[queue_index]);
+    vkstats_harness_begin_experiment(harness, "memory_type_matrix", device, queue_index);
+
+    /*
+    * Find out which memory types transfer buffers can live in.
+    */
+    buffer = vkstats_device_create_buffer(device, matrix_sizes[MATRIX_SIZE_COUNT - 1], VK_BUFFER_USAGE_TRANSFER_SRC_BIT, queue_index);
+    vkGetBufferMemoryRequirements(device->device, buffer, &source_requirements);
+    vkDestroyBuffer(device->device, buffer, NULL);
+
+    buffer = vkstats_device_create_buffer(device, matrix_sizes[MATRIX_SIZE_COUNT - 1], VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue_index);
+    vkGetBufferMemoryRequirements(device->device, buffer, &destination_requirements);
+    vkDestroyBuffer(device->device, buffer, NULL);
+
+    printf("Memory types:\n");
+
+    for (uint32_t i = 0; i < memory_properties->memoryTypeCount; i++)
+    {
+        VkMemoryType* memory_type = &memory_properties->memoryTypes[i];
+
+        if (!((source_requirements.memoryTypeBits | destination_requirements.memoryTypeBits) & (1u << i))
+            || (memory_type->propertyFlags & ~MATRIX_MEMORY_FLAGS)
+            || memory_type->propertyFlags == 0)
+        {
+            continue;
+        }
+
+        format_memory_flags(memory_type->propertyFlags, flags_text, sizeof(flags_text));
+        printf("  %2u: heap %u, %s\n", i, memory_type->heapIndex, flags_text);
+        types[type_count] = i;
+        type_count++;
+    }
+
+    printf("\n");
+
+    copy_trial trial;
+    clear_struct(&trial);
+    trial.device = device;
+    trial.queue_index = queue_index;
+    trial.command_buffer = vkstats_device_allocate_command_buffer(device, queue_index);
+    trial.semaphore = vkstats_device_create_timeline_semaphore(device);
+    trial.stopwatch = &stopwatch;
+
+    VkCommandBufferBeginInfo cb_bi = { 0 };
+    cb_bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    for (uint32_t i = 0; i < type_count; i++)
+    {
+        for (uint32_t j = 0; j < type_count; j++)
+        {
+            uint32_t source_type = types[i];
+            uint32_t destination_type = types[j];
+
+            for (uint32_t k = 0; k < MATRIX_SIZE_COUNT; k++)
+            {
+                bandwidths[k][i][j] = -1.0;
+            }
+
+            if (!(source_requirements.memoryTypeBits & (1u << source_type)) || !(destination_requirements.memoryTypeBits & (1u << destination_type)))
+            {
+                continue;
+            }
+
+            /*
+            * Allocate once per pair and rebind every size to the start of
+            * the arena.
+            */
+            vkstats_memory_arena arena;
+            vkstats_memory_arena_init(&arena, device);
+
+            VkBufferCreateInfo b_ci = { 0 };
+            b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            b_ci.pQueueFamilyIndices = &device->queue_family_indices[queue_index];
+            b_ci.queueFamilyIndexCount = 1;
+            b_ci.size = matrix_sizes[MATRIX_SIZE_COUNT - 1];
+            b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            b_ci.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+            vkstats_memory_arena_reserve(&arena, &b_ci, source_type);
+            b_ci.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+            vkstats_memory_arena_reserve(&arena, &b_ci, destination_type);
+            vkstats_memory_arena_allocate(&arena);
+
+            vkstats_harness_set_memory_types(harness, source_type, destination_type);
+
+            for (uint32_t k = 0; k < MATRIX_SIZE_COUNT; k++)
+            {
+                VkBuffer source_buffer = vkstats_device_create_buffer(device, matrix_sizes[k], VK_BUFFER_USAGE_TRANSFER_SRC_BIT, queue_index);
+                VkBuffer destination_buffer = vkstats_device_create_buffer(device, matrix_sizes[k], VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue_index);
+
+                vkstats_memory_arena_reset(&arena);
+                vkstats_memory_arena_bind_buffer(&arena, source_buffer, source_type);
+                vkstats_memory_arena_bind_buffer(&arena, destination_buffer, destination_type);
+
+                VkBufferCopy buffer_copy = { 0 };
+                buffer_copy.size = matrix_sizes[k];
+
+                vkBeginCommandBuffer(trial.command_buffer, &cb_bi);
+                vkCmdCopyBuffer(trial.command_buffer, source_buffer, destination_buffer, 1, &buffer_copy);
+                vkEndCommandBuffer(trial.command_buffer);
+
+                vkstats_statistics statistics;
+                vkstats_harness_run(harness, run_copy_trial, &trial, 1, &statistics);
+                bandwidths[k][i][j] = vkstats_get_bandwidth(matrix_sizes[k], statistics.median);
+
+                snprintf(label, sizeof(label), "Copy %" PRIu64 " bytes", matrix_sizes[k]);
+                vkstats_harness_record(harness, label, &statistics, matrix_sizes[k]);
+
+                vkDestroyBuffer(device->device, source_buffer, NULL);
+                vkDestroyBuffer(device->device, destination_buffer, NULL);
+            }
+
+            vkstats_memory_arena_destroy(&arena);
+        }
+    }
+
+    /*
+    * One matrix per size. Rows are the source memory type, columns the
+    * destination, in median GB/s.
+    */
+    for (uint32_t k = 0; k < MATRIX_SIZE_COUNT; k++)
+    {
+        printf("%" PRIu64 " bytes, GB/s (rows: source type, columns: destination type)\n", matrix_sizes[k]);
+        printf("      ");
+
+        for (uint32_t j = 0; j < type_count; j++)
+        {
+            printf("%8u", types[j]);
+        }
+
+        printf("\n");
+
+        for (uint32_t i = 0; i < type_count; i++)
+        {
+            printf("  %2u  ", types[i]);
+
+            for (uint32_t j = 0; j < type_count; j++)
+            {
+                if (bandwidths[k][i][j] < 0.0)
+                {
+                    printf("%8s", "-");
+                }
+                else
+                {
+                    printf("%8.2f", bandwidths[k][i][j]);
+                }
+            }
+
+            printf("\n");
+        }
+
+        printf("\n");
+    }
+
+    vkFreeCommandBuffers(device->device, device->command_pools[queue_index], 1, &trial.command_buffer);
+    vkDestroySemaphore(device->device, trial.semaphore, NULL);
+}
+
+/*
+* run_copy_trial()
+*
+* Submits the recorded copy and waits for it to complete.
+*
+* context: a copy_trial.
+* results: the time from submission to completion.
+*/
+static void run_copy_trial(void* context, double* results)
+{
+    copy_trial* trial = context;
+
+    trial->semaphore_value++;
+
+    VkTimelineSemaphoreSubmitInfo ts_si = { 0 };
+    ts_si.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    ts_si.pSignalSemaphoreValues = &trial->semaphore_value;
+    ts_si.signalSemaphoreValueCount = 1;
+
+    VkSubmitInfo si = { 0 };
+    si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    si.pNext = &ts_si;
+    si.pCommandBuffers = &trial->command_buffer;
+    si.commandBufferCount = 1;
+    si.pSignalSemaphores = &trial->semaphore;
+    si.signalSemaphoreCount = 1;
+
+    vkDeviceWaitIdle(trial->device->device);
+    vkstats_stopwatch_start(trial->stopwatch);
+    vkstats_device_submit(trial->device, trial->queue_index, &si, 0);
+    vkstats_device_wait_semaphore(trial->device, trial->semaphore, trial->semaphore_value);
+    results[0] = vkstats_stopwatch_stop(trial->stopwatch);
+}
+
+/*
+* format_memory_flags()
+*
+* Describes memory property flags as text.
+*
+* flags: the flags to describe.
+* text: the description will be placed here.
+* text_size: the size of the text buffer.
+*/
+static void format_memory_flags(VkMemoryPropertyFlags flags, char* text, size_t text_size)
+{
+    text[0] = '\0';
+
+    if (flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+    {
+        strncat(text, "device-local ", text_size - strlen(text) - 1);
+    }
+    if (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        strncat(text, "host-visible ", text_size - strlen(text) - 1);
+    }
+    if (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
+    {
+        strncat(text, "host-coherent ", text_size - strlen(text) - 1);
+    }
+    if (flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT)
+    {
+        strncat(text, "host-cached ", text_size - strlen(text) - 1);
+    }
+}
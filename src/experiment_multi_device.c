@@ -0,0 +1,252 @@
+#include <stdio.h>
+
+#include "vulkan/vulkan.h"
+
+#include "config.h"
+#include "device.h"
+#include "util.h"
+#include "stopwatch.h"
+#include "harness.h"
+#include "memory_arena.h"
+#include "thread.h"
+#include "experiments.h"
+
+#define MULTI_DEVICE_COPY_SIZE (UINT64_C(128) * UINT64_C(1024) * UINT64_C(1024))
+
+/*
+* One metric is the aggregate, the rest are one per device.
+*/
+#define MAX_MULTI_DEVICES (MAX_METRICS - 1)
+
+typedef struct
+{
+    vkstats_device*         device;
+    uint32_t                queue_index;
+    vkstats_memory_arena    arena;
+    VkBuffer                source_buffer;
+    VkBuffer                destination_buffer;
+    VkCommandBuffer         command_buffer;
+    VkSemaphore             start_semaphore;
+    uint64_t                start_value;
+    VkSemaphore             done_semaphore;
+    uint64_t                done_value;
+    vkstats_barrier*        barrier;
+    uint64_t                end_ticks;
+    vkstats_thread          thread;
+} device_worker;
+
+typedef struct
+{
+    device_worker           workers[MAX_MULTI_DEVICES];
+    uint32_t                active_count;
+} multi_device_trial;
+
+static void run_multi_device_trial(void* context, double* results);
+static void run_device_worker(void* context);
+
+void vkstats_experiment_multi_device_transfer(vkstats_device** devices, uint32_t device_count, uint32_t queue_index, vkstats_harness* harness)
+{
+    char label[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE + 64];
+
+    printf("\n");
+    printf("Running multi-device transfer experiment on queue %u of every device.\n", queue_index);
+    vkstats_harness_begin_experiment(harness, "multi_device_transfer", NULL, queue_index);
+
+    if (device_count > MAX_MULTI_DEVICES)
+    {
+        printf("Only the first %u devices take part.\n", MAX_MULTI_DEVICES);
+        device_count = MAX_MULTI_DEVICES;
+    }
+
+    printf("\n");
+
+    multi_device_trial trial;
+    clear_struct(&trial);
+
+    /*
+    * Every device gets its own buffers, command buffer and semaphores.
+    * Semaphores can't be shared between devices, so each device is released
+    * by its own host signal, issued back to back.
+    */
+    VkCommandBufferBeginInfo cb_bi = { 0 };
+    cb_bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+    for (uint32_t i = 0; i < device_count; i++)
+    {
+        device_worker* worker = &trial.workers[i];
+        vkstats_device* device = devices[i];
+
+        worker->device = device;
+        worker->queue_index = queue_index;
+        worker->start_semaphore = vkstats_device_create_timeline_semaphore(device);
+        worker->done_semaphore = vkstats_device_create_timeline_semaphore(device);
+
+        vkstats_memory_arena_init(&worker->arena, device);
+
+        VkBufferCreateInfo b_ci = { 0 };
+        b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        b_ci.pQueueFamilyIndices = &device->queue_family_indices[queue_index];
+        b_ci.queueFamilyIndexCount = 1;
+        b_ci.size = MULTI_DEVICE_COPY_SIZE;
+        b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        b_ci.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        vkstats_memory_arena_reserve(&worker->arena, &b_ci, device->host_visible_memory_index);
+        b_ci.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        vkstats_memory_arena_reserve(&worker->arena, &b_ci, device->device_local_memory_index);
+        vkstats_memory_arena_allocate(&worker->arena);
+
+        worker->source_buffer = vkstats_device_create_buffer(device, MULTI_DEVICE_COPY_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, queue_index);
+        worker->destination_buffer = vkstats_device_create_buffer(device, MULTI_DEVICE_COPY_SIZE, VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue_index);
+        vkstats_memory_arena_bind_buffer(&worker->arena, worker->source_buffer, device->host_visible_memory_index);
+        vkstats_memory_arena_bind_buffer(&worker->arena, worker->destination_buffer, device->device_local_memory_index);
+
+        worker->command_buffer = vkstats_device_allocate_command_buffer(device, queue_index);
+
+        VkBufferCopy buffer_copy = { 0 };
+        buffer_copy.size = MULTI_DEVICE_COPY_SIZE;
+
+        vkBeginCommandBuffer(worker->command_buffer, &cb_bi);
+        vkCmdCopyBuffer(worker->command_buffer, worker->source_buffer, worker->destination_buffer, 1, &buffer_copy);
+        vkEndCommandBuffer(worker->command_buffer);
+    }
+
+    for (uint32_t active_count = 1; active_count <= device_count; active_count++)
+    {
+        vkstats_statistics statistics[MAX_METRICS];
+
+        trial.active_count = active_count;
+        vkstats_harness_run(harness, run_multi_device_trial, &trial, active_count + 1, statistics);
+
+        printf("%u active device(s):\n", active_count);
+
+        for (uint32_t i = 0; i < active_count; i++)
+        {
+            snprintf(label, sizeof(label), "  Device %u (%s), %u active", i, devices[i]->physical_device->properties.deviceName, active_count);
+            vkstats_harness_report_bandwidth(harness, label, &statistics[i + 1], MULTI_DEVICE_COPY_SIZE);
+        }
+
+        snprintf(label, sizeof(label), "  Aggregate, %u active", active_count);
+        vkstats_harness_report_bandwidth(harness, label, &statistics[0], MULTI_DEVICE_COPY_SIZE * active_count);
+    }
+
+    for (uint32_t i = 0; i < device_count; i++)
+    {
+        device_worker* worker = &trial.workers[i];
+        vkstats_device* device = worker->device;
+
+        vkFreeCommandBuffers(device->device, device->command_pools[queue_index], 1, &worker->command_buffer);
+        vkDestroyBuffer(device->device, worker->source_buffer, NULL);
+        vkDestroyBuffer(device->device, worker->destination_buffer, NULL);
+        vkstats_memory_arena_destroy(&worker->arena);
+        vkDestroySemaphore(device->device, worker->start_semaphore, NULL);
+        vkDestroySemaphore(device->device, worker->done_semaphore, NULL);
+    }
+}
+
+/*
+* run_multi_device_trial()
+*
+* Starts a thread per active device, waits for all of them to submit their
+* copy, then releases every device as close together as possible.
+*
+* context: a multi_device_trial.
+* results: the time until the last device finished, followed by the time each
+*          device took.
+*/
+static void run_multi_device_trial(void* context, double* results)
+{
+    VkResult result;
+    multi_device_trial* trial = context;
+    vkstats_barrier barrier;
+    uint64_t start_ticks;
+    double frequency = vkstats_stopwatch_get_frequency();
+
+    for (uint32_t i = 0; i < trial->active_count; i++)
+    {
+        vkDeviceWaitIdle(trial->workers[i].device->device);
+    }
+
+    vkstats_barrier_init(&barrier, trial->active_count + 1);
+
+    for (uint32_t i = 0; i < trial->active_count; i++)
+    {
+        device_worker* worker = &trial->workers[i];
+
+        worker->start_value++;
+        worker->done_value++;
+        worker->barrier = &barrier;
+        vkstats_thread_create(&worker->thread, run_device_worker, worker);
+    }
+
+    vkstats_barrier_wait(&barrier);
+
+    start_ticks = vkstats_stopwatch_get_ticks();
+
+    for (uint32_t i = 0; i < trial->active_count; i++)
+    {
+        device_worker* worker = &trial->workers[i];
+
+        VkSemaphoreSignalInfo s_si = { 0 };
+        s_si.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+        s_si.value = worker->start_value;
+        s_si.semaphore = worker->start_semaphore;
+
+        result = vkSignalSemaphore(worker->device->device, &s_si);
+        check_result(result, "Could not signal semaphore!");
+    }
+
+    results[0] = 0.0;
+
+    for (uint32_t i = 0; i < trial->active_count; i++)
+    {
+        device_worker* worker = &trial->workers[i];
+
+        vkstats_thread_join(&worker->thread);
+        results[i + 1] = (double)(worker->end_ticks - start_ticks) / frequency * 1000.0;
+
+        if (results[i + 1] > results[0])
+        {
+            results[0] = results[i + 1];
+        }
+    }
+
+    vkstats_barrier_destroy(&barrier);
+}
+
+/*
+* run_device_worker()
+*
+* Host thread for one device. Submits the device's copy behind its start
+* semaphore, then waits for it to complete and records when it did.
+*
+* context: a device_worker.
+*/
+static void run_device_worker(void* context)
+{
+    device_worker* worker = context;
+
+    VkTimelineSemaphoreSubmitInfo ts_si = { 0 };
+    ts_si.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    ts_si.pWaitSemaphoreValues = &worker->start_value;
+    ts_si.waitSemaphoreValueCount = 1;
+    ts_si.pSignalSemaphoreValues = &worker->done_value;
+    ts_si.signalSemaphoreValueCount = 1;
+
+    VkPipelineStageFlags wait_destination_stage_mask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    VkSubmitInfo si = { 0 };
+    si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    si.pNext = &ts_si;
+    si.pCommandBuffers = &worker->command_buffer;
+    si.commandBufferCount = 1;
+    si.pWaitSemaphores = &worker->start_semaphore;
+    si.waitSemaphoreCount = 1;
+    si.pSignalSemaphores = &worker->done_semaphore;
+    si.signalSemaphoreCount = 1;
+    si.pWaitDstStageMask = &wait_destination_stage_mask;
+
+    vkstats_device_submit(worker->device, worker->queue_index, &si, MULTI_DEVICE_COPY_SIZE);
+
+    vkstats_barrier_wait(worker->barrier);
+    vkstats_device_wait_semaphore(worker->device, worker->done_semaphore, worker->done_value);
+    worker->end_ticks = vkstats_stopwatch_get_ticks();
+}
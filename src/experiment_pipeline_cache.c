@@ -0,0 +1,603 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vulkan/vulkan.h"
+
+#include "config.h"
+#include "device.h"
+#include "file.h"
+#include "util.h"
+#include "stopwatch.h"
+#include "harness.h"
+#include "compute_kernel.h"
+#include "process.h"
+#include "thread.h"
+#include "trace.h"
+#include "experiments.h"
+
+/*
+* The corpus is every kernel at every workgroup size the device allows.
+*/
+#define MIN_CORPUS_WORKGROUP_SIZE 32
+#define MAX_CORPUS_WORKGROUP_SIZE 1024
+#define MAX_CORPUS_WORKGROUP_SIZES 6
+#define MAX_CORPUS_SIZE (VKSTATS_COMPUTE_KERNEL_COUNT * MAX_CORPUS_WORKGROUP_SIZES)
+
+/*
+* Passed to the child process instead of a cache file to build the corpus
+* without one.
+*/
+#define NO_CACHE_PATH "-"
+
+typedef struct
+{
+    vkstats_device*         device;
+    vkstats_compute_kernel  kernels[VKSTATS_COMPUTE_KERNEL_COUNT];
+    uint32_t                workgroup_sizes[MAX_CORPUS_WORKGROUP_SIZES];
+    uint32_t                workgroup_size_count;
+    uint32_t                pipeline_count;
+    VkPipeline              pipelines[MAX_CORPUS_SIZE];
+} pipeline_corpus;
+
+typedef struct
+{
+    pipeline_corpus*    corpus;
+    VkPipelineCache     pipeline_cache;
+    uint32_t            first;
+    uint32_t            count;
+    vkstats_barrier*    barrier;
+    uint64_t            start_ticks;
+    uint64_t            end_ticks;
+    vkstats_thread      thread;
+} pipeline_worker;
+
+typedef struct
+{
+    pipeline_corpus*    corpus;
+    VkPipelineCache     pipeline_cache;
+    uint32_t            thread_count;
+    pipeline_worker     workers[MAX_THREADS];
+} pipeline_trial;
+
+typedef struct
+{
+    const char*         arguments[MAX_PROCESS_ARGUMENTS];
+    uint32_t            argument_count;
+    const char*         result_path;
+} child_trial;
+
+static void corpus_create(pipeline_corpus* corpus, vkstats_device* device);
+static void corpus_build(pipeline_corpus* corpus, VkPipelineCache pipeline_cache, uint32_t first, uint32_t count);
+static void corpus_release(pipeline_corpus* corpus);
+static void corpus_destroy(pipeline_corpus* corpus);
+static VkPipelineCache load_pipeline_cache(vkstats_device* device, const char* path);
+static VkBool32 save_pipeline_cache(vkstats_device* device, VkPipelineCache pipeline_cache, const char* path);
+static uint32_t get_physical_device_index(vkstats_device* device);
+static void run_pipeline_trial(void* context, double* results);
+static void run_pipeline_worker(void* context);
+static void run_child_trial(void* context, double* results);
+
+void vkstats_experiment_pipeline_cache(vkstats_device* device, vkstats_harness* harness)
+{
+    VkResult result;
+    char label[64];
+    char name[64];
+    char cache_path[VKSTATS_FILE_MAX_PATH];
+    char result_path[VKSTATS_FILE_MAX_PATH];
+    char device_index[16];
+    vkstats_statistics statistics;
+
+    printf("\n");
+    printf("Running pipeline cache experiment.\n");
+    vkstats_harness_begin_experiment(harness, "pipeline_cache", device, VKSTATS_NO_QUEUE);
+    vkstats_harness_set_memory_types(harness, VKSTATS_NO_MEMORY_TYPE, VKSTATS_NO_MEMORY_TYPE);
+
+    pipeline_corpus corpus;
+    corpus_create(&corpus, device);
+    printf("Corpus of %u compute pipelines.\n", corpus.pipeline_count);
+    printf("Drivers may keep their own shader caches, so cold numbers are a lower bound.\n\n");
+
+    pipeline_trial trial;
+    clear_struct(&trial);
+    trial.corpus = &corpus;
+    trial.thread_count = 1;
+
+    /*
+    * Without a cache, then with a cache the warmup runs have already filled.
+    */
+    trial.pipeline_cache = VK_NULL_HANDLE;
+    vkstats_harness_run(harness, run_pipeline_trial, &trial, 1, &statistics);
+    vkstats_harness_report(harness, "Cold", &statistics);
+    double cold_time = statistics.median;
+
+    VkPipelineCacheCreateInfo pc_ci = { 0 };
+    pc_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    result = vkCreatePipelineCache(device->device, &pc_ci, NULL, &trial.pipeline_cache);
+    check_result(result, "Could not create pipeline cache!");
+
+    vkstats_harness_run(harness, run_pipeline_trial, &trial, 1, &statistics);
+    vkstats_harness_report(harness, "In-memory cache", &statistics);
+    printf("  %.2fx faster than cold\n", cold_time / statistics.median);
+
+    /*
+    * The cache is written to disk and a fresh copy of vkstats loads it, so
+    * nothing the driver kept in memory can help. A fresh process without
+    * the cache is the baseline.
+    */
+    uint32_t physical_device_index = get_physical_device_index(device);
+    snprintf(name, sizeof(name), "vkstats_pipeline_cache_%u.bin", physical_device_index);
+    vkstats_file_get_temp_path(cache_path, name);
+    snprintf(name, sizeof(name), "vkstats_pipeline_result_%u.txt", physical_device_index);
+    vkstats_file_get_temp_path(result_path, name);
+    snprintf(device_index, sizeof(device_index), "%u", physical_device_index);
+    VkBool32 cache_saved = save_pipeline_cache(device, trial.pipeline_cache, cache_path);
+
+    child_trial child;
+    clear_struct(&child);
+    child.arguments[0] = "--device";
+    child.arguments[1] = device_index;
+    child.arguments[2] = "--pipeline-cache-load";
+    child.arguments[4] = "--pipeline-cache-result";
+    child.arguments[5] = result_path;
+    child.argument_count = 6;
+    child.result_path = result_path;
+
+    int exit_code;
+    child.arguments[3] = NO_CACHE_PATH;
+
+    if (!cache_saved)
+    {
+        printf("Could not write %s, skipping the disk cache.\n", cache_path);
+    }
+    else if (vkstats_process_run_self(child.arguments, child.argument_count, &exit_code) && exit_code == 0)
+    {
+        vkstats_harness_run(harness, run_child_trial, &child, 1, &statistics);
+        vkstats_harness_report(harness, "Cold, fresh process", &statistics);
+        double fresh_cold_time = statistics.median;
+
+        child.arguments[3] = cache_path;
+        vkstats_harness_run(harness, run_child_trial, &child, 1, &statistics);
+        vkstats_harness_report(harness, "Disk cache, fresh process", &statistics);
+        printf("  %.2fx faster than cold\n", fresh_cold_time / statistics.median);
+    }
+    else
+    {
+        printf("Could not start a fresh process, skipping the disk cache.\n");
+    }
+
+    remove(cache_path);
+    remove(result_path);
+
+    /*
+    * The corpus split across threads, without a cache and with the filled
+    * one, which is internally synchronized.
+    */
+    uint32_t max_thread_count = vkstats_get_cpu_count();
+
+    if (max_thread_count > MAX_THREADS)
+    {
+        max_thread_count = MAX_THREADS;
+    }
+
+    if (max_thread_count > corpus.pipeline_count)
+    {
+        max_thread_count = corpus.pipeline_count;
+    }
+
+    VkPipelineCache pipeline_cache = trial.pipeline_cache;
+
+    printf("\n");
+    printf("Parallel creation:\n");
+    printf("%8s %12s %10s %12s %10s\n", "Threads", "Cold ms", "Scaling", "Cached ms", "Scaling");
+
+    double single_times[2] = { 0 };
+
+    for (uint32_t thread_count = 1; thread_count <= max_thread_count; thread_count *= 2)
+    {
+        double times[2];
+
+        trial.thread_count = thread_count;
+
+        for (uint32_t i = 0; i < 2; i++)
+        {
+            trial.pipeline_cache = i == 0 ? VK_NULL_HANDLE : pipeline_cache;
+            vkstats_harness_run(harness, run_pipeline_trial, &trial, 1, &statistics);
+
+            snprintf(label, sizeof(label), "%s, %u threads", i == 0 ? "Cold" : "In-memory cache", thread_count);
+            vkstats_harness_record(harness, label, &statistics, 0);
+
+            times[i] = statistics.median;
+
+            if (thread_count == 1)
+            {
+                single_times[i] = times[i];
+            }
+        }
+
+        printf("%8u %12.3f %9.2fx %12.3f %9.2fx\n", thread_count, times[0], single_times[0] / times[0], times[1], single_times[1] / times[1]);
+    }
+
+    vkDestroyPipelineCache(device->device, pipeline_cache, NULL);
+    corpus_destroy(&corpus);
+}
+
+void vkstats_experiment_pipeline_cache_child(vkstats_device* device, const char* cache_path, const char* result_path)
+{
+    pipeline_corpus corpus;
+    corpus_create(&corpus, device);
+
+    uint64_t start_ticks = vkstats_stopwatch_get_ticks();
+    VkPipelineCache pipeline_cache = strcmp(cache_path, NO_CACHE_PATH) == 0 ? VK_NULL_HANDLE : load_pipeline_cache(device, cache_path);
+    corpus_build(&corpus, pipeline_cache, 0, corpus.pipeline_count);
+    uint64_t end_ticks = vkstats_stopwatch_get_ticks();
+
+    FILE* file = fopen(result_path, "w");
+
+    if (file == NULL)
+    {
+        fatal_error("Could not open pipeline cache result file!");
+    }
+
+    fprintf(file, "%.9f\n", (double)(end_ticks - start_ticks) / vkstats_stopwatch_get_frequency() * 1000.0);
+    fclose(file);
+
+    corpus_release(&corpus);
+
+    if (pipeline_cache != VK_NULL_HANDLE)
+    {
+        vkDestroyPipelineCache(device->device, pipeline_cache, NULL);
+    }
+
+    corpus_destroy(&corpus);
+}
+
+/*
+* corpus_create()
+*
+* Creates the shader and layouts of every kernel type, which the corpus
+* pipelines share, and picks the workgroup sizes the device supports. No
+* pipeline is compiled here, so nothing warms the driver's caches before the
+* corpus is timed.
+*
+* corpus: the corpus to create.
+* device: the device to create it on.
+*/
+static void corpus_create(pipeline_corpus* corpus, vkstats_device* device)
+{
+    const VkPhysicalDeviceLimits* limits = &device->physical_device->properties.limits;
+
+    clear_struct(corpus);
+    corpus->device = device;
+
+    for (uint32_t i = 0; i < VKSTATS_COMPUTE_KERNEL_COUNT; i++)
+    {
+        vkstats_compute_kernel_create_shader(&corpus->kernels[i], device, (vkstats_compute_kernel_type)i);
+    }
+
+    for (uint32_t size = MIN_CORPUS_WORKGROUP_SIZE; size <= MAX_CORPUS_WORKGROUP_SIZE; size *= 2)
+    {
+        if (size <= limits->maxComputeWorkGroupSize[0] && size <= limits->maxComputeWorkGroupInvocations)
+        {
+            corpus->workgroup_sizes[corpus->workgroup_size_count] = size;
+            corpus->workgroup_size_count++;
+        }
+    }
+
+    corpus->pipeline_count = VKSTATS_COMPUTE_KERNEL_COUNT * corpus->workgroup_size_count;
+}
+
+/*
+* corpus_build()
+*
+* Creates part of the corpus, one vkCreateComputePipelines call per
+* pipeline, the way pipelines trickle in while an application loads.
+*
+* corpus: the corpus to build.
+* pipeline_cache: the cache to create the pipelines with, or VK_NULL_HANDLE.
+* first: the index of the first pipeline to create.
+* count: the number of pipelines to create.
+*/
+static void corpus_build(pipeline_corpus* corpus, VkPipelineCache pipeline_cache, uint32_t first, uint32_t count)
+{
+    for (uint32_t i = first; i < first + count; i++)
+    {
+        const vkstats_compute_kernel* kernel = &corpus->kernels[i / corpus->workgroup_size_count];
+        uint32_t workgroup_size = corpus->workgroup_sizes[i % corpus->workgroup_size_count];
+
+        corpus->pipelines[i] = vkstats_compute_kernel_create_pipeline(kernel, workgroup_size, pipeline_cache);
+    }
+}
+
+/*
+* corpus_release()
+*
+* Destroys the pipelines of the corpus, keeping the kernels.
+*
+* corpus: the corpus to release the pipelines of.
+*/
+static void corpus_release(pipeline_corpus* corpus)
+{
+    for (uint32_t i = 0; i < corpus->pipeline_count; i++)
+    {
+        vkDestroyPipeline(corpus->device->device, corpus->pipelines[i], NULL);
+        corpus->pipelines[i] = VK_NULL_HANDLE;
+    }
+}
+
+/*
+* corpus_destroy()
+*
+* Destroys the kernels of the corpus. The pipelines must already have been
+* released.
+*
+* corpus: the corpus to destroy.
+*/
+static void corpus_destroy(pipeline_corpus* corpus)
+{
+    for (uint32_t i = 0; i < VKSTATS_COMPUTE_KERNEL_COUNT; i++)
+    {
+        vkstats_compute_kernel_destroy(&corpus->kernels[i]);
+    }
+}
+
+/*
+* load_pipeline_cache()
+*
+* Reads a cache file written by save_pipeline_cache() and creates a
+* pipeline cache from it.
+*
+* device: the device to create the cache on.
+* path: the path of the cache file.
+*
+* Returns the pipeline cache.
+*/
+static VkPipelineCache load_pipeline_cache(vkstats_device* device, const char* path)
+{
+    VkResult result;
+    VkPipelineCache pipeline_cache;
+    FILE* file = fopen(path, "rb");
+    void* data;
+    long size;
+
+    if (file == NULL)
+    {
+        fatal_error("Could not open pipeline cache file!");
+    }
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (size <= 0)
+    {
+        fatal_error("Pipeline cache file is empty!");
+    }
+
+    data = malloc((size_t)size);
+
+    if (data == NULL)
+    {
+        fatal_error("Could not allocate pipeline cache data!");
+    }
+
+    if (fread(data, 1, (size_t)size, file) != (size_t)size)
+    {
+        fatal_error("Could not read pipeline cache file!");
+    }
+
+    fclose(file);
+
+    VkPipelineCacheCreateInfo pc_ci = { 0 };
+    pc_ci.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    pc_ci.pInitialData = data;
+    pc_ci.initialDataSize = (size_t)size;
+    result = vkCreatePipelineCache(device->device, &pc_ci, NULL, &pipeline_cache);
+    check_result(result, "Could not create pipeline cache!");
+
+    free(data);
+
+    return pipeline_cache;
+}
+
+/*
+* save_pipeline_cache()
+*
+* Writes the contents of a pipeline cache to a file.
+*
+* device: the device the cache belongs to.
+* pipeline_cache: the cache to save.
+* path: the path of the cache file.
+*
+* Returns VK_FALSE if the file couldn't be written.
+*/
+static VkBool32 save_pipeline_cache(vkstats_device* device, VkPipelineCache pipeline_cache, const char* path)
+{
+    VkResult result;
+    size_t size = 0;
+    void* data;
+    FILE* file;
+
+    result = vkGetPipelineCacheData(device->device, pipeline_cache, &size, NULL);
+    check_result(result, "Could not get pipeline cache data!");
+
+    data = malloc(size);
+
+    if (data == NULL)
+    {
+        fatal_error("Could not allocate pipeline cache data!");
+    }
+
+    result = vkGetPipelineCacheData(device->device, pipeline_cache, &size, data);
+    check_result(result, "Could not get pipeline cache data!");
+
+    file = fopen(path, "wb");
+
+    VkBool32 written = file != NULL && fwrite(data, 1, size, file) == size;
+
+    if (file != NULL && fclose(file) != 0)
+    {
+        written = VK_FALSE;
+    }
+
+    free(data);
+
+    printf("Pipeline cache: %zu bytes\n", size);
+
+    return written;
+}
+
+/*
+* get_physical_device_index()
+*
+* Finds the index of the device's physical device, so a fresh process can
+* open the same one.
+*
+* device: the device to look up.
+*
+* Returns the index into Vulkan's list of physical devices.
+*/
+static uint32_t get_physical_device_index(vkstats_device* device)
+{
+    VkResult result;
+    uint32_t physical_device_count = vkstats_physical_device_get_count(device->physical_device->instance);
+    VkPhysicalDevice* physical_devices = malloc(physical_device_count * sizeof(physical_devices[0]));
+    uint32_t index = 0;
+
+    if (physical_devices == NULL)
+    {
+        fatal_error("Could not allocate physical devices!");
+    }
+
+    result = vkEnumeratePhysicalDevices(device->physical_device->instance, &physical_device_count, physical_devices);
+
+    if (result != VK_SUCCESS && result != VK_INCOMPLETE)
+    {
+        fatal_error("Could not enumerate physical devices!");
+    }
+
+    for (uint32_t i = 0; i < physical_device_count; i++)
+    {
+        if (physical_devices[i] == device->physical_device->physical_device)
+        {
+            index = i;
+        }
+    }
+
+    free(physical_devices);
+
+    return index;
+}
+
+/*
+* run_pipeline_trial()
+*
+* Builds the corpus split evenly across the threads, and measures from when
+* the first thread started until the last one finished.
+*
+* context: a pipeline_trial.
+* results: the wall time.
+*/
+static void run_pipeline_trial(void* context, double* results)
+{
+    pipeline_trial* trial = context;
+    vkstats_barrier barrier;
+    uint64_t start_ticks = UINT64_MAX;
+    uint64_t end_ticks = 0;
+    uint32_t first = 0;
+
+    vkstats_barrier_init(&barrier, trial->thread_count);
+
+    for (uint32_t i = 0; i < trial->thread_count; i++)
+    {
+        pipeline_worker* worker = &trial->workers[i];
+        uint32_t count = trial->corpus->pipeline_count / trial->thread_count;
+
+        if (i < trial->corpus->pipeline_count % trial->thread_count)
+        {
+            count++;
+        }
+
+        worker->corpus = trial->corpus;
+        worker->pipeline_cache = trial->pipeline_cache;
+        worker->first = first;
+        worker->count = count;
+        worker->barrier = &barrier;
+        vkstats_thread_create(&worker->thread, run_pipeline_worker, worker);
+
+        first += count;
+    }
+
+    for (uint32_t i = 0; i < trial->thread_count; i++)
+    {
+        pipeline_worker* worker = &trial->workers[i];
+
+        vkstats_thread_join(&worker->thread);
+
+        if (worker->start_ticks < start_ticks)
+        {
+            start_ticks = worker->start_ticks;
+        }
+
+        if (worker->end_ticks > end_ticks)
+        {
+            end_ticks = worker->end_ticks;
+        }
+    }
+
+    vkstats_barrier_destroy(&barrier);
+    corpus_release(trial->corpus);
+
+    results[0] = (double)(end_ticks - start_ticks) / vkstats_stopwatch_get_frequency() * 1000.0;
+}
+
+/*
+* run_pipeline_worker()
+*
+* Host thread that builds its share of the corpus, once every thread is
+* ready.
+*
+* context: a pipeline_worker.
+*/
+static void run_pipeline_worker(void* context)
+{
+    pipeline_worker* worker = context;
+
+    vkstats_barrier_wait(worker->barrier);
+    worker->start_ticks = vkstats_stopwatch_get_ticks();
+    corpus_build(worker->corpus, worker->pipeline_cache, worker->first, worker->count);
+    worker->end_ticks = vkstats_stopwatch_get_ticks();
+
+    vkstats_trace_host_event("pipeline", "vkCreateComputePipelines", worker->start_ticks, worker->end_ticks, worker->count);
+}
+
+/*
+* run_child_trial()
+*
+* Runs a fresh copy of vkstats that builds the corpus once and reports how
+* long it took, not counting its own startup.
+*
+* context: a child_trial.
+* results: the time the child reported.
+*/
+static void run_child_trial(void* context, double* results)
+{
+    child_trial* trial = context;
+    int exit_code;
+    FILE* file;
+
+    if (!vkstats_process_run_self(trial->arguments, trial->argument_count, &exit_code) || exit_code != 0)
+    {
+        fatal_error("Pipeline cache process failed!");
+    }
+
+    file = fopen(trial->result_path, "r");
+
+    if (file == NULL || fscanf(file, "%lf", &results[0]) != 1)
+    {
+        fatal_error("Could not read pipeline cache result!");
+    }
+
+    fclose(file);
+}
@@ -0,0 +1,377 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vulkan/vulkan.h"
+
+#include "device.h"
+#include "util.h"
+#include "stopwatch.h"
+#include "harness.h"
+#include "memory_arena.h"
+#include "trace.h"
+#include "experiments.h"
+
+/*
+* vkCmdUpdateBuffer takes at most 64 KiB, which bounds the sizes compared.
+*/
+#define MIN_UPLOAD_SIZE 4
+#define MAX_UPLOAD_SIZE (64 * 1024)
+#define UPLOAD_BATCH_COUNT 256
+#define UPLOAD_BUFFER_SIZE ((VkDeviceSize)MAX_UPLOAD_SIZE * UPLOAD_BATCH_COUNT)
+
+typedef enum
+{
+    UPLOAD_PATH_UPDATE,
+    UPLOAD_PATH_FILL,
+    UPLOAD_PATH_DIRECT,
+    UPLOAD_PATH_STAGED,
+    UPLOAD_PATH_COUNT
+} upload_path;
+
+static const char* upload_path_names[UPLOAD_PATH_COUNT] =
+{
+    "vkCmdUpdateBuffer",
+    "vkCmdFillBuffer",
+    "Direct write",
+    "Staged copy",
+};
+
+typedef struct
+{
+    vkstats_device*     device;
+    uint32_t            queue_index;
+    upload_path         path;
+    uint32_t            size;
+    uint32_t            count;
+    const uint8_t*      source;
+    VkCommandBuffer     command_buffer;
+    VkSemaphore         semaphore;
+    uint64_t            semaphore_value;
+    VkBuffer            destination_buffer;
+    VkBuffer            staging_buffer;
+    uint8_t*            staging_mapped;
+    uint8_t*            direct_mapped;
+    VkDeviceMemory      direct_memory;
+    VkBool32            direct_coherent;
+} upload_trial;
+
+static void run_upload_trial(void* context, double* results);
+static void submit_and_wait(upload_trial* trial);
+
+void vkstats_experiment_small_upload(vkstats_device* device, uint32_t queue_index, vkstats_harness* harness)
+{
+    VkPhysicalDeviceMemoryProperties* memory_properties = &device->physical_device->memory_properties;
+    VkMemoryRequirements requirements;
+    uint32_t direct_memory_index = VKSTATS_NO_MEMORY_TYPE;
+    double latencies[UPLOAD_PATH_COUNT];
+    double bandwidths[UPLOAD_PATH_COUNT];
+    uint8_t* source;
+    char label[96];
+
+    printf("\n");
+    printf("Running small upload experiment on queue %u (family %u).\n", queue_index, device->queue_family_indices[queue_index]);
+    vkstats_harness_begin_experiment(harness, "small_upload", device, queue_index);
+    vkstats_harness_set_memory_types(harness, device->host_visible_memory_index, device->device_local_memory_index);
+
+    /*
+    * Direct writes need memory that is both device local and host visible,
+    * as on resizable BAR and unified memory devices.
+    */
+    VkBuffer buffer = vkstats_device_create_buffer(device, UPLOAD_BUFFER_SIZE, VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue_index);
+    vkGetBufferMemoryRequirements(device->device, buffer, &requirements);
+    vkDestroyBuffer(device->device, buffer, NULL);
+
+    for (uint32_t i = 0; i < memory_properties->memoryTypeCount; i++)
+    {
+        VkMemoryPropertyFlags flags = memory_properties->memoryTypes[i].propertyFlags;
+
+        if ((flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)
+            && (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+            && !(flags & VK_MEMORY_PROPERTY_PROTECTED_BIT)
+            && (requirements.memoryTypeBits & (1u << i)))
+        {
+            direct_memory_index = i;
+            break;
+        }
+    }
+
+    if (direct_memory_index == VKSTATS_NO_MEMORY_TYPE)
+    {
+        printf("No host-visible device-local memory, skipping direct writes.\n");
+    }
+
+    source = malloc(MAX_UPLOAD_SIZE);
+
+    if (source == NULL)
+    {
+        fatal_error("Could not allocate upload source!");
+    }
+
+    memset(source, 0x5a, MAX_UPLOAD_SIZE);
+
+    vkstats_memory_arena arena;
+    vkstats_memory_arena_init(&arena, device);
+
+    VkBufferCreateInfo b_ci = { 0 };
+    b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    b_ci.pQueueFamilyIndices = &device->queue_family_indices[queue_index];
+    b_ci.queueFamilyIndexCount = 1;
+    b_ci.size = UPLOAD_BUFFER_SIZE;
+    b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    b_ci.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    vkstats_memory_arena_reserve(&arena, &b_ci, device->device_local_memory_index);
+    b_ci.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    vkstats_memory_arena_reserve(&arena, &b_ci, device->host_visible_memory_index);
+
+    if (direct_memory_index != VKSTATS_NO_MEMORY_TYPE)
+    {
+        b_ci.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        vkstats_memory_arena_reserve(&arena, &b_ci, direct_memory_index);
+    }
+
+    vkstats_memory_arena_allocate(&arena);
+
+    upload_trial trial;
+    clear_struct(&trial);
+    trial.device = device;
+    trial.queue_index = queue_index;
+    trial.source = source;
+    trial.command_buffer = vkstats_device_allocate_command_buffer(device, queue_index);
+    trial.semaphore = vkstats_device_create_timeline_semaphore(device);
+    trial.destination_buffer = vkstats_device_create_buffer(device, UPLOAD_BUFFER_SIZE, VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue_index);
+    trial.staging_buffer = vkstats_device_create_buffer(device, UPLOAD_BUFFER_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, queue_index);
+    vkstats_memory_arena_bind_buffer(&arena, trial.destination_buffer, device->device_local_memory_index);
+    VkDeviceSize staging_offset = vkstats_memory_arena_bind_buffer(&arena, trial.staging_buffer, device->host_visible_memory_index);
+    trial.staging_mapped = (uint8_t*)vkstats_memory_arena_map(&arena, device->host_visible_memory_index) + staging_offset;
+
+    /*
+    * The direct destination only needs to exist to claim its range of the
+    * block; it's written through the mapping.
+    */
+    VkBuffer direct_buffer = VK_NULL_HANDLE;
+
+    if (direct_memory_index != VKSTATS_NO_MEMORY_TYPE)
+    {
+        direct_buffer = vkstats_device_create_buffer(device, UPLOAD_BUFFER_SIZE, VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue_index);
+        VkDeviceSize direct_offset = vkstats_memory_arena_bind_buffer(&arena, direct_buffer, direct_memory_index);
+        trial.direct_mapped = (uint8_t*)vkstats_memory_arena_map(&arena, direct_memory_index) + direct_offset;
+        trial.direct_memory = arena.memory[direct_memory_index];
+        trial.direct_coherent = (memory_properties->memoryTypes[direct_memory_index].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+    }
+
+    /*
+    * Latency is one upload per trial, from having the data on the host to
+    * the queue having finished with it. Throughput is a batch of uploads to
+    * consecutive ranges, recorded into one command buffer and submitted
+    * once.
+    */
+    printf("\n");
+    printf("%8s", "Size");
+
+    for (uint32_t i = 0; i < UPLOAD_PATH_COUNT; i++)
+    {
+        printf(" %18s", upload_path_names[i]);
+    }
+
+    printf("  %-18s %-18s\n", "Lowest latency", "Highest throughput");
+    printf("%8s", "");
+
+    for (uint32_t i = 0; i < UPLOAD_PATH_COUNT; i++)
+    {
+        printf(" %18s", "us, GB/s x256");
+    }
+
+    printf("\n");
+
+    for (uint32_t size = MIN_UPLOAD_SIZE; size <= MAX_UPLOAD_SIZE; size *= 4)
+    {
+        uint32_t fastest = UPLOAD_PATH_COUNT;
+        uint32_t widest = UPLOAD_PATH_COUNT;
+
+        trial.size = size;
+        printf("%8u", size);
+
+        for (uint32_t i = 0; i < UPLOAD_PATH_COUNT; i++)
+        {
+            vkstats_statistics statistics;
+
+            if (i == UPLOAD_PATH_DIRECT && direct_memory_index == VKSTATS_NO_MEMORY_TYPE)
+            {
+                printf(" %18s", "n/a");
+                continue;
+            }
+
+            trial.path = i;
+            trial.count = 1;
+            vkstats_harness_run(harness, run_upload_trial, &trial, 1, &statistics);
+            snprintf(label, sizeof(label), "%s, %u bytes", upload_path_names[i], size);
+            vkstats_harness_record(harness, label, &statistics, size);
+            latencies[i] = statistics.median;
+
+            trial.count = UPLOAD_BATCH_COUNT;
+            vkstats_harness_run(harness, run_upload_trial, &trial, 1, &statistics);
+            snprintf(label, sizeof(label), "%s, %u bytes x%u", upload_path_names[i], size, UPLOAD_BATCH_COUNT);
+            vkstats_harness_record(harness, label, &statistics, (uint64_t)size * UPLOAD_BATCH_COUNT);
+            bandwidths[i] = vkstats_get_bandwidth((uint64_t)size * UPLOAD_BATCH_COUNT, statistics.median);
+
+            if (fastest == UPLOAD_PATH_COUNT || latencies[i] < latencies[fastest])
+            {
+                fastest = i;
+            }
+
+            if (widest == UPLOAD_PATH_COUNT || bandwidths[i] > bandwidths[widest])
+            {
+                widest = i;
+            }
+
+            printf(" %9.2f, %6.2f", latencies[i] * 1000.0, bandwidths[i]);
+        }
+
+        printf("  %-18s %-18s\n", upload_path_names[fastest], upload_path_names[widest]);
+    }
+
+    vkDeviceWaitIdle(device->device);
+
+    if (direct_buffer != VK_NULL_HANDLE)
+    {
+        vkDestroyBuffer(device->device, direct_buffer, NULL);
+    }
+
+    vkDestroyBuffer(device->device, trial.staging_buffer, NULL);
+    vkDestroyBuffer(device->device, trial.destination_buffer, NULL);
+    vkFreeCommandBuffers(device->device, device->command_pools[queue_index], 1, &trial.command_buffer);
+    vkDestroySemaphore(device->device, trial.semaphore, NULL);
+    vkstats_memory_arena_destroy(&arena);
+    free(source);
+}
+
+/*
+* run_upload_trial()
+*
+* Uploads count ranges of size bytes each through one path, and waits until
+* the queue is done with them.
+*
+* context: an upload_trial.
+* results: the host time.
+*/
+static void run_upload_trial(void* context, double* results)
+{
+    VkResult result;
+    upload_trial* trial = context;
+    double frequency = vkstats_stopwatch_get_frequency();
+    uint64_t start_ticks;
+
+    VkCommandBufferBeginInfo cb_bi = { 0 };
+    cb_bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    cb_bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkDeviceWaitIdle(trial->device->device);
+    start_ticks = vkstats_stopwatch_get_ticks();
+
+    switch (trial->path)
+    {
+    case UPLOAD_PATH_UPDATE:
+        vkBeginCommandBuffer(trial->command_buffer, &cb_bi);
+
+        for (uint32_t i = 0; i < trial->count; i++)
+        {
+            vkCmdUpdateBuffer(trial->command_buffer, trial->destination_buffer, (VkDeviceSize)i * trial->size, trial->size, trial->source);
+        }
+
+        vkEndCommandBuffer(trial->command_buffer);
+        submit_and_wait(trial);
+        break;
+
+    case UPLOAD_PATH_FILL:
+        vkBeginCommandBuffer(trial->command_buffer, &cb_bi);
+
+        for (uint32_t i = 0; i < trial->count; i++)
+        {
+            vkCmdFillBuffer(trial->command_buffer, trial->destination_buffer, (VkDeviceSize)i * trial->size, trial->size, 0x5a5a5a5a);
+        }
+
+        vkEndCommandBuffer(trial->command_buffer);
+        submit_and_wait(trial);
+        break;
+
+    case UPLOAD_PATH_DIRECT:
+        /*
+        * Host writes are visible to the device as of the next submission, so
+        * there's nothing to wait for beyond the flush.
+        */
+        for (uint32_t i = 0; i < trial->count; i++)
+        {
+            memcpy(trial->direct_mapped + (size_t)i * trial->size, trial->source, trial->size);
+        }
+
+        if (!trial->direct_coherent)
+        {
+            VkMappedMemoryRange range = { 0 };
+            range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+            range.memory = trial->direct_memory;
+            range.size = VK_WHOLE_SIZE;
+            result = vkFlushMappedMemoryRanges(trial->device->device, 1, &range);
+            check_result(result, "Could not flush mapped memory!");
+        }
+        break;
+
+    case UPLOAD_PATH_STAGED:
+        vkBeginCommandBuffer(trial->command_buffer, &cb_bi);
+
+        for (uint32_t i = 0; i < trial->count; i++)
+        {
+            VkBufferCopy buffer_copy = { 0 };
+            buffer_copy.srcOffset = (VkDeviceSize)i * trial->size;
+            buffer_copy.dstOffset = (VkDeviceSize)i * trial->size;
+            buffer_copy.size = trial->size;
+
+            memcpy(trial->staging_mapped + buffer_copy.srcOffset, trial->source, trial->size);
+            vkCmdCopyBuffer(trial->command_buffer, trial->staging_buffer, trial->destination_buffer, 1, &buffer_copy);
+        }
+
+        vkEndCommandBuffer(trial->command_buffer);
+        submit_and_wait(trial);
+        break;
+
+    default:
+        fatal_error("Unknown upload path!");
+    }
+
+    results[0] = (double)(vkstats_stopwatch_get_ticks() - start_ticks) / frequency * 1000.0;
+}
+
+/*
+* submit_and_wait()
+*
+* Submits the trial's command buffer and waits for it on the host.
+*
+* trial: the upload_trial.
+*/
+static void submit_and_wait(upload_trial* trial)
+{
+    VkResult result;
+    uint64_t submit_ticks;
+
+    trial->semaphore_value++;
+
+    VkTimelineSemaphoreSubmitInfo ts_si = { 0 };
+    ts_si.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    ts_si.pSignalSemaphoreValues = &trial->semaphore_value;
+    ts_si.signalSemaphoreValueCount = 1;
+
+    VkSubmitInfo si = { 0 };
+    si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    si.pNext = &ts_si;
+    si.pCommandBuffers = &trial->command_buffer;
+    si.commandBufferCount = 1;
+    si.pSignalSemaphores = &trial->semaphore;
+    si.signalSemaphoreCount = 1;
+
+    submit_ticks = vkstats_stopwatch_get_ticks();
+    result = vkQueueSubmit(trial->device->queues[trial->queue_index], 1, &si, VK_NULL_HANDLE);
+    vkstats_trace_host_event("submit", "vkQueueSubmit", submit_ticks, vkstats_stopwatch_get_ticks(), (uint64_t)trial->size * trial->count);
+    check_result(result, "Could not submit queue!");
+
+    vkstats_device_wait_semaphore(trial->device, trial->semaphore, trial->semaphore_value);
+}
@@ -0,0 +1,362 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vulkan/vulkan.h"
+
+#include "config.h"
+#include "device.h"
+#include "util.h"
+#include "stopwatch.h"
+#include "harness.h"
+#include "memory_arena.h"
+#include "thread.h"
+#include "copy_kernels.h"
+#include "experiments.h"
+
+#define STAGING_SIZE (UINT64_C(64) * UINT64_C(1024) * UINT64_C(1024))
+
+/*
+* Memory property flags this experiment knows how to allocate from.
+*/
+#define STAGING_MEMORY_FLAGS (VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT)
+
+typedef struct
+{
+    vkstats_copy_kernel_function    function;
+    uint8_t*                        destination;
+    const uint8_t*                  source;
+    size_t                          size;
+    vkstats_barrier*                barrier;
+    vkstats_thread                  thread;
+} fill_worker;
+
+typedef struct
+{
+    vkstats_device*                 device;
+    uint32_t                        queue_index;
+    vkstats_copy_kernel_function    function;
+    uint8_t*                        mapped;
+    const uint8_t*                  source;
+    uint32_t                        thread_count;
+    fill_worker                     workers[MAX_THREADS];
+    VkDeviceMemory                  memory;
+    VkBool32                        coherent;
+    VkCommandBuffer                 command_buffer;
+    VkSemaphore                     semaphore;
+    uint64_t                        semaphore_value;
+    vkstats_stopwatch*              stopwatch;
+} staging_trial;
+
+static void run_fill_trial(void* context, double* results);
+static void run_upload_trial(void* context, double* results);
+static void run_fill_worker(void* context);
+static void flush_staging_memory(staging_trial* trial);
+
+void vkstats_experiment_staging_write(vkstats_device* device, uint32_t queue_index, vkstats_harness* harness)
+{
+    VkPhysicalDeviceMemoryProperties* memory_properties = &device->physical_device->memory_properties;
+    vkstats_copy_kernel kernels[MAX_COPY_KERNELS];
+    uint32_t kernel_count;
+    uint32_t max_thread_count;
+    VkMemoryRequirements requirements;
+    uint8_t* source;
+    char label[96];
+
+    vkstats_stopwatch stopwatch;
+    vkstats_stopwatch_init(&stopwatch);
+
+    printf("\n");
+    printf("Running staging write experiment on queue %u (family %u).\n", queue_index, device->queue_family_indices[queue_index]);
+    vkstats_harness_begin_experiment(harness, "staging_write", device, queue_index);
+
+    kernel_count = vkstats_get_copy_kernels(kernels);
+    max_thread_count = vkstats_get_cpu_count();
+
+    if (max_thread_count > MAX_THREADS)
+    {
+        max_thread_count = MAX_THREADS;
+    }
+
+    printf("Copy kernels:");
+
+    for (uint32_t i = 0; i < kernel_count; i++)
+    {
+        printf(" %s%s", kernels[i].name, i + 1 < kernel_count ? "," : "\n");
+    }
+
+    /*
+    * The source is ordinary heap memory, touched up front so page faults
+    * aren't part of the measurement.
+    */
+    source = malloc(STAGING_SIZE);
+
+    if (source == NULL)
+    {
+        fatal_error("Could not allocate staging source!");
+    }
+
+    memset(source, 0x5a, STAGING_SIZE);
+
+    VkBuffer buffer = vkstats_device_create_buffer(device, STAGING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, queue_index);
+    vkGetBufferMemoryRequirements(device->device, buffer, &requirements);
+    vkDestroyBuffer(device->device, buffer, NULL);
+
+    staging_trial trial;
+    clear_struct(&trial);
+    trial.device = device;
+    trial.queue_index = queue_index;
+    trial.source = source;
+    trial.command_buffer = vkstats_device_allocate_command_buffer(device, queue_index);
+    trial.semaphore = vkstats_device_create_timeline_semaphore(device);
+    trial.stopwatch = &stopwatch;
+
+    for (uint32_t i = 0; i < memory_properties->memoryTypeCount; i++)
+    {
+        VkMemoryPropertyFlags flags = memory_properties->memoryTypes[i].propertyFlags;
+
+        if (!(flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+            || (flags & ~STAGING_MEMORY_FLAGS)
+            || !(requirements.memoryTypeBits & (1u << i)))
+        {
+            continue;
+        }
+
+        printf("\n");
+        printf("Memory type %u (%s%s%s):\n",
+            i,
+            (flags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) ? "device-local " : "",
+            (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) ? "coherent" : "non-coherent",
+            (flags & VK_MEMORY_PROPERTY_HOST_CACHED_BIT) ? " cached" : " uncached");
+
+        /*
+        * A staging buffer in the memory type under test, and a device-local
+        * destination for the end-to-end upload.
+        */
+        vkstats_memory_arena arena;
+        vkstats_memory_arena_init(&arena, device);
+
+        VkBufferCreateInfo b_ci = { 0 };
+        b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        b_ci.pQueueFamilyIndices = &device->queue_family_indices[queue_index];
+        b_ci.queueFamilyIndexCount = 1;
+        b_ci.size = STAGING_SIZE;
+        b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        b_ci.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        vkstats_memory_arena_reserve(&arena, &b_ci, i);
+        b_ci.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        vkstats_memory_arena_reserve(&arena, &b_ci, device->device_local_memory_index);
+        vkstats_memory_arena_allocate(&arena);
+
+        VkBuffer staging_buffer = vkstats_device_create_buffer(device, STAGING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, queue_index);
+        VkBuffer destination_buffer = vkstats_device_create_buffer(device, STAGING_SIZE, VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue_index);
+        VkDeviceSize staging_offset = vkstats_memory_arena_bind_buffer(&arena, staging_buffer, i);
+        vkstats_memory_arena_bind_buffer(&arena, destination_buffer, device->device_local_memory_index);
+
+        trial.mapped = (uint8_t*)vkstats_memory_arena_map(&arena, i) + staging_offset;
+        trial.memory = arena.memory[i];
+        trial.coherent = (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+        /*
+        * Single-threaded fill with every kernel.
+        */
+        vkstats_harness_set_memory_types(harness, VKSTATS_NO_MEMORY_TYPE, i);
+
+        for (uint32_t j = 0; j < kernel_count; j++)
+        {
+            vkstats_statistics statistics;
+
+            trial.function = kernels[j].function;
+            trial.thread_count = 1;
+            vkstats_harness_run(harness, run_fill_trial, &trial, 1, &statistics);
+
+            snprintf(label, sizeof(label), "  Fill, %s", kernels[j].name);
+            vkstats_harness_report_bandwidth(harness, label, &statistics, STAGING_SIZE);
+        }
+
+        /*
+        * Multi-threaded fill with the most capable kernel.
+        */
+        for (uint32_t thread_count = 2; thread_count <= max_thread_count; thread_count *= 2)
+        {
+            vkstats_statistics statistics;
+
+            trial.function = kernels[kernel_count - 1].function;
+            trial.thread_count = thread_count;
+            vkstats_harness_run(harness, run_fill_trial, &trial, 1, &statistics);
+
+            snprintf(label, sizeof(label), "  Fill, %s, %u threads", kernels[kernel_count - 1].name, thread_count);
+            vkstats_harness_report_bandwidth(harness, label, &statistics, STAGING_SIZE);
+        }
+
+        /*
+        * End-to-end upload: fill the staging buffer, then copy it to
+        * device-local memory.
+        */
+        VkCommandBufferBeginInfo cb_bi = { 0 };
+        cb_bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+        VkBufferCopy buffer_copy = { 0 };
+        buffer_copy.size = STAGING_SIZE;
+
+        vkBeginCommandBuffer(trial.command_buffer, &cb_bi);
+        vkCmdCopyBuffer(trial.command_buffer, staging_buffer, destination_buffer, 1, &buffer_copy);
+        vkEndCommandBuffer(trial.command_buffer);
+
+        vkstats_harness_set_memory_types(harness, i, device->device_local_memory_index);
+
+        for (uint32_t j = 0; j < kernel_count; j++)
+        {
+            vkstats_statistics statistics;
+
+            trial.function = kernels[j].function;
+            trial.thread_count = 1;
+            vkstats_harness_run(harness, run_upload_trial, &trial, 1, &statistics);
+
+            snprintf(label, sizeof(label), "  Upload (fill + copy), %s", kernels[j].name);
+            vkstats_harness_report_bandwidth(harness, label, &statistics, STAGING_SIZE);
+        }
+
+        vkDestroyBuffer(device->device, staging_buffer, NULL);
+        vkDestroyBuffer(device->device, destination_buffer, NULL);
+        vkstats_memory_arena_destroy(&arena);
+    }
+
+    vkFreeCommandBuffers(device->device, device->command_pools[queue_index], 1, &trial.command_buffer);
+    vkDestroySemaphore(device->device, trial.semaphore, NULL);
+    free(source);
+}
+
+/*
+* run_fill_trial()
+*
+* Fills the mapped staging memory from the source, split evenly across
+* thread_count threads, and flushes it if it isn't coherent.
+*
+* context: a staging_trial.
+* results: the time taken to fill and flush.
+*/
+static void run_fill_trial(void* context, double* results)
+{
+    staging_trial* trial = context;
+
+    if (trial->thread_count == 1)
+    {
+        vkstats_stopwatch_start(trial->stopwatch);
+        trial->function(trial->mapped, trial->source, STAGING_SIZE);
+        flush_staging_memory(trial);
+        results[0] = vkstats_stopwatch_stop(trial->stopwatch);
+        return;
+    }
+
+    /*
+    * Every worker waits on the barrier so the clock starts once they are
+    * all running, not while they are being created.
+    */
+    vkstats_barrier barrier;
+    size_t slice = (size_t)(STAGING_SIZE / trial->thread_count);
+
+    vkstats_barrier_init(&barrier, trial->thread_count + 1);
+
+    for (uint32_t i = 0; i < trial->thread_count; i++)
+    {
+        fill_worker* worker = &trial->workers[i];
+
+        worker->function = trial->function;
+        worker->destination = trial->mapped + slice * i;
+        worker->source = trial->source + slice * i;
+        worker->size = i + 1 < trial->thread_count ? slice : (size_t)STAGING_SIZE - slice * i;
+        worker->barrier = &barrier;
+        vkstats_thread_create(&worker->thread, run_fill_worker, worker);
+    }
+
+    vkstats_barrier_wait(&barrier);
+    vkstats_stopwatch_start(trial->stopwatch);
+
+    for (uint32_t i = 0; i < trial->thread_count; i++)
+    {
+        vkstats_thread_join(&trial->workers[i].thread);
+    }
+
+    flush_staging_memory(trial);
+    results[0] = vkstats_stopwatch_stop(trial->stopwatch);
+
+    vkstats_barrier_destroy(&barrier);
+}
+
+/*
+* run_upload_trial()
+*
+* Fills the staging memory, then submits the recorded copy to device-local
+* memory and waits for it.
+*
+* context: a staging_trial.
+* results: the time from the start of the fill until the copy completes.
+*/
+static void run_upload_trial(void* context, double* results)
+{
+    staging_trial* trial = context;
+
+    trial->semaphore_value++;
+
+    VkTimelineSemaphoreSubmitInfo ts_si = { 0 };
+    ts_si.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    ts_si.pSignalSemaphoreValues = &trial->semaphore_value;
+    ts_si.signalSemaphoreValueCount = 1;
+
+    VkSubmitInfo si = { 0 };
+    si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    si.pNext = &ts_si;
+    si.pCommandBuffers = &trial->command_buffer;
+    si.commandBufferCount = 1;
+    si.pSignalSemaphores = &trial->semaphore;
+    si.signalSemaphoreCount = 1;
+
+    vkDeviceWaitIdle(trial->device->device);
+    vkstats_stopwatch_start(trial->stopwatch);
+    trial->function(trial->mapped, trial->source, STAGING_SIZE);
+    flush_staging_memory(trial);
+    vkstats_device_submit(trial->device, trial->queue_index, &si, STAGING_SIZE);
+    vkstats_device_wait_semaphore(trial->device, trial->semaphore, trial->semaphore_value);
+    results[0] = vkstats_stopwatch_stop(trial->stopwatch);
+}
+
+/*
+* run_fill_worker()
+*
+* Fills one slice of the staging memory once every worker is running.
+*
+* context: a fill_worker.
+*/
+static void run_fill_worker(void* context)
+{
+    fill_worker* worker = context;
+
+    vkstats_barrier_wait(worker->barrier);
+    worker->function(worker->destination, worker->source, worker->size);
+}
+
+/*
+* flush_staging_memory()
+*
+* Flushes the staging memory if the memory type isn't host coherent, making
+* the host writes available to the device.
+*
+* trial: the trial whose memory to flush.
+*/
+static void flush_staging_memory(staging_trial* trial)
+{
+    VkResult result;
+
+    if (trial->coherent)
+    {
+        return;
+    }
+
+    VkMappedMemoryRange range = { 0 };
+    range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+    range.memory = trial->memory;
+    range.size = VK_WHOLE_SIZE;
+    result = vkFlushMappedMemoryRanges(trial->device->device, 1, &range);
+    check_result(result, "Could not flush mapped memory!");
+}
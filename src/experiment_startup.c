@@ -0,0 +1,252 @@
+#include <stdio.h>
+
+#include "vulkan/vulkan.h"
+
+#include "config.h"
+#include "device.h"
+#include "file.h"
+#include "util.h"
+#include "instance.h"
+#include "physical_device.h"
+#include "stopwatch.h"
+#include "harness.h"
+#include "process.h"
+#include "experiments.h"
+
+typedef enum
+{
+    PHASE_LAYER_ENUMERATION,
+    PHASE_CREATE_INSTANCE,
+    PHASE_ENUMERATE_PHYSICAL_DEVICES,
+    PHASE_QUERY_PHYSICAL_DEVICE,
+    PHASE_CREATE_DEVICE,
+    PHASE_CREATE_COMMAND_POOLS,
+    PHASE_TEARDOWN,
+    PHASE_COUNT
+} startup_phase;
+
+static const char* phase_names[PHASE_COUNT] =
+{
+    "Layer enumeration",
+    "vkCreateInstance",
+    "Physical device enumeration",
+    "Physical device queries",
+    "vkCreateDevice",
+    "Command pools",
+    "Teardown",
+};
+
+typedef struct
+{
+    uint32_t            device_index;
+    const char*         arguments[MAX_PROCESS_ARGUMENTS];
+    uint32_t            argument_count;
+    const char*         result_path;
+} startup_trial;
+
+static void run_startup_cycle(uint32_t device_index, double* results);
+static void run_warm_trial(void* context, double* results);
+static void run_cold_trial(void* context, double* results);
+
+void vkstats_experiment_startup(uint32_t device_index, uint32_t cycle_count, vkstats_harness* harness)
+{
+    vkstats_statistics statistics[2][PHASE_COUNT];
+    char name[64];
+    char result_path[VKSTATS_FILE_MAX_PATH];
+    char device_argument[16];
+    char label[64];
+    int exit_code;
+
+    printf("\n");
+    printf("Running startup experiment, %u cycles.\n", cycle_count);
+    vkstats_harness_begin_experiment(harness, "startup", NULL, VKSTATS_NO_QUEUE);
+    vkstats_harness_set_memory_types(harness, VKSTATS_NO_MEMORY_TYPE, VKSTATS_NO_MEMORY_TYPE);
+
+    /*
+    * Every cycle is a sample, so the harness runs exactly the requested
+    * number of them.
+    */
+    uint32_t warmup_count = harness->warmup_count;
+    uint32_t trial_count = harness->trial_count;
+    harness->warmup_count = 0;
+    harness->trial_count = cycle_count;
+
+    startup_trial trial;
+    clear_struct(&trial);
+    snprintf(name, sizeof(name), "vkstats_startup_%u.txt", device_index);
+    vkstats_file_get_temp_path(result_path, name);
+    snprintf(device_argument, sizeof(device_argument), "%u", device_index);
+    trial.device_index = device_index;
+    trial.arguments[0] = "--device";
+    trial.arguments[1] = device_argument;
+    trial.arguments[2] = "--startup-result";
+    trial.arguments[3] = result_path;
+    trial.argument_count = 4;
+    trial.result_path = result_path;
+
+    /*
+    * Cold cycles each run in a fresh process, so the loader and driver start
+    * from nothing. Warm cycles run one after another in this process.
+    */
+    VkBool32 cold_supported = vkstats_process_run_self(trial.arguments, trial.argument_count, &exit_code) && exit_code == 0;
+
+    if (cold_supported)
+    {
+        vkstats_harness_run(harness, run_cold_trial, &trial, PHASE_COUNT, statistics[0]);
+    }
+    else
+    {
+        printf("Could not start a fresh process, skipping cold startup.\n");
+    }
+
+    remove(result_path);
+    vkstats_harness_run(harness, run_warm_trial, &trial, PHASE_COUNT, statistics[1]);
+
+    harness->warmup_count = warmup_count;
+    harness->trial_count = trial_count;
+
+    printf("%-28s %12s %12s %12s %12s\n", "Phase (ms)", "Cold median", "Cold p95", "Warm median", "Warm p95");
+
+    double totals[2] = { 0 };
+
+    for (uint32_t i = 0; i < PHASE_COUNT; i++)
+    {
+        if (cold_supported)
+        {
+            snprintf(label, sizeof(label), "Cold %s", phase_names[i]);
+            vkstats_harness_record(harness, label, &statistics[0][i], 0);
+            totals[0] += statistics[0][i].median;
+        }
+
+        snprintf(label, sizeof(label), "Warm %s", phase_names[i]);
+        vkstats_harness_record(harness, label, &statistics[1][i], 0);
+        totals[1] += statistics[1][i].median;
+
+        printf("%-28s %12.3f %12.3f %12.3f %12.3f\n",
+            phase_names[i],
+            cold_supported ? statistics[0][i].median : 0.0,
+            cold_supported ? statistics[0][i].p95 : 0.0,
+            statistics[1][i].median,
+            statistics[1][i].p95);
+    }
+
+    printf("%-28s %12.3f %12s %12.3f\n", "Total", totals[0], "", totals[1]);
+}
+
+void vkstats_experiment_startup_child(uint32_t device_index, const char* result_path)
+{
+    double results[PHASE_COUNT];
+    FILE* file;
+
+    run_startup_cycle(device_index, results);
+
+    file = fopen(result_path, "w");
+
+    if (file == NULL)
+    {
+        fatal_error("Could not open startup result file!");
+    }
+
+    for (uint32_t i = 0; i < PHASE_COUNT; i++)
+    {
+        fprintf(file, "%.9f\n", results[i]);
+    }
+
+    fclose(file);
+}
+
+/*
+* run_startup_cycle()
+*
+* Brings up an instance and a device with the same queues and extensions as
+* the main run, then tears them down again, timing every phase.
+*
+* device_index: the index of the physical device to use.
+* results: the time of each phase, indexed by startup_phase.
+*/
+static void run_startup_cycle(uint32_t device_index, double* results)
+{
+    double frequency = vkstats_stopwatch_get_frequency();
+
+    /*
+    * The loader scans for layers on the first call that needs them, which is
+    * the first call it gets in a fresh process.
+    */
+    uint64_t start_ticks = vkstats_stopwatch_get_ticks();
+    vkstats_instance_has_layer(VKSTATS_VALIDATION_LAYER);
+    results[PHASE_LAYER_ENUMERATION] = (double)(vkstats_stopwatch_get_ticks() - start_ticks) / frequency * 1000.0;
+
+    vkstats_instance instance;
+    vkstats_instance_create(&instance, VK_FALSE);
+    results[PHASE_CREATE_INSTANCE] = instance.create_time;
+
+    vkstats_physical_device physical_device;
+    vkstats_physical_device_get(&physical_device, instance.instance, device_index);
+    results[PHASE_ENUMERATE_PHYSICAL_DEVICES] = physical_device.enumeration_time;
+    results[PHASE_QUERY_PHYSICAL_DEVICE] = physical_device.query_time;
+
+    vkstats_device device;
+    vkstats_device_builder builder;
+    vkstats_experiment_init_device_builder(&builder, &physical_device);
+    vkstats_device_builder_build(&builder, &device);
+    results[PHASE_CREATE_DEVICE] = device.create_time;
+    results[PHASE_CREATE_COMMAND_POOLS] = device.command_pool_time;
+
+    start_ticks = vkstats_stopwatch_get_ticks();
+    vkstats_device_destroy(&device);
+    vkstats_instance_destroy(&instance);
+    results[PHASE_TEARDOWN] = (double)(vkstats_stopwatch_get_ticks() - start_ticks) / frequency * 1000.0;
+}
+
+/*
+* run_warm_trial()
+*
+* Runs a startup cycle in this process.
+*
+* context: a startup_trial.
+* results: the time of each phase.
+*/
+static void run_warm_trial(void* context, double* results)
+{
+    startup_trial* trial = context;
+
+    run_startup_cycle(trial->device_index, results);
+}
+
+/*
+* run_cold_trial()
+*
+* Runs a startup cycle in a fresh copy of vkstats and reads back the times it
+* reports.
+*
+* context: a startup_trial.
+* results: the time of each phase.
+*/
+static void run_cold_trial(void* context, double* results)
+{
+    startup_trial* trial = context;
+    int exit_code;
+    FILE* file;
+
+    if (!vkstats_process_run_self(trial->arguments, trial->argument_count, &exit_code) || exit_code != 0)
+    {
+        fatal_error("Startup process failed!");
+    }
+
+    file = fopen(trial->result_path, "r");
+
+    if (file == NULL)
+    {
+        fatal_error("Could not read startup result!");
+    }
+
+    for (uint32_t i = 0; i < PHASE_COUNT; i++)
+    {
+        if (fscanf(file, "%lf", &results[i]) != 1)
+        {
+            fatal_error("Could not read startup result!");
+        }
+    }
+
+    fclose(file);
+}
@@ -0,0 +1,188 @@
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "vulkan/vulkan.h"
+
+#include "config.h"
+#include "device.h"
+#include "util.h"
+#include "stopwatch.h"
+#include "harness.h"
+#include "memory_arena.h"
+#include "experiments.h"
+
+#define MIN_CHUNK_SIZE (UINT64_C(64) * UINT64_C(1024))
+#define MAX_CHUNK_SIZE (UINT64_C(64) * UINT64_C(1024) * UINT64_C(1024))
+#define STREAM_SIZE (UINT64_C(256) * UINT64_C(1024) * UINT64_C(1024))
+
+typedef struct
+{
+    vkstats_device*     device;
+    uint32_t            queue_index;
+    VkCommandBuffer     command_buffers[MAX_IN_FLIGHT];
+    VkSemaphore         semaphore;
+    uint64_t            semaphore_value;
+    VkBuffer            source_buffer;
+    VkBuffer            destination_buffer;
+    VkDeviceSize        chunk_size;
+    uint32_t            chunk_count;
+    uint32_t            queue_depth;
+    vkstats_stopwatch*  stopwatch;
+} streaming_trial;
+
+static void run_streaming_trial(void* context, double* results);
+
+void vkstats_experiment_queue_streaming_bandwidth(vkstats_device* device, uint32_t queue_index, vkstats_harness* harness)
+{
+    vkstats_stopwatch stopwatch;
+    vkstats_stopwatch_init(&stopwatch);
+
+    printf("\n");
+    printf("Running queue streaming bandwidth experiment on queue %u (family %u).\n", queue_index, device->queue_family_indices[queue_index]);
+    vkstats_harness_begin_experiment(harness, "queue_streaming_bandwidth", device, queue_index);
+    vkstats_harness_set_memory_types(harness, device->host_visible_memory_index, device->device_local_memory_index);
+    printf("\n");
+
+    streaming_trial trial;
+    clear_struct(&trial);
+    trial.device = device;
+    trial.queue_index = queue_index;
+    trial.semaphore = vkstats_device_create_timeline_semaphore(device);
+    trial.stopwatch = &stopwatch;
+
+    for (uint32_t i = 0; i < MAX_IN_FLIGHT; i++)
+    {
+        trial.command_buffers[i] = vkstats_device_allocate_command_buffer(device, queue_index);
+    }
+
+    /*
+    * Each command buffer in flight copies through its own slot of the source
+    * and destination buffers, so there is room for the largest chunk at the
+    * deepest queue depth.
+    */
+    vkstats_memory_arena arena;
+    vkstats_memory_arena_init(&arena, device);
+
+    VkBufferCreateInfo b_ci = { 0 };
+    b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    b_ci.pQueueFamilyIndices = &device->queue_family_indices[queue_index];
+    b_ci.queueFamilyIndexCount = 1;
+    b_ci.size = MAX_CHUNK_SIZE * MAX_IN_FLIGHT;
+    b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    b_ci.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    vkstats_memory_arena_reserve(&arena, &b_ci, device->host_visible_memory_index);
+    b_ci.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    vkstats_memory_arena_reserve(&arena, &b_ci, device->device_local_memory_index);
+    vkstats_memory_arena_allocate(&arena);
+
+    for (VkDeviceSize chunk_size = MIN_CHUNK_SIZE; chunk_size <= MAX_CHUNK_SIZE; chunk_size *= 4)
+    {
+        for (uint32_t queue_depth = 1; queue_depth <= MAX_IN_FLIGHT; queue_depth *= 2)
+        {
+            trial.source_buffer = vkstats_device_create_buffer(device, chunk_size * queue_depth, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, queue_index);
+            trial.destination_buffer = vkstats_device_create_buffer(device, chunk_size * queue_depth, VK_BUFFER_USAGE_TRANSFER_DST_BIT, queue_index);
+
+            vkstats_memory_arena_reset(&arena);
+            vkstats_memory_arena_bind_buffer(&arena, trial.source_buffer, device->host_visible_memory_index);
+            vkstats_memory_arena_bind_buffer(&arena, trial.destination_buffer, device->device_local_memory_index);
+
+            /*
+            * Stream a fixed amount of data, but always enough chunks to fill
+            * the queue several times over.
+            */
+            trial.chunk_size = chunk_size;
+            trial.queue_depth = queue_depth;
+            trial.chunk_count = (uint32_t)(STREAM_SIZE / chunk_size);
+
+            if (trial.chunk_count < queue_depth * 4)
+            {
+                trial.chunk_count = queue_depth * 4;
+            }
+
+            vkstats_statistics statistics;
+            char label[64];
+
+            vkstats_harness_run(harness, run_streaming_trial, &trial, 1, &statistics);
+
+            snprintf(label, sizeof(label), "Streaming %" PRIu64 " byte chunks, depth %u", chunk_size, queue_depth);
+            vkstats_harness_report_bandwidth(harness, label, &statistics, chunk_size * trial.chunk_count);
+
+            vkDestroyBuffer(device->device, trial.source_buffer, NULL);
+            vkDestroyBuffer(device->device, trial.destination_buffer, NULL);
+        }
+    }
+
+    vkstats_memory_arena_destroy(&arena);
+    vkFreeCommandBuffers(device->device, device->command_pools[queue_index], MAX_IN_FLIGHT, trial.command_buffers);
+    vkDestroySemaphore(device->device, trial.semaphore, NULL);
+}
+
+/*
+* run_streaming_trial()
+*
+* Streams chunk_count chunks through the queue, keeping up to queue_depth
+* copies in flight. Every submission signals the next value of the timeline
+* semaphore, so a command buffer can be re-recorded once the value it
+* signaled has been reached.
+*
+* context: a streaming_trial.
+* results: the time from the first submission until the last copy completes.
+*/
+static void run_streaming_trial(void* context, double* results)
+{
+    streaming_trial* trial = context;
+    vkstats_device* device = trial->device;
+    uint64_t base_value = trial->semaphore_value;
+
+    VkCommandBufferBeginInfo cb_bi = { 0 };
+    cb_bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    cb_bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkDeviceWaitIdle(device->device);
+    vkstats_stopwatch_start(trial->stopwatch);
+
+    for (uint32_t i = 0; i < trial->chunk_count; i++)
+    {
+        uint32_t slot = i % trial->queue_depth;
+        VkCommandBuffer command_buffer = trial->command_buffers[slot];
+
+        /*
+        * Wait for the copy that last used this slot to retire.
+        */
+        if (i >= trial->queue_depth)
+        {
+            vkstats_device_wait_semaphore(device, trial->semaphore, base_value + i - trial->queue_depth + 1);
+        }
+
+        VkBufferCopy buffer_copy = { 0 };
+        buffer_copy.srcOffset = slot * trial->chunk_size;
+        buffer_copy.dstOffset = slot * trial->chunk_size;
+        buffer_copy.size = trial->chunk_size;
+
+        vkBeginCommandBuffer(command_buffer, &cb_bi);
+        vkCmdCopyBuffer(command_buffer, trial->source_buffer, trial->destination_buffer, 1, &buffer_copy);
+        vkEndCommandBuffer(command_buffer);
+
+        uint64_t signal_value = base_value + i + 1;
+
+        VkTimelineSemaphoreSubmitInfo ts_si = { 0 };
+        ts_si.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        ts_si.pSignalSemaphoreValues = &signal_value;
+        ts_si.signalSemaphoreValueCount = 1;
+
+        VkSubmitInfo si = { 0 };
+        si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        si.pNext = &ts_si;
+        si.pCommandBuffers = &command_buffer;
+        si.commandBufferCount = 1;
+        si.pSignalSemaphores = &trial->semaphore;
+        si.signalSemaphoreCount = 1;
+
+        vkstats_device_submit(device, trial->queue_index, &si, trial->chunk_size);
+    }
+
+    vkstats_device_wait_semaphore(device, trial->semaphore, base_value + trial->chunk_count);
+    results[0] = vkstats_stopwatch_stop(trial->stopwatch);
+
+    trial->semaphore_value = base_value + trial->chunk_count;
+}
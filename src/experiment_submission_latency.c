@@ -0,0 +1,508 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "vulkan/vulkan.h"
+
+#include "device.h"
+#include "util.h"
+#include "stopwatch.h"
+#include "harness.h"
+#include "trace.h"
+#include "experiments.h"
+
+#define MAX_BATCH_SIZE 1024
+#define PING_PONG_ROUNDS 32
+
+typedef struct
+{
+    vkstats_device*                 device;
+    uint32_t                        queue_index;
+    uint32_t                        other_queue_index;
+    VkCommandBuffer                 command_buffer;
+    VkFence                         fence;
+    VkSemaphore                     semaphore;
+    uint64_t                        semaphore_value;
+    VkSubmitInfo*                   submit_infos;
+    uint32_t                        batch_size;
+    VkSubmitInfo                    ping_pong_submit_infos[2][PING_PONG_ROUNDS];
+    VkTimelineSemaphoreSubmitInfo   ping_pong_timeline_infos[2][PING_PONG_ROUNDS];
+    uint64_t                        ping_pong_values[2][PING_PONG_ROUNDS][2];
+} submission_trial;
+
+static void report_latency(vkstats_harness* harness, const char* label, const vkstats_statistics* statistics);
+static void run_submit_trial(void* context, double* results);
+static void run_submit2_trial(void* context, double* results);
+static void run_batch_trial(void* context, double* results);
+static void run_spin_wakeup_trial(void* context, double* results);
+static void run_timeline_wakeup_trial(void* context, double* results);
+static void run_fence_wakeup_trial(void* context, double* results);
+static void run_ping_pong_trial(void* context, double* results);
+static void submit_gated(submission_trial* trial, uint64_t wait_value, uint64_t signal_value, VkFence fence);
+
+void vkstats_experiment_submission_latency(vkstats_device* device, uint32_t queue_index, uint32_t other_queue_index, vkstats_harness* harness)
+{
+    VkResult result;
+    vkstats_statistics statistics;
+    char label[64];
+
+    printf("\n");
+    printf("Running submission latency experiment on queue %u (family %u).\n", queue_index, device->queue_family_indices[queue_index]);
+    vkstats_harness_begin_experiment(harness, "submission_latency", device, queue_index);
+
+    submission_trial trial;
+    clear_struct(&trial);
+    trial.device = device;
+    trial.queue_index = queue_index;
+    trial.other_queue_index = other_queue_index;
+    trial.semaphore = vkstats_device_create_timeline_semaphore(device);
+    trial.submit_infos = malloc(MAX_BATCH_SIZE * sizeof(trial.submit_infos[0]));
+
+    if (trial.submit_infos == NULL)
+    {
+        fatal_error("Could not allocate submit infos!");
+    }
+
+    VkFenceCreateInfo f_ci = { 0 };
+    f_ci.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    result = vkCreateFence(device->device, &f_ci, NULL, &trial.fence);
+    check_result(result, "Could not create fence!");
+
+    /*
+    * One empty command buffer stands in for every submission. It can be
+    * pending many times over in a batch, so it needs simultaneous use.
+    */
+    trial.command_buffer = vkstats_device_allocate_command_buffer(device, queue_index);
+
+    VkCommandBufferBeginInfo cb_bi = { 0 };
+    cb_bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    cb_bi.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    vkBeginCommandBuffer(trial.command_buffer, &cb_bi);
+    vkEndCommandBuffer(trial.command_buffer);
+
+    for (uint32_t i = 0; i < MAX_BATCH_SIZE; i++)
+    {
+        clear_struct(&trial.submit_infos[i]);
+        trial.submit_infos[i].sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        trial.submit_infos[i].pCommandBuffers = &trial.command_buffer;
+        trial.submit_infos[i].commandBufferCount = 1;
+    }
+
+    /*
+    * The host cost of handing empty work to the driver.
+    */
+    vkstats_harness_run(harness, run_submit_trial, &trial, 1, &statistics);
+    report_latency(harness, "vkQueueSubmit, empty", &statistics);
+
+    if (device->synchronization2)
+    {
+        vkstats_harness_run(harness, run_submit2_trial, &trial, 1, &statistics);
+        report_latency(harness, "vkQueueSubmit2, empty", &statistics);
+    }
+    else
+    {
+        printf("Synchronization2 is not supported, skipping vkQueueSubmit2.\n");
+    }
+
+    for (uint32_t batch_size = 1; batch_size <= MAX_BATCH_SIZE; batch_size *= 4)
+    {
+        trial.batch_size = batch_size;
+        vkstats_harness_run(harness, run_batch_trial, &trial, 1, &statistics);
+
+        snprintf(label, sizeof(label), "vkQueueSubmit, batch of %u", batch_size);
+        report_latency(harness, label, &statistics);
+        printf("    %.3f us per VkSubmitInfo\n", statistics.median * 1000.0 / batch_size);
+    }
+
+    /*
+    * The host releases a submission that does nothing but signal, then
+    * waits for the signal. Spinning on the counter shows how quickly the
+    * queue starts once released; the blocking waits add the time to wake
+    * the waiting thread.
+    */
+    vkstats_harness_run(harness, run_spin_wakeup_trial, &trial, 1, &statistics);
+    report_latency(harness, "Host signal to queue start, spinning", &statistics);
+
+    vkstats_harness_run(harness, run_timeline_wakeup_trial, &trial, 1, &statistics);
+    report_latency(harness, "Host signal to wakeup, timeline wait", &statistics);
+
+    vkstats_harness_run(harness, run_fence_wakeup_trial, &trial, 1, &statistics);
+    report_latency(harness, "Host signal to wakeup, fence wait", &statistics);
+
+    /*
+    * Queues that alias the same VkQueue can't ping-pong, they would wait on
+    * themselves.
+    */
+    if (device->queues[queue_index] != device->queues[other_queue_index])
+    {
+        vkstats_harness_run(harness, run_ping_pong_trial, &trial, 1, &statistics);
+        snprintf(label, sizeof(label), "Ping-pong with queue %u, per hop", other_queue_index);
+        report_latency(harness, label, &statistics);
+    }
+    else
+    {
+        printf("Queue %u aliases queue %u, skipping ping-pong.\n", other_queue_index, queue_index);
+    }
+
+    vkDeviceWaitIdle(device->device);
+    vkFreeCommandBuffers(device->device, device->command_pools[queue_index], 1, &trial.command_buffer);
+    vkDestroyFence(device->device, trial.fence, NULL);
+    vkDestroySemaphore(device->device, trial.semaphore, NULL);
+    free(trial.submit_infos);
+}
+
+/*
+* report_latency()
+*
+* Reports the statistics of the last run and prints its histogram.
+*
+* harness: the harness that took the measurements.
+* label: describes what was measured.
+* statistics: the statistics of the last run.
+*/
+static void report_latency(vkstats_harness* harness, const char* label, const vkstats_statistics* statistics)
+{
+    vkstats_harness_report(harness, label, statistics);
+    vkstats_harness_print_histogram(harness, 0);
+}
+
+/*
+* run_submit_trial()
+*
+* Times one vkQueueSubmit of the empty command buffer. The queue drains after
+* the clock stops.
+*
+* context: a submission_trial.
+* results: the host time.
+*/
+static void run_submit_trial(void* context, double* results)
+{
+    VkResult result;
+    submission_trial* trial = context;
+    VkQueue queue = trial->device->queues[trial->queue_index];
+    double frequency = vkstats_stopwatch_get_frequency();
+    uint64_t start_ticks;
+    uint64_t end_ticks;
+
+    start_ticks = vkstats_stopwatch_get_ticks();
+    result = vkQueueSubmit(queue, 1, trial->submit_infos, VK_NULL_HANDLE);
+    end_ticks = vkstats_stopwatch_get_ticks();
+    vkstats_trace_host_event("submit", "vkQueueSubmit", start_ticks, end_ticks, 1);
+    check_result(result, "Could not submit queue!");
+
+    results[0] = (double)(end_ticks - start_ticks) / frequency * 1000.0;
+    vkQueueWaitIdle(queue);
+}
+
+/*
+* run_submit2_trial()
+*
+* Times one vkQueueSubmit2 of the empty command buffer. The queue drains
+* after the clock stops.
+*
+* context: a submission_trial.
+* results: the host time.
+*/
+static void run_submit2_trial(void* context, double* results)
+{
+    VkResult result;
+    submission_trial* trial = context;
+    VkQueue queue = trial->device->queues[trial->queue_index];
+    double frequency = vkstats_stopwatch_get_frequency();
+    uint64_t start_ticks;
+    uint64_t end_ticks;
+
+    VkCommandBufferSubmitInfo cb_si = { 0 };
+    cb_si.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+    cb_si.commandBuffer = trial->command_buffer;
+
+    VkSubmitInfo2 si = { 0 };
+    si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+    si.pCommandBufferInfos = &cb_si;
+    si.commandBufferInfoCount = 1;
+
+    start_ticks = vkstats_stopwatch_get_ticks();
+    result = vkQueueSubmit2(queue, 1, &si, VK_NULL_HANDLE);
+    end_ticks = vkstats_stopwatch_get_ticks();
+    vkstats_trace_host_event("submit", "vkQueueSubmit2", start_ticks, end_ticks, 1);
+    check_result(result, "Could not submit queue!");
+
+    results[0] = (double)(end_ticks - start_ticks) / frequency * 1000.0;
+    vkQueueWaitIdle(queue);
+}
+
+/*
+* run_batch_trial()
+*
+* Times one vkQueueSubmit of batch_size VkSubmitInfos. The queue drains after
+* the clock stops.
+*
+* context: a submission_trial.
+* results: the host time.
+*/
+static void run_batch_trial(void* context, double* results)
+{
+    VkResult result;
+    submission_trial* trial = context;
+    VkQueue queue = trial->device->queues[trial->queue_index];
+    double frequency = vkstats_stopwatch_get_frequency();
+    uint64_t start_ticks;
+    uint64_t end_ticks;
+
+    start_ticks = vkstats_stopwatch_get_ticks();
+    result = vkQueueSubmit(queue, trial->batch_size, trial->submit_infos, VK_NULL_HANDLE);
+    end_ticks = vkstats_stopwatch_get_ticks();
+    vkstats_trace_host_event("submit", "vkQueueSubmit", start_ticks, end_ticks, trial->batch_size);
+    check_result(result, "Could not submit queue!");
+
+    results[0] = (double)(end_ticks - start_ticks) / frequency * 1000.0;
+    vkQueueWaitIdle(queue);
+}
+
+/*
+* run_spin_wakeup_trial()
+*
+* Releases a gated submission from the host and spins on the semaphore
+* counter until the queue signals it.
+*
+* context: a submission_trial.
+* results: the time from the host signal until the counter moved.
+*/
+static void run_spin_wakeup_trial(void* context, double* results)
+{
+    VkResult result;
+    submission_trial* trial = context;
+    vkstats_device* device = trial->device;
+    double frequency = vkstats_stopwatch_get_frequency();
+    uint64_t wait_value = trial->semaphore_value + 1;
+    uint64_t signal_value = trial->semaphore_value + 2;
+    uint64_t counter_value = 0;
+    uint64_t start_ticks;
+    uint64_t end_ticks;
+
+    trial->semaphore_value = signal_value;
+    submit_gated(trial, wait_value, signal_value, VK_NULL_HANDLE);
+
+    VkSemaphoreSignalInfo s_si = { 0 };
+    s_si.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+    s_si.value = wait_value;
+    s_si.semaphore = trial->semaphore;
+
+    start_ticks = vkstats_stopwatch_get_ticks();
+    result = vkSignalSemaphore(device->device, &s_si);
+    check_result(result, "Could not signal semaphore!");
+
+    while (counter_value < signal_value)
+    {
+        result = vkGetSemaphoreCounterValue(device->device, trial->semaphore, &counter_value);
+        check_result(result, "Could not get semaphore counter value!");
+    }
+
+    end_ticks = vkstats_stopwatch_get_ticks();
+    results[0] = (double)(end_ticks - start_ticks) / frequency * 1000.0;
+}
+
+/*
+* run_timeline_wakeup_trial()
+*
+* Releases a gated submission from the host and blocks in vkWaitSemaphores
+* until the queue signals it.
+*
+* context: a submission_trial.
+* results: the time from the host signal until the wait returned.
+*/
+static void run_timeline_wakeup_trial(void* context, double* results)
+{
+    VkResult result;
+    submission_trial* trial = context;
+    vkstats_device* device = trial->device;
+    double frequency = vkstats_stopwatch_get_frequency();
+    uint64_t wait_value = trial->semaphore_value + 1;
+    uint64_t signal_value = trial->semaphore_value + 2;
+    uint64_t start_ticks;
+    uint64_t end_ticks;
+
+    trial->semaphore_value = signal_value;
+    submit_gated(trial, wait_value, signal_value, VK_NULL_HANDLE);
+
+    VkSemaphoreSignalInfo s_si = { 0 };
+    s_si.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+    s_si.value = wait_value;
+    s_si.semaphore = trial->semaphore;
+
+    VkSemaphoreWaitInfo s_wi = { 0 };
+    s_wi.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    s_wi.pSemaphores = &trial->semaphore;
+    s_wi.pValues = &signal_value;
+    s_wi.semaphoreCount = 1;
+
+    start_ticks = vkstats_stopwatch_get_ticks();
+    result = vkSignalSemaphore(device->device, &s_si);
+    check_result(result, "Could not signal semaphore!");
+    result = vkWaitSemaphores(device->device, &s_wi, UINT64_MAX);
+    end_ticks = vkstats_stopwatch_get_ticks();
+    check_result(result, "Could not wait for semaphore!");
+
+    vkstats_trace_host_event("wait", "Signal and vkWaitSemaphores", start_ticks, end_ticks, signal_value);
+
+    results[0] = (double)(end_ticks - start_ticks) / frequency * 1000.0;
+}
+
+/*
+* run_fence_wakeup_trial()
+*
+* Releases a gated submission from the host and blocks in vkWaitForFences
+* until the queue signals its fence.
+*
+* context: a submission_trial.
+* results: the time from the host signal until the wait returned.
+*/
+static void run_fence_wakeup_trial(void* context, double* results)
+{
+    VkResult result;
+    submission_trial* trial = context;
+    vkstats_device* device = trial->device;
+    double frequency = vkstats_stopwatch_get_frequency();
+    uint64_t wait_value = trial->semaphore_value + 1;
+    uint64_t signal_value = trial->semaphore_value + 2;
+    uint64_t start_ticks;
+    uint64_t end_ticks;
+
+    result = vkResetFences(device->device, 1, &trial->fence);
+    check_result(result, "Could not reset fence!");
+
+    trial->semaphore_value = signal_value;
+    submit_gated(trial, wait_value, signal_value, trial->fence);
+
+    VkSemaphoreSignalInfo s_si = { 0 };
+    s_si.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+    s_si.value = wait_value;
+    s_si.semaphore = trial->semaphore;
+
+    start_ticks = vkstats_stopwatch_get_ticks();
+    result = vkSignalSemaphore(device->device, &s_si);
+    check_result(result, "Could not signal semaphore!");
+    result = vkWaitForFences(device->device, 1, &trial->fence, VK_TRUE, UINT64_MAX);
+    end_ticks = vkstats_stopwatch_get_ticks();
+    check_result(result, "Could not wait for fence!");
+
+    vkstats_trace_host_event("wait", "Signal and vkWaitForFences", start_ticks, end_ticks, signal_value);
+
+    results[0] = (double)(end_ticks - start_ticks) / frequency * 1000.0;
+}
+
+/*
+* run_ping_pong_trial()
+*
+* Queues PING_PONG_ROUNDS round trips between the two queues on one timeline
+* semaphore, each queue waiting for the value the other signals, then starts
+* the chain from the host and waits for the end of it.
+*
+* context: a submission_trial.
+* results: the time of one hop from one queue to the other.
+*/
+static void run_ping_pong_trial(void* context, double* results)
+{
+    VkResult result;
+    submission_trial* trial = context;
+    vkstats_device* device = trial->device;
+    double frequency = vkstats_stopwatch_get_frequency();
+    uint64_t base_value = trial->semaphore_value + 1;
+    uint64_t final_value = base_value + 2 * PING_PONG_ROUNDS;
+    VkPipelineStageFlags wait_destination_stage_mask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    uint32_t queue_indices[2] = { trial->queue_index, trial->other_queue_index };
+    uint64_t start_ticks;
+    uint64_t end_ticks;
+
+    trial->semaphore_value = final_value;
+
+    /*
+    * Queue 0 waits for even steps and signals odd ones, queue 1 the other
+    * way around. The submissions carry no commands, only the semaphores.
+    */
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        for (uint32_t j = 0; j < PING_PONG_ROUNDS; j++)
+        {
+            VkTimelineSemaphoreSubmitInfo* ts_si = &trial->ping_pong_timeline_infos[i][j];
+            VkSubmitInfo* si = &trial->ping_pong_submit_infos[i][j];
+            uint64_t* values = trial->ping_pong_values[i][j];
+
+            values[0] = base_value + 2 * j + i;
+            values[1] = values[0] + 1;
+
+            clear_struct(ts_si);
+            ts_si->sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+            ts_si->pWaitSemaphoreValues = &values[0];
+            ts_si->waitSemaphoreValueCount = 1;
+            ts_si->pSignalSemaphoreValues = &values[1];
+            ts_si->signalSemaphoreValueCount = 1;
+
+            clear_struct(si);
+            si->sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            si->pNext = ts_si;
+            si->pWaitSemaphores = &trial->semaphore;
+            si->waitSemaphoreCount = 1;
+            si->pSignalSemaphores = &trial->semaphore;
+            si->signalSemaphoreCount = 1;
+            si->pWaitDstStageMask = &wait_destination_stage_mask;
+        }
+
+        uint64_t submit_ticks = vkstats_stopwatch_get_ticks();
+        result = vkQueueSubmit(device->queues[queue_indices[i]], PING_PONG_ROUNDS, trial->ping_pong_submit_infos[i], VK_NULL_HANDLE);
+        vkstats_trace_host_event("submit", "vkQueueSubmit", submit_ticks, vkstats_stopwatch_get_ticks(), PING_PONG_ROUNDS);
+        check_result(result, "Could not submit queue!");
+    }
+
+    VkSemaphoreSignalInfo s_si = { 0 };
+    s_si.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+    s_si.value = base_value;
+    s_si.semaphore = trial->semaphore;
+
+    start_ticks = vkstats_stopwatch_get_ticks();
+    result = vkSignalSemaphore(device->device, &s_si);
+    check_result(result, "Could not signal semaphore!");
+    vkstats_device_wait_semaphore(device, trial->semaphore, final_value);
+    end_ticks = vkstats_stopwatch_get_ticks();
+
+    results[0] = (double)(end_ticks - start_ticks) / frequency * 1000.0 / (2 * PING_PONG_ROUNDS);
+}
+
+/*
+* submit_gated()
+*
+* Submits the empty command buffer behind a wait on the timeline semaphore,
+* signaling it again when done.
+*
+* trial: the submission_trial.
+* wait_value: the value the queue waits for.
+* signal_value: the value the queue signals.
+* fence: a fence to signal as well, or VK_NULL_HANDLE.
+*/
+static void submit_gated(submission_trial* trial, uint64_t wait_value, uint64_t signal_value, VkFence fence)
+{
+    VkResult result;
+
+    VkTimelineSemaphoreSubmitInfo ts_si = { 0 };
+    ts_si.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    ts_si.pWaitSemaphoreValues = &wait_value;
+    ts_si.waitSemaphoreValueCount = 1;
+    ts_si.pSignalSemaphoreValues = &signal_value;
+    ts_si.signalSemaphoreValueCount = 1;
+
+    VkPipelineStageFlags wait_destination_stage_mask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkSubmitInfo si = { 0 };
+    si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    si.pNext = &ts_si;
+    si.pCommandBuffers = &trial->command_buffer;
+    si.commandBufferCount = 1;
+    si.pWaitSemaphores = &trial->semaphore;
+    si.waitSemaphoreCount = 1;
+    si.pSignalSemaphores = &trial->semaphore;
+    si.signalSemaphoreCount = 1;
+    si.pWaitDstStageMask = &wait_destination_stage_mask;
+
+    uint64_t submit_ticks = vkstats_stopwatch_get_ticks();
+    result = vkQueueSubmit(trial->device->queues[trial->queue_index], 1, &si, fence);
+    vkstats_trace_host_event("submit", "vkQueueSubmit", submit_ticks, vkstats_stopwatch_get_ticks(), 1);
+    check_result(result, "Could not submit queue!");
+}
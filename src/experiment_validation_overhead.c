@@ -0,0 +1,319 @@
+#include <stdio.h>
+
+#include "vulkan/vulkan.h"
+
+#include "device.h"
+#include "util.h"
+#include "instance.h"
+#include "physical_device.h"
+#include "stopwatch.h"
+#include "harness.h"
+#include "memory_arena.h"
+#include "trace.h"
+#include "experiments.h"
+
+#define CALLS_PER_TRIAL 100
+#define COPY_SIZE 256
+#define ALLOCATION_SIZE (UINT64_C(64) * UINT64_C(1024))
+
+typedef enum
+{
+    CALL_SUBMIT,
+    CALL_ALLOCATE,
+    CALL_CREATE_BUFFER,
+    CALL_RECORD_COPY,
+    CALL_COUNT
+} call_type;
+
+static const char* call_names[CALL_COUNT] =
+{
+    "vkQueueSubmit",
+    "vkAllocate/FreeMemory",
+    "vkCreate/DestroyBuffer",
+    "vkCmdCopyBuffer",
+};
+
+typedef struct
+{
+    vkstats_device*     device;
+    VkCommandBuffer     submit_command_buffer;
+    VkCommandBuffer     record_command_buffer;
+    VkBuffer            source_buffer;
+    VkBuffer            destination_buffer;
+    vkstats_stopwatch*  stopwatch;
+} call_trial;
+
+static void run_calls(uint32_t device_index, VkBool32 validation, vkstats_harness* harness, vkstats_statistics* statistics);
+static void run_submit_trial(void* context, double* results);
+static void run_allocate_trial(void* context, double* results);
+static void run_create_buffer_trial(void* context, double* results);
+static void run_record_copy_trial(void* context, double* results);
+
+static const vkstats_trial_function call_trials[CALL_COUNT] =
+{
+    run_submit_trial,
+    run_allocate_trial,
+    run_create_buffer_trial,
+    run_record_copy_trial,
+};
+
+void vkstats_experiment_validation_overhead(uint32_t device_index, vkstats_harness* harness)
+{
+    vkstats_statistics statistics[2][CALL_COUNT];
+    VkBool32 validation_available;
+
+    printf("\n");
+    printf("Running validation overhead experiment.\n");
+
+    validation_available = vkstats_instance_has_layer(VKSTATS_VALIDATION_LAYER);
+
+    run_calls(device_index, VK_FALSE, harness, statistics[0]);
+
+    if (!validation_available)
+    {
+        printf("%s is not available, only measuring without layers.\n", VKSTATS_VALIDATION_LAYER);
+        return;
+    }
+
+    run_calls(device_index, VK_TRUE, harness, statistics[1]);
+
+    /*
+    * Each trial makes CALLS_PER_TRIAL calls, so the median trial time in
+    * milliseconds becomes microseconds per call.
+    */
+    printf("\n");
+    printf("%-24s %14s %14s %14s\n", "Per call (us)", "No layers", "Validation", "Overhead");
+
+    for (uint32_t i = 0; i < CALL_COUNT; i++)
+    {
+        double plain = statistics[0][i].median * 1000.0 / CALLS_PER_TRIAL;
+        double validated = statistics[1][i].median * 1000.0 / CALLS_PER_TRIAL;
+
+        printf("%-24s %14.3f %14.3f %14.3f\n", call_names[i], plain, validated, validated - plain);
+    }
+}
+
+/*
+* run_calls()
+*
+* Creates an instance and device of its own, with or without the validation
+* layer, and times each call type on it.
+*
+* device_index: the index of the physical device to use.
+* validation: whether to enable the validation layer.
+* harness: the harness to take the measurements with.
+* statistics: the statistics for each call type will be placed here, indexed
+*             by call_type.
+*/
+static void run_calls(uint32_t device_index, VkBool32 validation, vkstats_harness* harness, vkstats_statistics* statistics)
+{
+    const char* mode = validation ? "validation" : "no layers";
+    char label[96];
+
+    vkstats_stopwatch stopwatch;
+    vkstats_stopwatch_init(&stopwatch);
+
+    vkstats_instance instance;
+    vkstats_instance_create(&instance, validation);
+
+    vkstats_physical_device physical_device;
+    vkstats_physical_device_get(&physical_device, instance.instance, device_index);
+
+    vkstats_device device;
+    vkstats_device_builder builder;
+    vkstats_device_builder_init(&builder, &physical_device);
+    vkstats_device_builder_add_queue(&builder, VK_QUEUE_TRANSFER_BIT);
+    vkstats_device_builder_build(&builder, &device);
+
+    vkstats_harness_begin_experiment(harness, "validation_overhead", &device, 0);
+    vkstats_harness_set_memory_types(harness, device.host_visible_memory_index, device.device_local_memory_index);
+
+    /*
+    * The copy source and destination are bound to memory, so validation
+    * checks them the way it would in a real application rather than
+    * reporting errors.
+    */
+    vkstats_memory_arena arena;
+    vkstats_memory_arena_init(&arena, &device);
+
+    VkBufferCreateInfo b_ci = { 0 };
+    b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    b_ci.pQueueFamilyIndices = &device.queue_family_indices[0];
+    b_ci.queueFamilyIndexCount = 1;
+    b_ci.size = COPY_SIZE;
+    b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    b_ci.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    vkstats_memory_arena_reserve(&arena, &b_ci, device.host_visible_memory_index);
+    b_ci.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    vkstats_memory_arena_reserve(&arena, &b_ci, device.device_local_memory_index);
+    vkstats_memory_arena_allocate(&arena);
+
+    call_trial trial;
+    trial.device = &device;
+    trial.stopwatch = &stopwatch;
+    trial.source_buffer = vkstats_device_create_buffer(&device, COPY_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 0);
+    trial.destination_buffer = vkstats_device_create_buffer(&device, COPY_SIZE, VK_BUFFER_USAGE_TRANSFER_DST_BIT, 0);
+    vkstats_memory_arena_bind_buffer(&arena, trial.source_buffer, device.host_visible_memory_index);
+    vkstats_memory_arena_bind_buffer(&arena, trial.destination_buffer, device.device_local_memory_index);
+
+    /*
+    * The submitted command buffer is empty and is pending many times at once,
+    * so it needs simultaneous use.
+    */
+    trial.submit_command_buffer = vkstats_device_allocate_command_buffer(&device, 0);
+    trial.record_command_buffer = vkstats_device_allocate_command_buffer(&device, 0);
+
+    VkCommandBufferBeginInfo cb_bi = { 0 };
+    cb_bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    cb_bi.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+    vkBeginCommandBuffer(trial.submit_command_buffer, &cb_bi);
+    vkEndCommandBuffer(trial.submit_command_buffer);
+
+    for (uint32_t i = 0; i < CALL_COUNT; i++)
+    {
+        vkstats_harness_run(harness, call_trials[i], &trial, 1, &statistics[i]);
+
+        snprintf(label, sizeof(label), "%s x%u, %s", call_names[i], CALLS_PER_TRIAL, mode);
+        vkstats_harness_record(harness, label, &statistics[i], 0);
+    }
+
+    vkDeviceWaitIdle(device.device);
+    vkFreeCommandBuffers(device.device, device.command_pools[0], 1, &trial.submit_command_buffer);
+    vkFreeCommandBuffers(device.device, device.command_pools[0], 1, &trial.record_command_buffer);
+    vkDestroyBuffer(device.device, trial.source_buffer, NULL);
+    vkDestroyBuffer(device.device, trial.destination_buffer, NULL);
+    vkstats_memory_arena_destroy(&arena);
+    vkstats_device_destroy(&device);
+    vkstats_instance_destroy(&instance);
+}
+
+/*
+* run_submit_trial()
+*
+* Submits an empty command buffer CALLS_PER_TRIAL times. The queue drains
+* after the clock stops.
+*
+* context: a call_trial.
+* results: the host time.
+*/
+static void run_submit_trial(void* context, double* results)
+{
+    VkResult result;
+    call_trial* trial = context;
+    VkQueue queue = trial->device->queues[0];
+
+    VkSubmitInfo si = { 0 };
+    si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    si.pCommandBuffers = &trial->submit_command_buffer;
+    si.commandBufferCount = 1;
+
+    /*
+    * One trace event covers the whole run of calls, so tracing stays out of
+    * the per-call cost.
+    */
+    uint64_t start_ticks = vkstats_stopwatch_get_ticks();
+    vkstats_stopwatch_start(trial->stopwatch);
+
+    for (uint32_t i = 0; i < CALLS_PER_TRIAL; i++)
+    {
+        result = vkQueueSubmit(queue, 1, &si, VK_NULL_HANDLE);
+        check_result(result, "Could not submit queue!");
+    }
+
+    results[0] = vkstats_stopwatch_stop(trial->stopwatch);
+    uint64_t end_ticks = vkstats_stopwatch_get_ticks();
+    vkstats_trace_host_event("submit", "vkQueueSubmit", start_ticks, end_ticks, CALLS_PER_TRIAL);
+
+    vkQueueWaitIdle(queue);
+    vkstats_trace_host_event("wait", "vkQueueWaitIdle", end_ticks, vkstats_stopwatch_get_ticks(), CALLS_PER_TRIAL);
+}
+
+/*
+* run_allocate_trial()
+*
+* Allocates and frees a small block of host-visible memory CALLS_PER_TRIAL
+* times.
+*
+* context: a call_trial.
+* results: the host time.
+*/
+static void run_allocate_trial(void* context, double* results)
+{
+    VkResult result;
+    call_trial* trial = context;
+    VkDeviceMemory memory;
+
+    VkMemoryAllocateInfo m_ai = { 0 };
+    m_ai.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    m_ai.allocationSize = ALLOCATION_SIZE;
+    m_ai.memoryTypeIndex = trial->device->host_visible_memory_index;
+
+    uint64_t start_ticks = vkstats_stopwatch_get_ticks();
+    vkstats_stopwatch_start(trial->stopwatch);
+
+    for (uint32_t i = 0; i < CALLS_PER_TRIAL; i++)
+    {
+        result = vkAllocateMemory(trial->device->device, &m_ai, NULL, &memory);
+        check_result(result, "Could not allocate memory!");
+        vkFreeMemory(trial->device->device, memory, NULL);
+    }
+
+    results[0] = vkstats_stopwatch_stop(trial->stopwatch);
+    vkstats_trace_host_event("allocation", "vkAllocateMemory", start_ticks, vkstats_stopwatch_get_ticks(), ALLOCATION_SIZE * CALLS_PER_TRIAL);
+}
+
+/*
+* run_create_buffer_trial()
+*
+* Creates and destroys a buffer CALLS_PER_TRIAL times.
+*
+* context: a call_trial.
+* results: the host time.
+*/
+static void run_create_buffer_trial(void* context, double* results)
+{
+    call_trial* trial = context;
+    VkBuffer buffer;
+
+    vkstats_stopwatch_start(trial->stopwatch);
+
+    for (uint32_t i = 0; i < CALLS_PER_TRIAL; i++)
+    {
+        buffer = vkstats_device_create_buffer(trial->device, COPY_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 0);
+        vkDestroyBuffer(trial->device->device, buffer, NULL);
+    }
+
+    results[0] = vkstats_stopwatch_stop(trial->stopwatch);
+}
+
+/*
+* run_record_copy_trial()
+*
+* Records a command buffer of CALLS_PER_TRIAL buffer copies. Beginning the
+* command buffer resets it, and that is counted too.
+*
+* context: a call_trial.
+* results: the host time.
+*/
+static void run_record_copy_trial(void* context, double* results)
+{
+    call_trial* trial = context;
+
+    VkCommandBufferBeginInfo cb_bi = { 0 };
+    cb_bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    cb_bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    VkBufferCopy buffer_copy = { 0 };
+    buffer_copy.size = COPY_SIZE;
+
+    vkstats_stopwatch_start(trial->stopwatch);
+    vkBeginCommandBuffer(trial->record_command_buffer, &cb_bi);
+
+    for (uint32_t i = 0; i < CALLS_PER_TRIAL; i++)
+    {
+        vkCmdCopyBuffer(trial->record_command_buffer, trial->source_buffer, trial->destination_buffer, 1, &buffer_copy);
+    }
+
+    vkEndCommandBuffer(trial->record_command_buffer);
+    results[0] = vkstats_stopwatch_stop(trial->stopwatch);
+}
@@ -1,3 +1,5 @@
+#include <inttypes.h>
+#include <math.h>
 #include <stdio.h>
 
 #include "vulkan/vulkan.h"
@@ -5,9 +7,64 @@
 #include "device.h"
 #include "util.h"
 #include "stopwatch.h"
+#include "harness.h"
+#include "memory_arena.h"
+#include "calibration.h"
+#include "trace.h"
 #include "experiments.h"
 
-void vkstats_experiment_queue_transfer_speed(vkstats_device *device, uint32_t queue_index)
+#define MIN_TRANSFER_SIZE 4
+#define MAX_TRANSFER_SIZE (UINT64_C(2) * UINT64_C(1024) * UINT64_C(1024) * UINT64_C(1024))
+
+/*
+* Room left in an arena allocation for the alignment padding added to each
+* reservation.
+*/
+#define ARENA_PADDING (UINT64_C(64) * UINT64_C(1024))
+
+/*
+* A step that changes the bandwidth by more than this fraction is followed by
+* half steps.
+*/
+#define DENSE_THRESHOLD 0.25
+
+/*
+* Steps within this fraction of each other, or within the noise, count as
+* flat. The sweep stops once the curve has stayed flat over PLATEAU_SPAN
+* times the size.
+*/
+#define PLATEAU_TOLERANCE 0.03
+#define PLATEAU_SPAN 8
+#define CONFIDENCE_Z 1.96
+
+typedef struct
+{
+    vkstats_device*         device;
+    uint32_t                queue_index;
+    VkCommandBuffer         command_buffer;
+    VkSemaphore             semaphore;
+    uint64_t                semaphore_value;
+    VkQueryPool             query_pool;
+    VkDeviceSize            size;
+    vkstats_stopwatch*      stopwatch;
+    vkstats_calibration*    calibration;
+} transfer_trial;
+
+static VkDeviceSize get_max_transfer_size(vkstats_device* device);
+static double get_relative_error(const vkstats_statistics* statistics);
+static void run_transfer_trial(void* context, double* results);
+
+void vkstats_experiment_init_device_builder(vkstats_device_builder* builder, vkstats_physical_device* physical_device)
+{
+    vkstats_device_builder_init(builder, physical_device);
+    vkstats_device_builder_add_queue(builder, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_TRANSFER_BIT);
+    vkstats_device_builder_add_queue(builder, VK_QUEUE_TRANSFER_BIT);
+    vkstats_device_builder_add_queue(builder, VK_QUEUE_COMPUTE_BIT);
+    vkstats_calibration_add_extension(builder);
+    vkstats_device_builder_add_extension(builder, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME);
+}
+
+void vkstats_experiment_queue_transfer_speed(vkstats_device *device, uint32_t queue_index, vkstats_harness* harness)
 {
     VkResult result;
 
@@ -16,6 +73,8 @@ void vkstats_experiment_queue_transfer_speed(vkstats_device *device, uint32_t qu
 
     printf("\n");
     printf("Running queue transfer speed experiment.\n");
+    vkstats_harness_begin_experiment(harness, "queue_transfer_speed", device, queue_index);
+    vkstats_harness_set_memory_types(harness, device->host_visible_memory_index, device->device_local_memory_index);
     printf("Queue flags:\n");
 
     if (device->queue_flags[queue_index] & VK_QUEUE_GRAPHICS_BIT)
@@ -54,49 +113,97 @@ void vkstats_experiment_queue_transfer_speed(vkstats_device *device, uint32_t qu
     printf("\n");
 
     /*
-    * Create the command buffer to use.
+    * Create the command buffer to use, and a timeline semaphore to
+    * trigger/wait on the queue.
+    */
+    VkCommandBuffer command_buffer = vkstats_device_allocate_command_buffer(device, queue_index);
+    VkSemaphore semaphore = vkstats_device_create_timeline_semaphore(device);
+
+    /*
+    * Create a query pool to bracket the copy with device timestamps. Queue
+    * families without valid timestamp bits can't write them, so only the host
+    * time is reported for those.
     */
-    VkCommandBuffer command_buffer;
-    VkCommandBufferAllocateInfo cb_ci = { 0 };
-    cb_ci.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    cb_ci.commandBufferCount = 1;
-    cb_ci.commandPool = device->command_pools[queue_index];
-    result = vkAllocateCommandBuffers(device->device, &cb_ci, &command_buffer);
-    check_result(result, "Could not allocate command buffer!");
+    VkBool32 timestamps_supported = device->queue_family_properties[queue_index].timestampValidBits > 0;
+    VkQueryPool query_pool = VK_NULL_HANDLE;
+
+    if (timestamps_supported)
+    {
+        VkQueryPoolCreateInfo qp_ci = { 0 };
+        qp_ci.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        qp_ci.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        qp_ci.queryCount = 2;
+        result = vkCreateQueryPool(device->device, &qp_ci, NULL, &query_pool);
+        check_result(result, "Could not create query pool!");
+    }
+
+    /*
+    * With calibrated timestamps the device timestamps can be placed on the
+    * host timeline, which splits the upload into phases.
+    */
+    vkstats_calibration calibration;
+    vkstats_calibration_init(&calibration, device, queue_index);
+
+    if (!calibration.supported)
+    {
+        printf("Calibrated timestamps are not available, no phase breakdown.\n\n");
+    }
+
+    uint32_t metric_count = calibration.supported ? 5 : timestamps_supported ? 2 : 1;
+
+    transfer_trial trial;
+    trial.device = device;
+    trial.queue_index = queue_index;
+    trial.command_buffer = command_buffer;
+    trial.semaphore = semaphore;
+    trial.semaphore_value = 0;
+    trial.query_pool = query_pool;
+    trial.size = 0;
+    trial.stopwatch = &stopwatch;
+    trial.calibration = &calibration;
 
     /*
-    * Create a timeline semaphore to trigger/wait on the queue.
+    * Memory for the largest size is allocated up front, and every size in the
+    * sweep is bound to the start of it, so the sweep doesn't spend its time
+    * allocating and freeing.
     */
-    VkSemaphore semaphore;
-    VkSemaphoreTypeCreateInfo st_ci = { 0 };
-    st_ci.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
-    st_ci.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    VkDeviceSize max_size = get_max_transfer_size(device);
+    printf("Sweeping up to %" PRIu64 " bytes.\n\n", max_size);
 
-    VkSemaphoreCreateInfo s_ci = { 0 };
-    s_ci.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-    s_ci.pNext = &st_ci;
-    result = vkCreateSemaphore(device->device, &s_ci, NULL, &semaphore);
-    check_result(result, "Could not create semaphore!");
+    vkstats_memory_arena arena;
+    vkstats_memory_arena_init(&arena, device);
 
-    uint64_t semaphore_value = 0;
+    VkBufferCreateInfo b_ci = { 0 };
+    b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    b_ci.pQueueFamilyIndices = &device->queue_family_indices[queue_index];
+    b_ci.queueFamilyIndexCount = 1;
+    b_ci.size = max_size;
+    b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    b_ci.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    vkstats_memory_arena_reserve(&arena, &b_ci, device->host_visible_memory_index);
+    b_ci.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    vkstats_memory_arena_reserve(&arena, &b_ci, device->device_local_memory_index);
+    vkstats_memory_arena_allocate(&arena);
 
     /*
-    * TODO: Check maximum allocation size and stop there.
+    * The sweep doubles the size, switching to half steps while the bandwidth
+    * is still changing quickly, and stops once it has plateaued.
     */
-    for (VkDeviceSize size = 4; size <= UINT64_C(2) * UINT64_C(1024) * UINT64_C(1024) * UINT64_C(1024); size *= 2)
+    double previous_bandwidth = 0.0;
+    double previous_error = 0.0;
+    VkDeviceSize plateau_start = MIN_TRANSFER_SIZE;
+    VkBool32 dense = VK_FALSE;
+    VkDeviceSize size = MIN_TRANSFER_SIZE;
+
+    while (size <= max_size)
     {
         /*
         * Create source and destination buffers.
         */
         VkBuffer destination_buffer;
         VkBuffer source_buffer;
-        VkBufferCreateInfo b_ci = { 0 };
-        b_ci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         b_ci.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-        b_ci.pQueueFamilyIndices = &device->queue_family_indices[queue_index];
-        b_ci.queueFamilyIndexCount = 1;
         b_ci.size = size;
-        b_ci.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
         result = vkCreateBuffer(device->device, &b_ci, NULL, &source_buffer);
         check_result(result, "Could not create buffer!");
 
@@ -105,112 +212,321 @@ void vkstats_experiment_queue_transfer_speed(vkstats_device *device, uint32_t qu
         check_result(result, "Could not create buffer!");
 
         /*
-        * Create memory for the buffers.
+        * Bind the buffers to the arena.
         */
-        VkDeviceMemory source_memory;
-        VkDeviceMemory destination_memory;
-        VkMemoryAllocateInfo m_ai = { 0 };
-        m_ai.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        m_ai.allocationSize = size;
-        m_ai.memoryTypeIndex = device->host_visible_memory_index;
-        result = vkAllocateMemory(device->device, &m_ai, NULL, &source_memory);
-        check_result(result, "Could not allocate memory!");
-
-        m_ai.memoryTypeIndex = device->device_local_memory_index;
-        result = vkAllocateMemory(device->device, &m_ai, NULL, &destination_memory);
-        check_result(result, "Could not allocate memory!");
-
-        result = vkBindBufferMemory(device->device, source_buffer, source_memory, 0);
-        check_result(result, "Could not bind buffer memory!");
-        result = vkBindBufferMemory(device->device, destination_buffer, destination_memory, 0);
-        check_result(result, "Could not bind buffer memory!");
+        vkstats_memory_arena_reset(&arena);
+        vkstats_memory_arena_bind_buffer(&arena, source_buffer, device->host_visible_memory_index);
+        vkstats_memory_arena_bind_buffer(&arena, destination_buffer, device->device_local_memory_index);
 
         /*
-        * Create  command buffer and issue the copy command.
+        * Record the copy command. The command buffer is submitted once per
+        * trial, so it can't be one-time-submit.
         */
         VkCommandBufferBeginInfo cb_bi = { 0 };
         cb_bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        cb_bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
         vkBeginCommandBuffer(command_buffer, &cb_bi);
+
+        if (timestamps_supported)
+        {
+            /*
+            * The start timestamp is written at the transfer stage so that it
+            * is ordered after the submit's semaphore wait. At the top of the
+            * pipe it could land before the host releases the queue.
+            */
+            vkCmdResetQueryPool(command_buffer, query_pool, 0, 2);
+            vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, query_pool, 0);
+        }
+
         VkBufferCopy buffer_copy = { 0 };
         buffer_copy.size = size;
         vkCmdCopyBuffer(command_buffer, source_buffer, destination_buffer, 1, &buffer_copy);
+
+        if (timestamps_supported)
+        {
+            vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, query_pool, 1);
+        }
+
         vkEndCommandBuffer(command_buffer);
+        trial.size = size;
 
         /*
-        * Timeline semaphore value increases by two every loop. One for the
-        * queue to wait upon and one to signal when complete.
+        * Run the trials and report the host time, and the device time if the
+        * queue supports timestamps.
         */
-        semaphore_value += 2;
+        vkstats_statistics statistics[5];
+        char label[64];
 
-        uint64_t wait_value = semaphore_value;
-        uint64_t signal_value = semaphore_value + 1;
+        vkstats_harness_run(harness, run_transfer_trial, &trial, metric_count, statistics);
 
-        /*
-        * Don't start the queue until the semaphore is signaled, and set a
-        * different signal when it's done. That will allow us to carefully
-        * control the start/end time from the host.
-        */
-        VkTimelineSemaphoreSubmitInfo ts_si = { 0 };
-        ts_si.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
-        ts_si.pWaitSemaphoreValues = &wait_value;
-        ts_si.waitSemaphoreValueCount = 1;
-        ts_si.pSignalSemaphoreValues = &signal_value;
-        ts_si.signalSemaphoreValueCount = 1;
-
-        VkPipelineStageFlags wait_destination_stage_mask = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        VkSubmitInfo si = { 0 };
-        si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        si.pNext = &ts_si;
-        si.pCommandBuffers = &command_buffer;
-        si.commandBufferCount = 1;
-        si.pWaitSemaphores = &semaphore;
-        si.waitSemaphoreCount = 1;
-        si.pSignalSemaphores = &semaphore;
-        si.signalSemaphoreCount = 1;
-        si.pWaitDstStageMask = &wait_destination_stage_mask;
+        snprintf(label, sizeof(label), "Uploading %" PRIu64 " bytes (host)", size);
+        vkstats_harness_report(harness, label, &statistics[0]);
 
-        /*
-        * Wait until everything is quiet and submit the queue.
-        */
-        vkDeviceWaitIdle(device->device);
-        vkQueueSubmit(device->queues[queue_index], 1, &si, VK_NULL_HANDLE);
+        if (timestamps_supported)
+        {
+            snprintf(label, sizeof(label), "Uploading %" PRIu64 " bytes (device)", size);
+            vkstats_harness_report(harness, label, &statistics[1]);
+        }
+
+        if (calibration.supported)
+        {
+            snprintf(label, sizeof(label), "Uploading %" PRIu64 " bytes (submit)", size);
+            vkstats_harness_record(harness, label, &statistics[2], 0);
+            snprintf(label, sizeof(label), "Uploading %" PRIu64 " bytes (queue start)", size);
+            vkstats_harness_record(harness, label, &statistics[3], 0);
+            snprintf(label, sizeof(label), "Uploading %" PRIu64 " bytes (completion and wakeup)", size);
+            vkstats_harness_record(harness, label, &statistics[4], 0);
+
+            printf("  Phases: submit %.3f, queue start %.3f, copy %.3f, completion and wakeup %.3f ms\n",
+                statistics[2].median,
+                statistics[3].median,
+                statistics[1].median,
+                statistics[4].median);
+        }
+
+        vkDestroyBuffer(device->device, source_buffer, NULL);
+        vkDestroyBuffer(device->device, destination_buffer, NULL);
 
         /*
-        * Set up the semaphores to use for the test. We will signal the wait
-        * value to trigger the queue, and then wait upon the signal value.
+        * Compare against the previous size, using the device time if there is
+        * one. The step is flat if the change is below the tolerance or the
+        * combined confidence interval of the two means.
         */
-        VkSemaphoreSignalInfo s_si = { 0 };
-        s_si.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
-        s_si.value = wait_value;
-        s_si.semaphore = semaphore;
+        vkstats_statistics* timed = timestamps_supported ? &statistics[1] : &statistics[0];
+        double bandwidth = vkstats_get_bandwidth(size, timed->mean);
+        double error = get_relative_error(timed);
+
+        if (previous_bandwidth > 0.0)
+        {
+            double change = bandwidth / previous_bandwidth - 1.0;
+            double bound = CONFIDENCE_Z * sqrt(error * error + previous_error * previous_error);
+
+            change = change < 0.0 ? -change : change;
+            dense = change > DENSE_THRESHOLD;
 
-        VkSemaphoreWaitInfo s_wi = { 0 };
-        s_wi.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
-        s_wi.pSemaphores = &semaphore;
-        s_wi.pValues = &signal_value;
-        s_wi.semaphoreCount = 1;
+            if (change > PLATEAU_TOLERANCE && change > bound)
+            {
+                plateau_start = size;
+            }
+            else if (size >= plateau_start * PLATEAU_SPAN)
+            {
+                printf("Bandwidth flat since %" PRIu64 " bytes, stopping.\n", plateau_start);
+                break;
+            }
+        }
+
+        previous_bandwidth = bandwidth;
+        previous_error = error;
 
         /*
-        * Run the experiment.
+        * Sizes stay on powers of two and the points halfway between them.
         */
-        double elapsed;
-        vkstats_stopwatch_start(&stopwatch);
-        vkSignalSemaphore(device->device, &s_si);
-        vkWaitSemaphores(device->device, &s_wi, UINT64_MAX);
-        elapsed = vkstats_stopwatch_stop(&stopwatch);
-        vkDeviceWaitIdle(device->device);
+        VkDeviceSize power = MIN_TRANSFER_SIZE;
 
-        printf("Uploading %u bytes: %.2f ms\n", (uint32_t)size, elapsed);
+        while (power * 2 <= size)
+        {
+            power *= 2;
+        }
 
-        vkFreeMemory(device->device, source_memory, NULL);
-        vkFreeMemory(device->device, destination_memory, NULL);
-        vkDestroyBuffer(device->device, source_buffer, NULL);
-        vkDestroyBuffer(device->device, destination_buffer, NULL);
+        size = dense && size == power ? power + power / 2 : power * 2;
+    }
+
+    vkstats_memory_arena_destroy(&arena);
 
+    if (timestamps_supported)
+    {
+        vkDestroyQueryPool(device->device, query_pool, NULL);
     }
 
     vkFreeCommandBuffers(device->device, device->command_pools[queue_index], 1, &command_buffer);
     vkDestroySemaphore(device->device, semaphore, NULL);
-}
\ No newline at end of file
+}
+
+/*
+* get_max_transfer_size()
+*
+* Gets the largest size the sweep can allocate on both sides. Capped by
+* maxMemoryAllocationSize, shared between the two buffers if they come from
+* the same memory type since the arena makes one allocation per type, and by
+* half the remaining budget of each heap, shared between the two buffers if
+* they come from the same heap, then rounded down to a power of two.
+*
+* device: the device to run on.
+*
+* Returns the largest transfer size in bytes.
+*/
+static VkDeviceSize get_max_transfer_size(vkstats_device* device)
+{
+    vkstats_physical_device* physical_device = device->physical_device;
+    const VkPhysicalDeviceMemoryProperties* memory_properties = &physical_device->memory_properties;
+    uint32_t source_heap = memory_properties->memoryTypes[device->host_visible_memory_index].heapIndex;
+    uint32_t destination_heap = memory_properties->memoryTypes[device->device_local_memory_index].heapIndex;
+    VkDeviceSize source_budget = vkstats_physical_device_get_heap_budget(physical_device, source_heap) / 2;
+    VkDeviceSize destination_budget = vkstats_physical_device_get_heap_budget(physical_device, destination_heap) / 2;
+    VkDeviceSize allocation_limit = physical_device->max_memory_allocation_size;
+    VkDeviceSize limit = MAX_TRANSFER_SIZE;
+
+    if (source_heap == destination_heap)
+    {
+        source_budget /= 2;
+        destination_budget /= 2;
+    }
+
+    if (device->host_visible_memory_index == device->device_local_memory_index)
+    {
+        allocation_limit /= 2;
+    }
+
+    allocation_limit = allocation_limit > ARENA_PADDING ? allocation_limit - ARENA_PADDING : MIN_TRANSFER_SIZE;
+    limit = allocation_limit < limit ? allocation_limit : limit;
+    limit = source_budget < limit ? source_budget : limit;
+    limit = destination_budget < limit ? destination_budget : limit;
+
+    VkDeviceSize size = MIN_TRANSFER_SIZE;
+
+    while (size * 2 <= limit)
+    {
+        size *= 2;
+    }
+
+    return size;
+}
+
+/*
+* get_relative_error()
+*
+* Gets the standard error of the mean relative to the mean.
+*
+* statistics: the statistics of the trials.
+*
+* Returns the relative standard error.
+*/
+static double get_relative_error(const vkstats_statistics* statistics)
+{
+    if (statistics->count == 0 || statistics->mean <= 0.0)
+    {
+        return 0.0;
+    }
+
+    return statistics->stddev / (statistics->mean * sqrt((double)statistics->count));
+}
+
+/*
+* run_transfer_trial()
+*
+* Submits the recorded copy, then releases it from the host and waits for it
+* to complete.
+*
+* context: a transfer_trial.
+* results: the host time, followed by the device time if the queue supports
+*          timestamps. With calibrated timestamps, then the time spent in
+*          vkQueueSubmit, from the host signal to the copy starting, and from
+*          the copy ending to the host waking up.
+*/
+static void run_transfer_trial(void* context, double* results)
+{
+    VkResult result;
+    transfer_trial* trial = context;
+    vkstats_device* device = trial->device;
+    uint64_t submit_ticks;
+    uint64_t submitted_ticks;
+    uint64_t signal_ticks;
+    uint64_t wake_ticks;
+
+    /*
+    * Timeline semaphore value increases by two every trial. One for the
+    * queue to wait upon and one to signal when complete.
+    */
+    trial->semaphore_value += 2;
+
+    uint64_t wait_value = trial->semaphore_value;
+    uint64_t signal_value = trial->semaphore_value + 1;
+
+    /*
+    * Don't start the queue until the semaphore is signaled, and set a
+    * different signal when it's done. That will allow us to carefully
+    * control the start/end time from the host.
+    */
+    VkTimelineSemaphoreSubmitInfo ts_si = { 0 };
+    ts_si.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    ts_si.pWaitSemaphoreValues = &wait_value;
+    ts_si.waitSemaphoreValueCount = 1;
+    ts_si.pSignalSemaphoreValues = &signal_value;
+    ts_si.signalSemaphoreValueCount = 1;
+
+    VkPipelineStageFlags wait_destination_stage_mask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    VkSubmitInfo si = { 0 };
+    si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    si.pNext = &ts_si;
+    si.pCommandBuffers = &trial->command_buffer;
+    si.commandBufferCount = 1;
+    si.pWaitSemaphores = &trial->semaphore;
+    si.waitSemaphoreCount = 1;
+    si.pSignalSemaphores = &trial->semaphore;
+    si.signalSemaphoreCount = 1;
+    si.pWaitDstStageMask = &wait_destination_stage_mask;
+
+    /*
+    * Wait until everything is quiet and submit the queue.
+    */
+    vkDeviceWaitIdle(device->device);
+
+    if (trial->calibration->supported)
+    {
+        vkstats_calibration_update(trial->calibration);
+    }
+
+    submit_ticks = vkstats_stopwatch_get_ticks();
+    vkQueueSubmit(device->queues[trial->queue_index], 1, &si, VK_NULL_HANDLE);
+    submitted_ticks = vkstats_stopwatch_get_ticks();
+    vkstats_trace_host_event("submit", "vkQueueSubmit", submit_ticks, submitted_ticks, trial->size);
+
+    /*
+    * Set up the semaphores to use for the test. We will signal the wait
+    * value to trigger the queue, and then wait upon the signal value.
+    */
+    VkSemaphoreSignalInfo s_si = { 0 };
+    s_si.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+    s_si.value = wait_value;
+    s_si.semaphore = trial->semaphore;
+
+    VkSemaphoreWaitInfo s_wi = { 0 };
+    s_wi.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    s_wi.pSemaphores = &trial->semaphore;
+    s_wi.pValues = &signal_value;
+    s_wi.semaphoreCount = 1;
+
+    /*
+    * Run the experiment.
+    */
+    signal_ticks = vkstats_stopwatch_get_ticks();
+    vkstats_stopwatch_start(trial->stopwatch);
+    vkSignalSemaphore(device->device, &s_si);
+    vkWaitSemaphores(device->device, &s_wi, UINT64_MAX);
+    results[0] = vkstats_stopwatch_stop(trial->stopwatch);
+    wake_ticks = vkstats_stopwatch_get_ticks();
+    vkstats_trace_host_event("wait", "Signal and wait", signal_ticks, wake_ticks, trial->size);
+    vkDeviceWaitIdle(device->device);
+
+    if (trial->query_pool != VK_NULL_HANDLE)
+    {
+        uint64_t timestamps[2];
+        result = vkGetQueryPoolResults(device->device, trial->query_pool, 0, 2, sizeof(timestamps), timestamps, sizeof(timestamps[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+        check_result(result, "Could not get query pool results!");
+
+        results[1] = vkstats_device_get_timestamp_elapsed(device, trial->queue_index, timestamps);
+
+        if (trial->calibration->supported)
+        {
+            double frequency = vkstats_stopwatch_get_frequency();
+            double start_ticks = vkstats_calibration_get_host_ticks(trial->calibration, timestamps[0]);
+            double end_ticks = vkstats_calibration_get_host_ticks(trial->calibration, timestamps[1]);
+
+            results[2] = (double)(submitted_ticks - submit_ticks) / frequency * 1000.0;
+            results[3] = (start_ticks - (double)signal_ticks) / frequency * 1000.0;
+            results[4] = ((double)wake_ticks - end_ticks) / frequency * 1000.0;
+
+            vkstats_trace_queue_event("vkCmdCopyBuffer", device->queues[trial->queue_index], start_ticks, end_ticks, trial->size);
+        }
+    }
+}
@@ -1,6 +1,307 @@
 #if !defined(VKSTATS_EXPERIMENTS_H)
 #define VKSTATS_EXPERIMENTS_H
 
-void vkstats_experiment_queue_transfer_speed(vkstats_device* device, uint32_t queue_index);
+#include <stdint.h>
+
+#include "device.h"
+#include "harness.h"
+
+/*
+* vkstats_experiment_init_device_builder()
+*
+* Sets up a device builder for the device the experiments run on: graphics,
+* transfer and compute queues, in that order, and the extensions the
+* experiments use when the device supports them.
+*
+* builder: the builder to initialize.
+* physical_device: the physical device to create the device for.
+*/
+void vkstats_experiment_init_device_builder(vkstats_device_builder* builder, vkstats_physical_device* physical_device);
+
+/*
+* vkstats_experiment_queue_transfer_speed()
+*
+* Measures how long a copy from host-visible to device-local memory takes on
+* a queue, for sizes from 4 bytes up to 2 GiB. The sweep is capped by the
+* largest allocation and the heap budgets, takes half steps where the
+* bandwidth is still changing, and stops once it has flattened out.
+*
+* device: the device to run on.
+* queue_index: the index of the queue in the device to run on.
+* harness: the harness to take the measurements with.
+*/
+void vkstats_experiment_queue_transfer_speed(vkstats_device* device, uint32_t queue_index, vkstats_harness* harness);
+
+/*
+* vkstats_experiment_queue_streaming_bandwidth()
+*
+* Measures sustained host-visible to device-local copy bandwidth on a queue
+* by keeping several copies in flight, for a range of chunk sizes and queue
+* depths.
+*
+* device: the device to run on.
+* queue_index: the index of the queue in the device to run on.
+* harness: the harness to take the measurements with.
+*/
+void vkstats_experiment_queue_streaming_bandwidth(vkstats_device* device, uint32_t queue_index, vkstats_harness* harness);
+
+/*
+* vkstats_experiment_concurrent_queue_transfer()
+*
+* Measures whether the device's queues add bandwidth when copying at the same
+* time. One host thread per queue submits a copy, and all queues are released
+* together by a single timeline semaphore signal. Runs with 1..N queues
+* active and reports per-queue and aggregate bandwidth.
+*
+* device: the device to run on.
+* harness: the harness to take the measurements with.
+*/
+void vkstats_experiment_concurrent_queue_transfer(vkstats_device* device, vkstats_harness* harness);
+
+/*
+* vkstats_experiment_memory_type_matrix()
+*
+* Measures copy bandwidth between every pair of memory types that transfer
+* buffers support, in both directions, and prints a matrix per size.
+*
+* device: the device to run on.
+* queue_index: the index of the queue in the device to run on.
+* harness: the harness to take the measurements with.
+*/
+void vkstats_experiment_memory_type_matrix(vkstats_device* device, uint32_t queue_index, vkstats_harness* harness);
+
+/*
+* vkstats_experiment_staging_write()
+*
+* Measures how fast the CPU can fill each host-visible memory type through a
+* mapping, with memcpy, non-temporal SIMD stores and multiple threads, and
+* the end-to-end time to fill a staging buffer and copy it to device-local
+* memory.
+*
+* device: the device to run on.
+* queue_index: the index of the queue in the device to run the uploads on.
+* harness: the harness to take the measurements with.
+*/
+void vkstats_experiment_staging_write(vkstats_device* device, uint32_t queue_index, vkstats_harness* harness);
+
+/*
+* vkstats_experiment_compute_bandwidth()
+*
+* Measures device-local memory bandwidth with compute shaders that read,
+* write, copy and read-modify-write storage buffers 16 bytes per invocation,
+* next to vkCmdCopyBuffer between the same buffers, for a range of buffer and
+* workgroup sizes.
+*
+* device: the device to run on.
+* queue_index: the index of the queue in the device to run on. Queues without
+*              compute support are skipped.
+* workgroup_size: the workgroup size to run, or 0 to sweep the sizes the
+*                 device supports.
+* harness: the harness to take the measurements with.
+*/
+void vkstats_experiment_compute_bandwidth(vkstats_device* device, uint32_t queue_index, uint32_t workgroup_size, vkstats_harness* harness);
+
+/*
+* vkstats_experiment_image_upload()
+*
+* Measures vkCmdCopyBufferToImage and vkCmdCopyImageToBuffer between a
+* host-visible staging buffer and optimal tiled images with full mip chains,
+* for RGBA8, BC7, R16F and RGBA32F at several sizes. Formats the device
+* can't copy are skipped.
+*
+* device: the device to run on.
+* queue_index: the index of the queue in the device to run on.
+* harness: the harness to take the measurements with.
+*/
+void vkstats_experiment_image_upload(vkstats_device* device, uint32_t queue_index, vkstats_harness* harness);
+
+/*
+* vkstats_experiment_multi_device_transfer()
+*
+* Measures whether several devices add bandwidth when uploading at the same
+* time, which they may not if they share a PCIe root complex. One host thread
+* per device submits a copy from host-visible to device-local memory, and all
+* devices are released together. Runs with 1..N devices active and reports
+* per-device and aggregate bandwidth.
+*
+* devices: the devices to run on.
+* device_count: the number of devices.
+* queue_index: the index of the queue in each device to run on.
+* harness: the harness to take the measurements with.
+*/
+void vkstats_experiment_multi_device_transfer(vkstats_device** devices, uint32_t device_count, uint32_t queue_index, vkstats_harness* harness);
+
+/*
+* vkstats_experiment_allocation_latency()
+*
+* Measures the latency of vkCreateBuffer, vkGetBufferMemoryRequirements,
+* vkAllocateMemory, vkBindBufferMemory, vkDestroyBuffer and vkFreeMemory for
+* every memory type buffers can use, at sizes from 4 KB up to the largest
+* allocation the device allows. Then allocates from several threads at once
+* to show whether the driver serializes allocations.
+*
+* device: the device to run on.
+* queue_index: the index of the queue the buffers are created for.
+* harness: the harness to take the measurements with.
+*/
+void vkstats_experiment_allocation_latency(vkstats_device* device, uint32_t queue_index, vkstats_harness* harness);
+
+/*
+* vkstats_experiment_submission_latency()
+*
+* Measures submission and synchronization latency: the host cost of empty
+* vkQueueSubmit and vkQueueSubmit2 calls and of batches of 1..1024
+* VkSubmitInfos, the time from a host signal until the queue starts, the
+* time to wake a thread blocked on a timeline semaphore or a fence, and the
+* time for a semaphore to hop between two queues. Each prints a histogram.
+*
+* device: the device to run on.
+* queue_index: the index of the queue in the device to run on.
+* other_queue_index: the queue to ping-pong with. Skipped if it aliases
+*                    queue_index.
+* harness: the harness to take the measurements with.
+*/
+void vkstats_experiment_submission_latency(vkstats_device* device, uint32_t queue_index, uint32_t other_queue_index, vkstats_harness* harness);
+
+/*
+* vkstats_experiment_small_upload()
+*
+* Compares ways to upload 4 B to 64 KiB: vkCmdUpdateBuffer, vkCmdFillBuffer,
+* direct writes into host-visible device-local memory, and a staged
+* vkCmdCopyBuffer. Measures the latency of one upload and the throughput of
+* a batch of them, and prints which path wins at each size.
+*
+* device: the device to run on.
+* queue_index: the index of the queue in the device to run on.
+* harness: the harness to take the measurements with.
+*/
+void vkstats_experiment_small_upload(vkstats_device* device, uint32_t queue_index, vkstats_harness* harness);
+
+/*
+* vkstats_experiment_copy_regions()
+*
+* Copies a fixed total from host-visible to device-local memory split into
+* 1 to 1024 regions, with source and destination offsets at alignments of
+* 1, 4, 16 and 256 bytes and optimalBufferCopyOffsetAlignment. Records the
+* regions either into one command buffer or one command buffer per region,
+* and prints a bandwidth heat map for each.
+*
+* device: the device to run on.
+* queue_index: the index of the queue in the device to run on.
+* harness: the harness to take the measurements with.
+*/
+void vkstats_experiment_copy_regions(vkstats_device* device, uint32_t queue_index, vkstats_harness* harness);
+
+/*
+* vkstats_experiment_file_upload()
+*
+* Measures file-to-device-local bandwidth for a file on disk three ways:
+* read() into a bounce buffer and memcpy into staging memory, unbuffered
+* reads straight into staging memory, and mapping the file and importing the
+* pages with VK_EXT_external_memory_host. Staged paths stream the file in
+* chunks through a small ring of staging slots. Each path runs with the file
+* cached, and evicted from the cache if the platform allows it.
+*
+* device: the device to run on.
+* device_index: the index of the physical device, to name the file by.
+* queue_index: the index of the queue in the device to run on.
+* harness: the harness to take the measurements with.
+*/
+void vkstats_experiment_file_upload(vkstats_device* device, uint32_t device_index, uint32_t queue_index, vkstats_harness* harness);
+
+/*
+* vkstats_experiment_command_recording()
+*
+* Measures how command recording scales across host threads, each with its
+* own command pools. A fixed number of copies, barriers and dispatches is
+* split across 1 to N threads and recorded into primary buffers, into
+* secondary buffers run with vkCmdExecuteCommands, or into primaries after
+* vkResetCommandPool, and compared with resubmitting pre-recorded buffers.
+* Prints commands/s and scaling efficiency for each thread count.
+*
+* device: the device to run on.
+* queue_index: the index of the queue in the device to run on. Must support
+*              compute.
+* harness: the harness to take the measurements with.
+*/
+void vkstats_experiment_command_recording(vkstats_device* device, uint32_t queue_index, vkstats_harness* harness);
+
+/*
+* vkstats_experiment_pipeline_cache()
+*
+* Times building a corpus of compute pipelines, every kernel at every
+* workgroup size, without a VkPipelineCache, with a filled in-memory cache,
+* and in a fresh copy of vkstats with and without the cache loaded from disk.
+* Then splits the corpus across threads, with and without the cache.
+*
+* device: the device to run on.
+* harness: the harness to take the measurements with.
+*/
+void vkstats_experiment_pipeline_cache(vkstats_device* device, vkstats_harness* harness);
+
+/*
+* vkstats_experiment_pipeline_cache_child()
+*
+* The fresh process side of vkstats_experiment_pipeline_cache(). Loads the
+* cache file, builds the corpus and writes the time it took to a file.
+*
+* device: the device to run on.
+* cache_path: the cache file to load, or "-" to build without a cache.
+* result_path: the file to write the time to, in milliseconds.
+*/
+void vkstats_experiment_pipeline_cache_child(vkstats_device* device, const char* cache_path, const char* result_path);
+
+/*
+* vkstats_experiment_startup()
+*
+* Profiles bringing vkstats up: layer enumeration, instance creation,
+* physical device enumeration and queries, device creation, command pool
+* creation and teardown. Cold cycles each run in a fresh process; warm cycles
+* repeat in this one. Prints the median and p95 of every phase.
+*
+* device_index: the index of the physical device to run on.
+* cycle_count: the number of cold and of warm cycles.
+* harness: the harness to take the measurements with.
+*/
+void vkstats_experiment_startup(uint32_t device_index, uint32_t cycle_count, vkstats_harness* harness);
+
+/*
+* vkstats_experiment_startup_child()
+*
+* Runs one startup cycle for the startup experiment, in the fresh process it
+* starts, and writes the phase times to a file.
+*
+* device_index: the index of the physical device to run on.
+* result_path: where to write the phase times.
+*/
+void vkstats_experiment_startup_child(uint32_t device_index, const char* result_path);
+
+/*
+* vkstats_experiment_async_overlap()
+*
+* Measures whether compute and transfer work on two queues overlap. Runs
+* streaming copy dispatches on one queue and uploads from host-visible memory
+* on the other, each alone and then both released at once. Prints the overlap
+* efficiency and how much each side slows down with the other running.
+*
+* device: the device to run on.
+* compute_queue_index: the index of the queue to dispatch on.
+* transfer_queue_index: the index of the queue to copy on.
+* harness: the harness to take the measurements with.
+*/
+void vkstats_experiment_async_overlap(vkstats_device* device, uint32_t compute_queue_index, uint32_t transfer_queue_index, vkstats_harness* harness);
+
+/*
+* vkstats_experiment_validation_overhead()
+*
+* Measures what the validation layer costs per API call. Creates an instance
+* and device without layers, and another with the validation layer if it is
+* available, and times empty submits, memory allocation, buffer creation and
+* copy recording on both. Prints the time per call and the difference.
+*
+* device_index: the index of the physical device to run on.
+* harness: the harness to take the measurements with.
+*/
+void vkstats_experiment_validation_overhead(uint32_t device_index, vkstats_harness* harness);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,153 @@
+#if !defined(VKSTATS_FILE_H)
+#define VKSTATS_FILE_H
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#include "Windows.h"
+#endif
+
+#include "vulkan/vulkan.h"
+
+/*
+* Unbuffered reads need the buffer, offset and size aligned to this.
+*/
+#define VKSTATS_FILE_ALIGNMENT 4096
+
+/*
+* Room for a scratch file path from vkstats_file_get_temp_path().
+*/
+#define VKSTATS_FILE_MAX_PATH 1024
+
+typedef struct
+{
+#if defined(_WIN32)
+    HANDLE      handle;
+    HANDLE      mapping;
+#else
+    int         descriptor;
+#endif
+    uint64_t    size;
+} vkstats_file;
+
+/*
+* vkstats_file_get_temp_path()
+*
+* Builds the path of a scratch file in the temporary directory: $TMPDIR, or
+* /tmp if it isn't set, and GetTempPath() on Windows.
+*
+* path: the path will be placed here, VKSTATS_FILE_MAX_PATH bytes.
+* name: the name of the file.
+*/
+void vkstats_file_get_temp_path(char* path, const char* name);
+
+/*
+* vkstats_file_write_pattern()
+*
+* Creates a file filled with a byte pattern and flushes it to disk.
+* Overwrites the file if it already exists.
+*
+* path: the path of the file.
+* size: the size of the file in bytes.
+*
+* Returns VK_FALSE if the file couldn't be written, for example because the
+* disk is full. Nothing is left behind in that case.
+*/
+VkBool32 vkstats_file_write_pattern(const char* path, uint64_t size);
+
+/*
+* vkstats_file_open()
+*
+* Opens a file for reading.
+*
+* file: the opened file will be placed here.
+* path: the path of the file.
+* direct: whether reads bypass the operating system's cache.
+*
+* Returns VK_FALSE if the file couldn't be opened, for example because the
+* file system doesn't support unbuffered reads.
+*/
+VkBool32 vkstats_file_open(vkstats_file* file, const char* path, VkBool32 direct);
+
+/*
+* vkstats_file_try_read()
+*
+* Reads part of a file.
+*
+* file: the file to read.
+* offset: where in the file to start reading.
+* buffer: the data will be placed here.
+* size: the number of bytes to read.
+*
+* Returns VK_FALSE if the whole range couldn't be read, for example because
+* the buffer is memory unbuffered reads can't go to.
+*/
+VkBool32 vkstats_file_try_read(vkstats_file* file, uint64_t offset, void* buffer, uint64_t size);
+
+/*
+* vkstats_file_read()
+*
+* Reads part of a file. Aborts the application if the whole range can't be
+* read.
+*
+* file: the file to read.
+* offset: where in the file to start reading.
+* buffer: the data will be placed here.
+* size: the number of bytes to read.
+*/
+void vkstats_file_read(vkstats_file* file, uint64_t offset, void* buffer, uint64_t size);
+
+/*
+* vkstats_file_map()
+*
+* Maps the whole file into memory, copy-on-write, so the pages are writable
+* without changing the file.
+*
+* file: the file to map.
+* alignment: the alignment the mapping must start at.
+*
+* Returns a pointer to the mapping.
+*/
+void* vkstats_file_map(vkstats_file* file, uint64_t alignment);
+
+/*
+* vkstats_file_unmap()
+*
+* Unmaps a mapping from vkstats_file_map().
+*
+* file: the file that was mapped.
+* pointer: the mapping.
+*/
+void vkstats_file_unmap(vkstats_file* file, void* pointer);
+
+/*
+* vkstats_file_evict()
+*
+* Drops the file's pages from the operating system's cache, so the next read
+* comes from the disk.
+*
+* file: the file to evict.
+*
+* Returns VK_FALSE if the platform can't do this.
+*/
+VkBool32 vkstats_file_evict(vkstats_file* file);
+
+/*
+* vkstats_file_close()
+*
+* Closes a file.
+*
+* file: the file to close.
+*/
+void vkstats_file_close(vkstats_file* file);
+
+/*
+* vkstats_file_delete()
+*
+* Deletes a file.
+*
+* path: the path of the file.
+*/
+void vkstats_file_delete(const char* path);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,205 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "file.h"
+#include "util.h"
+
+#define WRITE_CHUNK_SIZE (1024 * 1024)
+
+void vkstats_file_get_temp_path(char* path, const char* name)
+{
+    const char* directory = getenv("TMPDIR");
+
+    if (directory == NULL || directory[0] == '\0' || snprintf(path, VKSTATS_FILE_MAX_PATH, "%s/%s", directory, name) >= VKSTATS_FILE_MAX_PATH)
+    {
+        snprintf(path, VKSTATS_FILE_MAX_PATH, "/tmp/%s", name);
+    }
+}
+
+VkBool32 vkstats_file_write_pattern(const char* path, uint64_t size)
+{
+    int descriptor = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    VkBool32 written_all = VK_TRUE;
+    uint8_t* chunk;
+
+    if (descriptor < 0)
+    {
+        return VK_FALSE;
+    }
+
+    chunk = malloc(WRITE_CHUNK_SIZE);
+
+    if (chunk == NULL)
+    {
+        fatal_error("Could not allocate file chunk!");
+    }
+
+    for (uint32_t i = 0; i < WRITE_CHUNK_SIZE; i++)
+    {
+        chunk[i] = (uint8_t)(i * 31);
+    }
+
+    for (uint64_t written = 0; written < size && written_all;)
+    {
+        size_t count = size - written < WRITE_CHUNK_SIZE ? (size_t)(size - written) : WRITE_CHUNK_SIZE;
+        ssize_t result = write(descriptor, chunk, count);
+
+        if (result <= 0)
+        {
+            written_all = VK_FALSE;
+        }
+        else
+        {
+            written += (uint64_t)result;
+        }
+    }
+
+    if (written_all && fsync(descriptor) != 0)
+    {
+        written_all = VK_FALSE;
+    }
+
+    free(chunk);
+    close(descriptor);
+
+    if (!written_all)
+    {
+        unlink(path);
+    }
+
+    return written_all;
+}
+
+VkBool32 vkstats_file_open(vkstats_file* file, const char* path, VkBool32 direct)
+{
+    int flags = O_RDONLY;
+
+    if (direct)
+    {
+#if defined(O_DIRECT)
+        flags |= O_DIRECT;
+#elif !defined(F_NOCACHE)
+        return VK_FALSE;
+#endif
+    }
+
+    file->descriptor = open(path, flags);
+
+    if (file->descriptor < 0)
+    {
+        return VK_FALSE;
+    }
+
+#if !defined(O_DIRECT) && defined(F_NOCACHE)
+    if (direct && fcntl(file->descriptor, F_NOCACHE, 1) != 0)
+    {
+        close(file->descriptor);
+        return VK_FALSE;
+    }
+#endif
+
+    off_t size = lseek(file->descriptor, 0, SEEK_END);
+
+    if (size < 0)
+    {
+        fatal_error("Could not get file size!");
+    }
+
+    file->size = (uint64_t)size;
+
+    return VK_TRUE;
+}
+
+VkBool32 vkstats_file_try_read(vkstats_file* file, uint64_t offset, void* buffer, uint64_t size)
+{
+    uint8_t* destination = buffer;
+
+    while (size > 0)
+    {
+        ssize_t result = pread(file->descriptor, destination, (size_t)size, (off_t)offset);
+
+        if (result <= 0)
+        {
+            return VK_FALSE;
+        }
+
+        destination += result;
+        offset += (uint64_t)result;
+        size -= (uint64_t)result;
+    }
+
+    return VK_TRUE;
+}
+
+void vkstats_file_read(vkstats_file* file, uint64_t offset, void* buffer, uint64_t size)
+{
+    if (!vkstats_file_try_read(file, offset, buffer, size))
+    {
+        fatal_error("Could not read file!");
+    }
+}
+
+void* vkstats_file_map(vkstats_file* file, uint64_t alignment)
+{
+    /*
+    * mmap only promises page alignment, so a larger range is reserved and
+    * the file is mapped over an aligned address inside it. The slack on
+    * either side is released again.
+    */
+    size_t reserve_size = (size_t)(file->size + alignment);
+    uint8_t* reserved = mmap(NULL, reserve_size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (reserved == MAP_FAILED)
+    {
+        fatal_error("Could not reserve address space!");
+    }
+
+    uint8_t* aligned = (uint8_t*)(uintptr_t)align_up((uintptr_t)reserved, alignment);
+    uint8_t* end = aligned + file->size;
+
+    if (mmap(aligned, (size_t)file->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, file->descriptor, 0) == MAP_FAILED)
+    {
+        fatal_error("Could not map file!");
+    }
+
+    if (aligned > reserved)
+    {
+        munmap(reserved, (size_t)(aligned - reserved));
+    }
+
+    if (end < reserved + reserve_size)
+    {
+        munmap(end, (size_t)(reserved + reserve_size - end));
+    }
+
+    return aligned;
+}
+
+void vkstats_file_unmap(vkstats_file* file, void* pointer)
+{
+    munmap(pointer, (size_t)file->size);
+}
+
+VkBool32 vkstats_file_evict(vkstats_file* file)
+{
+#if defined(POSIX_FADV_DONTNEED)
+    return posix_fadvise(file->descriptor, 0, 0, POSIX_FADV_DONTNEED) == 0;
+#else
+    (void)file;
+    return VK_FALSE;
+#endif
+}
+
+void vkstats_file_close(vkstats_file* file)
+{
+    close(file->descriptor);
+}
+
+void vkstats_file_delete(const char* path)
+{
+    unlink(path);
+}
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Windows.h"
+
+#include "file.h"
+#include "util.h"
+
+#define WRITE_CHUNK_SIZE (1024 * 1024)
+#define MAX_READ_SIZE (1024 * 1024 * 1024)
+
+void vkstats_file_get_temp_path(char* path, const char* name)
+{
+    DWORD length = GetTempPathA(VKSTATS_FILE_MAX_PATH, path);
+
+    if (length == 0 || length >= VKSTATS_FILE_MAX_PATH || snprintf(path + length, VKSTATS_FILE_MAX_PATH - length, "%s", name) >= (int)(VKSTATS_FILE_MAX_PATH - length))
+    {
+        snprintf(path, VKSTATS_FILE_MAX_PATH, "%s", name);
+    }
+}
+
+VkBool32 vkstats_file_write_pattern(const char* path, uint64_t size)
+{
+    HANDLE handle = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    VkBool32 written_all = VK_TRUE;
+    uint8_t* chunk;
+
+    if (handle == INVALID_HANDLE_VALUE)
+    {
+        return VK_FALSE;
+    }
+
+    chunk = malloc(WRITE_CHUNK_SIZE);
+
+    if (chunk == NULL)
+    {
+        fatal_error("Could not allocate file chunk!");
+    }
+
+    for (uint32_t i = 0; i < WRITE_CHUNK_SIZE; i++)
+    {
+        chunk[i] = (uint8_t)(i * 31);
+    }
+
+    for (uint64_t written = 0; written < size && written_all;)
+    {
+        DWORD count = size - written < WRITE_CHUNK_SIZE ? (DWORD)(size - written) : WRITE_CHUNK_SIZE;
+        DWORD result = 0;
+
+        if (!WriteFile(handle, chunk, count, &result, NULL) || result == 0)
+        {
+            written_all = VK_FALSE;
+        }
+        else
+        {
+            written += result;
+        }
+    }
+
+    if (written_all && !FlushFileBuffers(handle))
+    {
+        written_all = VK_FALSE;
+    }
+
+    free(chunk);
+    CloseHandle(handle);
+
+    if (!written_all)
+    {
+        DeleteFileA(path);
+    }
+
+    return written_all;
+}
+
+VkBool32 vkstats_file_open(vkstats_file* file, const char* path, VkBool32 direct)
+{
+    DWORD flags = direct ? FILE_FLAG_NO_BUFFERING : FILE_ATTRIBUTE_NORMAL;
+    LARGE_INTEGER size;
+
+    file->handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, flags, NULL);
+    file->mapping = NULL;
+
+    if (file->handle == INVALID_HANDLE_VALUE)
+    {
+        return VK_FALSE;
+    }
+
+    if (!GetFileSizeEx(file->handle, &size))
+    {
+        fatal_error("Could not get file size!");
+    }
+
+    file->size = (uint64_t)size.QuadPart;
+
+    return VK_TRUE;
+}
+
+VkBool32 vkstats_file_try_read(vkstats_file* file, uint64_t offset, void* buffer, uint64_t size)
+{
+    uint8_t* destination = buffer;
+
+    while (size > 0)
+    {
+        OVERLAPPED overlapped = { 0 };
+        DWORD count = size < MAX_READ_SIZE ? (DWORD)size : MAX_READ_SIZE;
+        DWORD result = 0;
+
+        overlapped.Offset = (DWORD)offset;
+        overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+        if (!ReadFile(file->handle, destination, count, &result, &overlapped) || result == 0)
+        {
+            return VK_FALSE;
+        }
+
+        destination += result;
+        offset += result;
+        size -= result;
+    }
+
+    return VK_TRUE;
+}
+
+void vkstats_file_read(vkstats_file* file, uint64_t offset, void* buffer, uint64_t size)
+{
+    if (!vkstats_file_try_read(file, offset, buffer, size))
+    {
+        fatal_error("Could not read file!");
+    }
+}
+
+void* vkstats_file_map(vkstats_file* file, uint64_t alignment)
+{
+    void* pointer;
+
+    /*
+    * Views start on the allocation granularity, 64 KiB, which covers any
+    * alignment a driver is likely to ask for.
+    */
+    file->mapping = CreateFileMappingA(file->handle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+
+    if (file->mapping == NULL)
+    {
+        fatal_error("Could not create file mapping!");
+    }
+
+    pointer = MapViewOfFile(file->mapping, FILE_MAP_COPY, 0, 0, 0);
+
+    if (pointer == NULL)
+    {
+        fatal_error("Could not map file!");
+    }
+
+    if ((uintptr_t)pointer % alignment != 0)
+    {
+        fatal_error("File mapping is not aligned!");
+    }
+
+    return pointer;
+}
+
+void vkstats_file_unmap(vkstats_file* file, void* pointer)
+{
+    UnmapViewOfFile(pointer);
+    CloseHandle(file->mapping);
+    file->mapping = NULL;
+}
+
+VkBool32 vkstats_file_evict(vkstats_file* file)
+{
+    /*
+    * Windows has no unprivileged way to drop one file from the cache.
+    */
+    (void)file;
+    return VK_FALSE;
+}
+
+void vkstats_file_close(vkstats_file* file)
+{
+    CloseHandle(file->handle);
+}
+
+void vkstats_file_delete(const char* path)
+{
+    DeleteFileA(path);
+}
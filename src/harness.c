@@ -0,0 +1,408 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include "Windows.h"
+#else
+#include <sched.h>
+#endif
+
+#include "device.h"
+#include "harness.h"
+#include "results.h"
+#include "stopwatch.h"
+#include "trace.h"
+#include "util.h"
+
+/*
+* Modified z-score above which a sample counts as an outlier.
+*/
+#define OUTLIER_THRESHOLD 3.5
+
+/*
+* Histogram buckets, covering up to 2^31 us, and the longest bar printed.
+*/
+#define HISTOGRAM_BUCKETS 32
+#define HISTOGRAM_WIDTH 40
+
+/*
+* The highest CPU an affinity mask can hold.
+*/
+#if defined(_WIN32)
+#define MAX_AFFINITY_CPU ((int32_t)sizeof(DWORD_PTR) * 8 - 1)
+#else
+#define MAX_AFFINITY_CPU (CPU_SETSIZE - 1)
+#endif
+
+static int compare_doubles(const void* a, const void* b);
+static double get_percentile(const double* sorted, uint32_t count, double percentile);
+
+void vkstats_harness_init(vkstats_harness* harness, uint32_t warmup_count, uint32_t trial_count, int32_t cpu)
+{
+    if (trial_count == 0 || trial_count > MAX_TRIALS)
+    {
+        fatal_error("Trial count must be between 1 and MAX_TRIALS!");
+    }
+
+    if (cpu != VKSTATS_NO_AFFINITY && (cpu < 0 || cpu > MAX_AFFINITY_CPU))
+    {
+        fatal_error("CPU index is out of range for an affinity mask!");
+    }
+
+    clear_struct(harness);
+    harness->warmup_count = warmup_count;
+    harness->trial_count = trial_count;
+    harness->cpu = cpu;
+    harness->queue_index = VKSTATS_NO_QUEUE;
+    harness->source_memory_type = VKSTATS_NO_MEMORY_TYPE;
+    harness->destination_memory_type = VKSTATS_NO_MEMORY_TYPE;
+}
+
+void vkstats_harness_run(vkstats_harness* harness, vkstats_trial_function trial, void* context, uint32_t metric_count, vkstats_statistics* statistics)
+{
+    double results[MAX_METRICS];
+
+    if (metric_count > MAX_METRICS)
+    {
+        fatal_error("Maximum metrics is too small!");
+    }
+
+    /*
+    * Pin the thread for the duration of the run so the measurements aren't
+    * affected by migrating between cores, and restore it afterwards.
+    */
+#if defined(_WIN32)
+    DWORD_PTR previous_mask = 0;
+
+    if (harness->cpu != VKSTATS_NO_AFFINITY)
+    {
+        previous_mask = SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << harness->cpu);
+
+        if (previous_mask == 0)
+        {
+            fatal_error("Could not pin the thread to the CPU!");
+        }
+    }
+#else
+    cpu_set_t previous_set;
+
+    if (harness->cpu != VKSTATS_NO_AFFINITY)
+    {
+        cpu_set_t set;
+
+        CPU_ZERO(&set);
+        CPU_SET(harness->cpu, &set);
+
+        if (sched_getaffinity(0, sizeof(previous_set), &previous_set) != 0 || sched_setaffinity(0, sizeof(set), &set) != 0)
+        {
+            fatal_error("Could not pin the thread to the CPU!");
+        }
+    }
+#endif
+
+    /*
+    * Every trial is a span on the trace, named after the experiment, so the
+    * calls made inside it can be told apart.
+    */
+    const char* trace_name = harness->experiment != NULL ? harness->experiment : "trial";
+
+    for (uint32_t i = 0; i < harness->warmup_count; i++)
+    {
+        uint64_t start_ticks = vkstats_stopwatch_get_ticks();
+        trial(context, results);
+        vkstats_trace_host_event("warmup", trace_name, start_ticks, vkstats_stopwatch_get_ticks(), i);
+    }
+
+    for (uint32_t i = 0; i < harness->trial_count; i++)
+    {
+        uint64_t start_ticks = vkstats_stopwatch_get_ticks();
+        trial(context, results);
+        vkstats_trace_host_event("trial", trace_name, start_ticks, vkstats_stopwatch_get_ticks(), i);
+
+        for (uint32_t j = 0; j < metric_count; j++)
+        {
+            harness->samples[j][i] = results[j];
+        }
+    }
+
+#if defined(_WIN32)
+    if (previous_mask != 0)
+    {
+        SetThreadAffinityMask(GetCurrentThread(), previous_mask);
+    }
+#else
+    if (harness->cpu != VKSTATS_NO_AFFINITY)
+    {
+        sched_setaffinity(0, sizeof(previous_set), &previous_set);
+    }
+#endif
+
+    for (uint32_t i = 0; i < metric_count; i++)
+    {
+        vkstats_statistics_compute(harness->samples[i], harness->trial_count, &statistics[i]);
+    }
+}
+
+void vkstats_harness_set_results(vkstats_harness* harness, vkstats_results* results)
+{
+    harness->results = results;
+}
+
+void vkstats_harness_begin_experiment(vkstats_harness* harness, const char* experiment, vkstats_device* device, uint32_t queue_index)
+{
+    harness->experiment = experiment;
+    harness->device = device;
+    harness->queue_index = queue_index;
+    harness->source_memory_type = VKSTATS_NO_MEMORY_TYPE;
+    harness->destination_memory_type = VKSTATS_NO_MEMORY_TYPE;
+}
+
+void vkstats_harness_set_memory_types(vkstats_harness* harness, uint32_t source_memory_type, uint32_t destination_memory_type)
+{
+    harness->source_memory_type = source_memory_type;
+    harness->destination_memory_type = destination_memory_type;
+}
+
+void vkstats_harness_report(vkstats_harness* harness, const char* label, const vkstats_statistics* statistics)
+{
+    char prefixed_label[256];
+
+    snprintf(prefixed_label, sizeof(prefixed_label), "%s%s", harness->prefix != NULL ? harness->prefix : "", label);
+    vkstats_statistics_print(prefixed_label, statistics);
+    vkstats_harness_record(harness, label, statistics, 0);
+}
+
+void vkstats_harness_report_bandwidth(vkstats_harness* harness, const char* label, const vkstats_statistics* statistics, uint64_t bytes)
+{
+    char prefixed_label[256];
+
+    snprintf(prefixed_label, sizeof(prefixed_label), "%s%s", harness->prefix != NULL ? harness->prefix : "", label);
+    vkstats_statistics_print_bandwidth(prefixed_label, statistics, bytes);
+    vkstats_harness_record(harness, label, statistics, bytes);
+}
+
+void vkstats_harness_record(vkstats_harness* harness, const char* label, const vkstats_statistics* statistics, uint64_t bytes)
+{
+    vkstats_result result;
+
+    if (harness->results == NULL)
+    {
+        return;
+    }
+
+    clear_struct(&result);
+    snprintf(result.experiment, sizeof(result.experiment), "%s", harness->experiment != NULL ? harness->experiment : "");
+    snprintf(result.label, sizeof(result.label), "%s", label);
+
+    /*
+    * Labels are often indented under a heading when printed, which doesn't
+    * belong in the results.
+    */
+    size_t indent = strspn(result.label, " ");
+    memmove(result.label, result.label + indent, strlen(result.label + indent) + 1);
+
+    result.queue_index = harness->queue_index;
+    result.queue_family = VKSTATS_NO_QUEUE;
+    result.source_memory_type = harness->source_memory_type;
+    result.destination_memory_type = harness->destination_memory_type;
+    result.bytes = bytes;
+    result.statistics = *statistics;
+
+    if (harness->device != NULL)
+    {
+        const VkPhysicalDeviceProperties* properties = &harness->device->physical_device->properties;
+
+        snprintf(result.device_name, sizeof(result.device_name), "%s", properties->deviceName);
+        result.vendor_id = properties->vendorID;
+        result.device_id = properties->deviceID;
+        result.driver_version = properties->driverVersion;
+
+        if (harness->queue_index != VKSTATS_NO_QUEUE)
+        {
+            result.queue_family = harness->device->queue_family_indices[harness->queue_index];
+        }
+    }
+
+    vkstats_results_add(harness->results, &result);
+}
+
+void vkstats_harness_print_histogram(const vkstats_harness* harness, uint32_t metric_index)
+{
+    uint32_t buckets[HISTOGRAM_BUCKETS] = { 0 };
+    uint32_t first = HISTOGRAM_BUCKETS;
+    uint32_t last = 0;
+    uint32_t largest = 0;
+    char bar[HISTOGRAM_WIDTH + 1];
+
+    /*
+    * Bucket 0 holds everything under 1 us, and bucket i holds
+    * [2^(i-1), 2^i) us.
+    */
+    for (uint32_t i = 0; i < harness->trial_count; i++)
+    {
+        double microseconds = harness->samples[metric_index][i] * 1000.0;
+        uint32_t bucket = 0;
+
+        while (bucket + 1 < HISTOGRAM_BUCKETS && microseconds >= ldexp(1.0, (int)bucket))
+        {
+            bucket++;
+        }
+
+        buckets[bucket]++;
+        first = bucket < first ? bucket : first;
+        last = bucket > last ? bucket : last;
+        largest = buckets[bucket] > largest ? buckets[bucket] : largest;
+    }
+
+    for (uint32_t i = first; i <= last && largest > 0; i++)
+    {
+        uint32_t width = (uint32_t)((uint64_t)buckets[i] * HISTOGRAM_WIDTH / largest);
+
+        memset(bar, '#', width);
+        bar[width] = '\0';
+
+        printf("    %10.0f - %-10.0f us %6u %s\n", i == 0 ? 0.0 : ldexp(1.0, (int)i - 1), ldexp(1.0, (int)i), buckets[i], bar);
+    }
+}
+
+void vkstats_statistics_compute(double* samples, uint32_t count, vkstats_statistics* statistics)
+{
+    double deviations[MAX_TRIALS];
+    double median;
+    double mad;
+    uint32_t first;
+    uint32_t last;
+
+    clear_struct(statistics);
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    qsort(samples, count, sizeof(samples[0]), compare_doubles);
+    median = get_percentile(samples, count, 0.5);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        deviations[i] = fabs(samples[i] - median);
+    }
+
+    qsort(deviations, count, sizeof(deviations[0]), compare_doubles);
+    mad = get_percentile(deviations, count, 0.5);
+
+    /*
+    * The samples are sorted, so the retained samples are a contiguous range.
+    * 0.6745 scales the MAD to the standard deviation of a normal
+    * distribution.
+    */
+    first = 0;
+    last = count;
+
+    if (mad > 0.0)
+    {
+        while (first < last && 0.6745 * (median - samples[first]) / mad > OUTLIER_THRESHOLD)
+        {
+            first++;
+        }
+
+        while (last > first && 0.6745 * (samples[last - 1] - median) / mad > OUTLIER_THRESHOLD)
+        {
+            last--;
+        }
+    }
+
+    statistics->count = last - first;
+    statistics->rejected_count = count - statistics->count;
+    statistics->min = samples[first];
+    statistics->max = samples[last - 1];
+    statistics->median = get_percentile(&samples[first], statistics->count, 0.5);
+    statistics->p95 = get_percentile(&samples[first], statistics->count, 0.95);
+    statistics->p99 = get_percentile(&samples[first], statistics->count, 0.99);
+
+    for (uint32_t i = first; i < last; i++)
+    {
+        statistics->mean += samples[i];
+    }
+
+    statistics->mean /= statistics->count;
+
+    for (uint32_t i = first; i < last; i++)
+    {
+        statistics->stddev += (samples[i] - statistics->mean) * (samples[i] - statistics->mean);
+    }
+
+    statistics->stddev = statistics->count > 1 ? sqrt(statistics->stddev / (statistics->count - 1)) : 0.0;
+}
+
+void vkstats_statistics_print(const char* label, const vkstats_statistics* statistics)
+{
+    printf("%s: min %.3f, median %.3f, p95 %.3f, p99 %.3f, stddev %.3f ms (%u samples, %u rejected)\n",
+        label,
+        statistics->min,
+        statistics->median,
+        statistics->p95,
+        statistics->p99,
+        statistics->stddev,
+        statistics->count,
+        statistics->rejected_count);
+}
+
+void vkstats_statistics_print_bandwidth(const char* label, const vkstats_statistics* statistics, uint64_t bytes)
+{
+    printf("%s: median %.2f GB/s, peak %.2f GB/s, p95 %.2f GB/s (%u samples, %u rejected)\n",
+        label,
+        vkstats_get_bandwidth(bytes, statistics->median),
+        vkstats_get_bandwidth(bytes, statistics->min),
+        vkstats_get_bandwidth(bytes, statistics->p95),
+        statistics->count,
+        statistics->rejected_count);
+}
+
+double vkstats_get_bandwidth(uint64_t bytes, double milliseconds)
+{
+    return milliseconds > 0.0 ? (double)bytes / (milliseconds * 1000000.0) : 0.0;
+}
+
+/*
+* compare_doubles()
+*
+* qsort() comparison function for doubles.
+*
+* a: the first value.
+* b: the second value.
+*
+* Returns less than, equal to or greater than zero if a is less than, equal to
+* or greater than b.
+*/
+static int compare_doubles(const void* a, const void* b)
+{
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+* get_percentile()
+*
+* Gets a percentile from sorted samples, interpolating between the closest
+* ranks.
+*
+* sorted: the samples, in ascending order.
+* count: the number of samples.
+* percentile: the percentile to get, between 0 and 1.
+*
+* Returns the percentile.
+*/
+static double get_percentile(const double* sorted, uint32_t count, double percentile)
+{
+    double rank = percentile * (count - 1);
+    uint32_t lower = (uint32_t)rank;
+    uint32_t upper = lower + 1 < count ? lower + 1 : lower;
+    double fraction = rank - lower;
+
+    return sorted[lower] + (sorted[upper] - sorted[lower]) * fraction;
+}
@@ -0,0 +1,228 @@
+#if !defined(VKSTATS_HARNESS_H)
+#define VKSTATS_HARNESS_H
+
+#include <stdint.h>
+
+#include "vulkan/vulkan.h"
+
+#include "config.h"
+#include "device.h"
+
+/*
+* Pass as the CPU to leave the timing thread unpinned.
+*/
+#define VKSTATS_NO_AFFINITY -1
+
+/*
+* Pass as the queue or memory type of results that aren't tied to one.
+*/
+#define VKSTATS_NO_QUEUE UINT32_MAX
+#define VKSTATS_NO_MEMORY_TYPE UINT32_MAX
+
+struct vkstats_results;
+
+typedef struct
+{
+    uint32_t    count;
+    uint32_t    rejected_count;
+    double      min;
+    double      max;
+    double      mean;
+    double      median;
+    double      p95;
+    double      p99;
+    double      stddev;
+} vkstats_statistics;
+
+/*
+* vkstats_trial_function
+*
+* Runs a single trial of an experiment.
+*
+* context: experiment-supplied data.
+* results: one measurement per metric should be written here, in
+*          milliseconds.
+*/
+typedef void (*vkstats_trial_function)(void* context, double* results);
+
+/*
+* Besides taking measurements, the harness reports them. The experiment,
+* queue and memory types describe the results currently being reported, and
+* the prefix, if not NULL, is printed before every label so output from
+* harnesses on several threads can be told apart.
+*/
+typedef struct
+{
+    uint32_t                    warmup_count;
+    uint32_t                    trial_count;
+    int32_t                     cpu;
+    double                      samples[MAX_METRICS][MAX_TRIALS];
+    struct vkstats_results*     results;
+    const char*                 experiment;
+    vkstats_device*             device;
+    uint32_t                    queue_index;
+    uint32_t                    source_memory_type;
+    uint32_t                    destination_memory_type;
+    const char*                 prefix;
+} vkstats_harness;
+
+/*
+* vkstats_harness_init()
+*
+* Initialize a measurement harness.
+*
+* harness: the harness to initialize.
+* warmup_count: the number of untimed runs before measuring.
+* trial_count: the number of timed runs.
+* cpu: the CPU to pin the timing thread to, or VKSTATS_NO_AFFINITY. Runs
+*      abort the application if the thread can't be pinned to it.
+*/
+void vkstats_harness_init(vkstats_harness* harness, uint32_t warmup_count, uint32_t trial_count, int32_t cpu);
+
+/*
+* vkstats_harness_run()
+*
+* Runs the warm-up trials, then the timed trials, and computes statistics
+* for each metric the trial reports.
+*
+* harness: the harness to run.
+* trial: the trial function.
+* context: passed to the trial function.
+* metric_count: the number of metrics the trial function reports.
+* statistics: an array of metric_count statistics to fill.
+*/
+void vkstats_harness_run(vkstats_harness* harness, vkstats_trial_function trial, void* context, uint32_t metric_count, vkstats_statistics* statistics);
+
+/*
+* vkstats_harness_set_results()
+*
+* Sets where the harness reports results, in addition to printing them.
+*
+* harness: the harness to set the results of.
+* results: the results sink, or NULL to only print.
+*/
+void vkstats_harness_set_results(vkstats_harness* harness, struct vkstats_results* results);
+
+/*
+* vkstats_harness_begin_experiment()
+*
+* Sets what the following results are measuring, and resets the memory types
+* to VKSTATS_NO_MEMORY_TYPE.
+*
+* harness: the harness to report with.
+* experiment: the experiment name. Must outlive the experiment.
+* device: the device the experiment runs on.
+* queue_index: the index of the queue in the device the experiment runs on,
+*              or VKSTATS_NO_QUEUE.
+*/
+void vkstats_harness_begin_experiment(vkstats_harness* harness, const char* experiment, vkstats_device* device, uint32_t queue_index);
+
+/*
+* vkstats_harness_set_memory_types()
+*
+* Sets the memory types the following results read from and write to.
+*
+* harness: the harness to report with.
+* source_memory_type: the memory type read from, or VKSTATS_NO_MEMORY_TYPE.
+* destination_memory_type: the memory type written to, or
+*                          VKSTATS_NO_MEMORY_TYPE.
+*/
+void vkstats_harness_set_memory_types(vkstats_harness* harness, uint32_t source_memory_type, uint32_t destination_memory_type);
+
+/*
+* vkstats_harness_report()
+*
+* Prints time statistics and adds them to the results.
+*
+* harness: the harness to report with.
+* label: describes what was measured. Must be unique within the experiment.
+* statistics: time statistics, in milliseconds.
+*/
+void vkstats_harness_report(vkstats_harness* harness, const char* label, const vkstats_statistics* statistics);
+
+/*
+* vkstats_harness_report_bandwidth()
+*
+* Prints the bandwidth derived from time statistics and adds them to the
+* results.
+*
+* harness: the harness to report with.
+* label: describes what was measured. Must be unique within the experiment.
+* statistics: time statistics, in milliseconds.
+* bytes: the number of bytes moved in each trial.
+*/
+void vkstats_harness_report_bandwidth(vkstats_harness* harness, const char* label, const vkstats_statistics* statistics, uint64_t bytes);
+
+/*
+* vkstats_harness_record()
+*
+* Adds time statistics to the results without printing them, for
+* experiments that print their own summary.
+*
+* harness: the harness to report with.
+* label: describes what was measured. Must be unique within the experiment.
+* statistics: time statistics, in milliseconds.
+* bytes: the number of bytes moved in each trial, or 0 for a latency.
+*/
+void vkstats_harness_record(vkstats_harness* harness, const char* label, const vkstats_statistics* statistics, uint64_t bytes);
+
+/*
+* vkstats_harness_print_histogram()
+*
+* Prints a latency histogram of one metric from the last run, with
+* power-of-two microsecond buckets. Every sample is counted, outliers
+* included, since the tail is what the histogram is for.
+*
+* harness: the harness that took the samples.
+* metric_index: the metric to print.
+*/
+void vkstats_harness_print_histogram(const vkstats_harness* harness, uint32_t metric_index);
+
+/*
+* vkstats_statistics_compute()
+*
+* Computes statistics over a set of samples. Outliers are rejected using the
+* modified z-score (median absolute deviation) before the statistics are
+* calculated. The samples are sorted in place.
+*
+* samples: the samples.
+* count: the number of samples.
+* statistics: the statistics will be placed here.
+*/
+void vkstats_statistics_compute(double* samples, uint32_t count, vkstats_statistics* statistics);
+
+/*
+* vkstats_statistics_print()
+*
+* Prints a line of statistics.
+*
+* label: text to print before the statistics.
+* statistics: the statistics to print.
+*/
+void vkstats_statistics_print(const char* label, const vkstats_statistics* statistics);
+
+/*
+* vkstats_statistics_print_bandwidth()
+*
+* Prints a line of bandwidth derived from time statistics. The median time
+* gives the typical bandwidth, the minimum the peak and p95 the worst case.
+*
+* label: text to print before the bandwidth.
+* statistics: time statistics, in milliseconds.
+* bytes: the number of bytes moved in each trial.
+*/
+void vkstats_statistics_print_bandwidth(const char* label, const vkstats_statistics* statistics, uint64_t bytes);
+
+/*
+* vkstats_get_bandwidth()
+*
+* Converts bytes moved in a time to bandwidth.
+*
+* bytes: the number of bytes moved.
+* milliseconds: the time taken.
+*
+* Returns the bandwidth in GB/s.
+*/
+double vkstats_get_bandwidth(uint64_t bytes, double milliseconds);
+
+#endif
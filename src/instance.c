@@ -1,7 +1,11 @@
+#include <stdlib.h>
+
 #include "vulkan/vulkan.h"
 
 #include "config.h"
 #include "util.h"
+#include "stopwatch.h"
+#include "trace.h"
 #include "instance.h"
 
 
@@ -11,7 +15,7 @@ VkDebugUtilsMessengerCreateInfoEXT get_messenger_create_info(void);
 VkBool32 debug_messenger(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebugUtilsMessageTypeFlagsEXT types, const VkDebugUtilsMessengerCallbackDataEXT* callback_data, void* user_data);
 void check_layer(const char* layer_name);
 
-void vkstats_instance_create(vkstats_instance* instance)
+void vkstats_instance_create(vkstats_instance* instance, VkBool32 validation)
 {
     VkResult result;
     VkDebugUtilsMessengerCreateInfoEXT debug_utils;
@@ -19,33 +23,86 @@ void vkstats_instance_create(vkstats_instance* instance)
 
     debug_utils = get_messenger_create_info();
     const char* enabled_extensions[] = { "VK_EXT_debug_utils" };
-    const char* enabled_layers[] = { "VK_LAYER_KHRONOS_validation" };
-
-    check_layer("VK_LAYER_KHRONOS_validation");
+    const char* enabled_layers[] = { VKSTATS_VALIDATION_LAYER };
 
     VkApplicationInfo application_info = { 0 };
     application_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
     application_info.apiVersion = VK_API_VERSION_1_3;
 
     instance_ci.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-    instance_ci.pNext = &debug_utils;
-    instance_ci.enabledLayerCount = array_length(enabled_layers);
-    instance_ci.ppEnabledLayerNames = enabled_layers;
-    instance_ci.ppEnabledExtensionNames = enabled_extensions;
-    instance_ci.enabledExtensionCount = array_length(enabled_extensions);
     instance_ci.pApplicationInfo = &application_info;
+
+    double frequency = vkstats_stopwatch_get_frequency();
+    uint64_t start_ticks = vkstats_stopwatch_get_ticks();
+    instance->layer_time = 0.0;
+
+    if (validation)
+    {
+        check_layer(VKSTATS_VALIDATION_LAYER);
+
+        uint64_t end_ticks = vkstats_stopwatch_get_ticks();
+        instance->layer_time = (double)(end_ticks - start_ticks) / frequency * 1000.0;
+        vkstats_trace_host_event("startup", "Layer enumeration", start_ticks, end_ticks, 0);
+
+        instance_ci.pNext = &debug_utils;
+        instance_ci.enabledLayerCount = array_length(enabled_layers);
+        instance_ci.ppEnabledLayerNames = enabled_layers;
+        instance_ci.ppEnabledExtensionNames = enabled_extensions;
+        instance_ci.enabledExtensionCount = array_length(enabled_extensions);
+    }
+
+    start_ticks = vkstats_stopwatch_get_ticks();
     result = vkCreateInstance(&instance_ci, NULL, &instance->instance);
+    uint64_t end_ticks = vkstats_stopwatch_get_ticks();
     check_result(result, "Could not create instance!");
 
-    instance->messenger = create_messenger(instance->instance);
+    instance->create_time = (double)(end_ticks - start_ticks) / frequency * 1000.0;
+    vkstats_trace_host_event("startup", "vkCreateInstance", start_ticks, end_ticks, 0);
+
+    instance->messenger = validation ? create_messenger(instance->instance) : VK_NULL_HANDLE;
 }
 
 void vkstats_instance_destroy(vkstats_instance* instance)
 {
-    destroy_messenger(instance->instance, instance->messenger);
+    if (instance->messenger != VK_NULL_HANDLE)
+    {
+        destroy_messenger(instance->instance, instance->messenger);
+    }
+
     vkDestroyInstance(instance->instance, NULL);
 }
 
+VkBool32 vkstats_instance_has_layer(const char* layer_name)
+{
+    uint32_t i;
+    VkResult result;
+    uint32_t property_count;
+    VkLayerProperties* properties;
+
+    vkEnumerateInstanceLayerProperties(&property_count, NULL);
+    properties = malloc(property_count * sizeof(properties[0]));
+
+    if (properties == NULL)
+    {
+        fatal_error("Could not allocate instance layer properties!");
+    }
+
+    result = vkEnumerateInstanceLayerProperties(&property_count, properties);
+    check_result(result, "Could not enumerate instance layer properties!");
+
+    for (i = 0; i < property_count; i++)
+    {
+        if (strcmp(layer_name, properties[i].layerName) == 0)
+        {
+            free(properties);
+            return VK_TRUE;
+        }
+    }
+
+    free(properties);
+    return VK_FALSE;
+}
+
 /*
 * create_messenger()
 *
@@ -134,28 +191,8 @@ VkBool32 debug_messenger(VkDebugUtilsMessageSeverityFlagBitsEXT severity, VkDebu
 */
 void check_layer(const char* layer_name)
 {
-    uint32_t i;
-    VkResult result;
-    uint32_t property_count;
-    VkLayerProperties properties[MAX_INSTANCE_LAYER_PROPERTIES];
-
-    vkEnumerateInstanceLayerProperties(&property_count, NULL);
-
-    if (property_count > MAX_INSTANCE_LAYER_PROPERTIES)
+    if (!vkstats_instance_has_layer(layer_name))
     {
-        fatal_error("Maximum instance layer properties too small.");
+        fatal_error("Could not find required layer!");
     }
-
-    result = vkEnumerateInstanceLayerProperties(&property_count, properties);
-    check_result(result, "Could not enumerate instance layer properties!");
-
-    for (i = 0; i < property_count; i++)
-    {
-        if (strcmp(layer_name, properties[i].layerName) == 0)
-        {
-            return;
-        }
-    }
-
-    fatal_error("Could not find required layer!");
 }
@@ -3,20 +3,45 @@
 
 #include "vulkan/vulkan.h"
 
+/*
+* The times record how long each phase of creation took, in milliseconds.
+*/
 typedef struct
 {
     VkInstance instance;
     VkDebugUtilsMessengerEXT messenger;
+    double layer_time;
+    double create_time;
 } vkstats_instance;
 
+/*
+* The layer enabled by validation mode.
+*/
+#define VKSTATS_VALIDATION_LAYER "VK_LAYER_KHRONOS_validation"
+
 /*
 * vkstats_instance_create()
 * 
 * Creates a vkstats_instance, which encapsulates the VkInstance.
 * 
 * instance: the created instance will be placed here.
+* validation: whether to enable the validation layer and a debug messenger
+*             that prints its errors. Aborts the application if the layer is
+*             missing. Layers add CPU overhead to every call, so measurements
+*             should be taken without them.
+*/
+void vkstats_instance_create(vkstats_instance *instance, VkBool32 validation);
+
+/*
+* vkstats_instance_has_layer()
+*
+* Checks whether an instance layer is available.
+*
+* layer_name: the layer to check for.
+*
+* Returns VK_TRUE if the layer is available.
 */
-void vkstats_instance_create(vkstats_instance *instance);
+VkBool32 vkstats_instance_has_layer(const char* layer_name);
 
 /*
 * vkstats_instance_create()
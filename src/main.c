@@ -1,12 +1,37 @@
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "vulkan/vulkan.h"
 
+#include "config.h"
+#include "util.h"
 #include "instance.h"
 #include "physical_device.h"
 #include "device.h"
+#include "stopwatch.h"
+#include "harness.h"
+#include "options.h"
+#include "results.h"
+#include "trace.h"
+#include "thread.h"
 #include "experiments.h"
 
+typedef struct
+{
+    vkstats_physical_device     physical_device;
+    vkstats_device              device;
+    vkstats_harness             harness;
+    const vkstats_options*      options;
+    uint32_t                    device_index;
+    char                        prefix[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE + 8];
+    vkstats_thread              thread;
+} device_worker;
+
+static void create_device(vkstats_device* device, vkstats_physical_device* physical_device);
+static void run_experiments(vkstats_device* device, uint32_t device_index, vkstats_harness* harness, const vkstats_options* options);
+static void run_device_worker(void* context);
+static int run_pipeline_cache_child(const vkstats_options* options);
+
 /*
 * main
 * 
@@ -15,25 +40,236 @@
 */
 int main(int argc, char** argv)
 {
-    argc; argv;
+    vkstats_options options;
+    vkstats_options_parse(&options, argc, argv);
+
+    if (options.pipeline_cache_load_path != NULL && options.pipeline_cache_result_path != NULL)
+    {
+        return run_pipeline_cache_child(&options);
+    }
+
+    if (options.startup_result_path != NULL)
+    {
+        vkstats_experiment_startup_child(options.device_index, options.startup_result_path);
+        return 0;
+    }
+
+    vkstats_stopwatch_calibration calibration;
+    vkstats_stopwatch_calibrate(&calibration);
+    printf("Stopwatch resolution: %.1f ns, overhead: %.1f ns\n", calibration.resolution * 1000000.0, calibration.overhead * 1000000.0);
+
+    vkstats_results results;
+    vkstats_results_init(&results);
+
+    if (options.json_path != NULL)
+    {
+        vkstats_results_open_json(&results, options.json_path);
+    }
+
+    if (options.csv_path != NULL)
+    {
+        vkstats_results_open_csv(&results, options.csv_path);
+    }
+
+    if (options.trace_path != NULL)
+    {
+        vkstats_trace_init(MAX_TRACE_EVENTS);
+    }
+
+    vkstats_harness harness;
+    vkstats_harness_init(&harness, options.warmup_count, options.trial_count, options.cpu);
+    vkstats_harness_set_results(&harness, &results);
 
     vkstats_instance instance;
-    vkstats_instance_create(&instance);
+    vkstats_instance_create(&instance, options.validation);
 
-    vkstats_physical_device physical_device;
-    vkstats_physical_device_get(&physical_device, instance.instance, 0);
-    printf("Using physical device: %s\n", physical_device.properties.deviceName);
+    if (options.all_devices)
+    {
+        uint32_t device_count = vkstats_physical_device_get_count(instance.instance);
+        device_worker* workers = calloc(device_count, sizeof(device_worker));
+        vkstats_device** devices = calloc(device_count, sizeof(vkstats_device*));
 
-    vkstats_device device;
+        if (workers == NULL || devices == NULL)
+        {
+            fatal_error("Could not allocate devices!");
+        }
+
+        /*
+        * Every device runs the suite on its own thread with its own harness.
+        * When pinning, each thread gets its own CPU, counting up from the one
+        * requested.
+        */
+        for (uint32_t i = 0; i < device_count; i++)
+        {
+            device_worker* worker = &workers[i];
+            int32_t cpu = options.cpu == VKSTATS_NO_AFFINITY ? VKSTATS_NO_AFFINITY : options.cpu + (int32_t)i;
+
+            vkstats_physical_device_get(&worker->physical_device, instance.instance, i);
+            printf("Using physical device %u: %s\n", i, worker->physical_device.properties.deviceName);
+
+            create_device(&worker->device, &worker->physical_device);
+            devices[i] = &worker->device;
+
+            snprintf(worker->prefix, sizeof(worker->prefix), "[%u] ", i);
+            vkstats_harness_init(&worker->harness, options.warmup_count, options.trial_count, cpu);
+            vkstats_harness_set_results(&worker->harness, &results);
+            worker->harness.prefix = worker->prefix;
+            worker->device_index = i;
+            worker->options = &options;
+        }
+
+        for (uint32_t i = 0; i < device_count; i++)
+        {
+            vkstats_thread_create(&workers[i].thread, run_device_worker, &workers[i]);
+        }
+
+        for (uint32_t i = 0; i < device_count; i++)
+        {
+            vkstats_thread_join(&workers[i].thread);
+        }
+
+        /*
+        * Cross-device bandwidth runs on its own, once every device is idle.
+        */
+        vkstats_experiment_multi_device_transfer(devices, device_count, 1, &harness);
+
+        for (uint32_t i = 0; i < device_count; i++)
+        {
+            vkstats_device_destroy(&workers[i].device);
+        }
+
+        free(devices);
+        free(workers);
+    }
+    else
+    {
+        vkstats_physical_device physical_device;
+        vkstats_physical_device_get(&physical_device, instance.instance, options.device_index);
+        printf("Using physical device: %s\n", physical_device.properties.deviceName);
+
+        vkstats_device device;
+        create_device(&device, &physical_device);
+        printf("Startup: layers %.3f ms, instance %.3f ms, enumeration %.3f ms, queries %.3f ms, device %.3f ms, command pools %.3f ms\n",
+            instance.layer_time, instance.create_time, physical_device.enumeration_time, physical_device.query_time, device.create_time, device.command_pool_time);
+
+        run_experiments(&device, options.device_index, &harness, &options);
+        vkstats_device_destroy(&device);
+
+        vkstats_experiment_validation_overhead(options.device_index, &harness);
+
+        if (options.startup_cycles > 0)
+        {
+            vkstats_experiment_startup(options.device_index, options.startup_cycles, &harness);
+        }
+    }
+
+    vkstats_instance_destroy(&instance);
+
+    if (options.trace_path != NULL)
+    {
+        vkstats_trace_write(options.trace_path);
+        vkstats_trace_destroy();
+    }
+
+    uint32_t regression_count = 0;
+
+    if (options.compare_path != NULL)
+    {
+        regression_count = vkstats_results_compare(&results, options.compare_path);
+    }
+
+    vkstats_results_destroy(&results);
+
+    return regression_count > 0 ? 1 : 0;
+}
+
+/*
+* create_device()
+*
+* Creates the device the experiments run on.
+*
+* device: the device will be placed here.
+* physical_device: the physical device to create the device for.
+*/
+static void create_device(vkstats_device* device, vkstats_physical_device* physical_device)
+{
     vkstats_device_builder device_builder;
-    vkstats_device_builder_init(&device_builder, &physical_device);
-    vkstats_device_builder_add_queue(&device_builder, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_TRANSFER_BIT);
-    vkstats_device_builder_add_queue(&device_builder, VK_QUEUE_TRANSFER_BIT);
-    vkstats_device_builder_build(&device_builder, &device);
+    vkstats_experiment_init_device_builder(&device_builder, physical_device);
+    vkstats_device_builder_build(&device_builder, device);
+}
 
-    vkstats_experiment_queue_transfer_speed(&device, 0);
-    vkstats_experiment_queue_transfer_speed(&device, 1);
+/*
+* run_experiments()
+*
+* Runs the experiment suite on a device.
+*
+* device: the device to run on.
+* device_index: the index of the physical device the device was created for.
+* harness: the harness to take the measurements with.
+* options: the command line options.
+*/
+static void run_experiments(vkstats_device* device, uint32_t device_index, vkstats_harness* harness, const vkstats_options* options)
+{
+    vkstats_experiment_queue_transfer_speed(device, 0, harness);
+    vkstats_experiment_queue_transfer_speed(device, 1, harness);
+    vkstats_experiment_queue_streaming_bandwidth(device, 0, harness);
+    vkstats_experiment_queue_streaming_bandwidth(device, 1, harness);
+    vkstats_experiment_concurrent_queue_transfer(device, harness);
+    vkstats_experiment_memory_type_matrix(device, 0, harness);
+    vkstats_experiment_staging_write(device, 1, harness);
+    vkstats_experiment_compute_bandwidth(device, 0, options->workgroup_size, harness);
+    vkstats_experiment_compute_bandwidth(device, 2, options->workgroup_size, harness);
+    vkstats_experiment_image_upload(device, 0, harness);
+    vkstats_experiment_image_upload(device, 1, harness);
+    vkstats_experiment_allocation_latency(device, 0, harness);
+    vkstats_experiment_submission_latency(device, 0, 1, harness);
+    vkstats_experiment_small_upload(device, 0, harness);
+    vkstats_experiment_copy_regions(device, 1, harness);
+    vkstats_experiment_file_upload(device, device_index, 1, harness);
+    vkstats_experiment_command_recording(device, 0, harness);
+    vkstats_experiment_pipeline_cache(device, harness);
+    vkstats_experiment_async_overlap(device, 0, 1, harness);
+    vkstats_experiment_async_overlap(device, 2, 1, harness);
+}
 
+/*
+* run_device_worker()
+*
+* Host thread for one device in --all-devices mode.
+*
+* context: a device_worker.
+*/
+static void run_device_worker(void* context)
+{
+    device_worker* worker = context;
+
+    run_experiments(&worker->device, worker->device_index, &worker->harness, worker->options);
+}
+
+/*
+* run_pipeline_cache_child()
+*
+* Entry point of the fresh process the pipeline cache experiment starts. Opens
+* the same device and builds the pipeline corpus once.
+*
+* options: the parsed command line.
+*
+* Returns the process exit code.
+*/
+static int run_pipeline_cache_child(const vkstats_options* options)
+{
+    vkstats_instance instance;
+    vkstats_instance_create(&instance, VK_FALSE);
+
+    vkstats_physical_device physical_device;
+    vkstats_physical_device_get(&physical_device, instance.instance, options->device_index);
+
+    vkstats_device device;
+    create_device(&device, &physical_device);
+    vkstats_experiment_pipeline_cache_child(&device, options->pipeline_cache_load_path, options->pipeline_cache_result_path);
     vkstats_device_destroy(&device);
+
     vkstats_instance_destroy(&instance);
+
+    return 0;
 }
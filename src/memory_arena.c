@@ -0,0 +1,132 @@
+#include "vulkan/vulkan.h"
+
+#include "device.h"
+#include "memory_arena.h"
+#include "stopwatch.h"
+#include "trace.h"
+#include "util.h"
+
+void vkstats_memory_arena_init(vkstats_memory_arena* arena, vkstats_device* device)
+{
+    clear_struct(arena);
+    arena->device = device;
+}
+
+void vkstats_memory_arena_reserve(vkstats_memory_arena* arena, const VkBufferCreateInfo* buffer_ci, uint32_t memory_type_index)
+{
+    VkResult result;
+    VkBuffer buffer;
+    VkMemoryRequirements requirements;
+
+    if (arena->memory[memory_type_index] != VK_NULL_HANDLE)
+    {
+        fatal_error("Memory arena is already allocated!");
+    }
+
+    /*
+    * Create a throwaway buffer to find out how much memory it needs. The
+    * alignment is added on top so the buffer fits wherever it lands.
+    */
+    result = vkCreateBuffer(arena->device->device, buffer_ci, NULL, &buffer);
+    check_result(result, "Could not create buffer!");
+
+    vkGetBufferMemoryRequirements(arena->device->device, buffer, &requirements);
+    vkDestroyBuffer(arena->device->device, buffer, NULL);
+
+    arena->capacities[memory_type_index] += requirements.size + requirements.alignment;
+}
+
+void vkstats_memory_arena_allocate(vkstats_memory_arena* arena)
+{
+    VkResult result;
+
+    for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++)
+    {
+        if (arena->capacities[i] == 0 || arena->memory[i] != VK_NULL_HANDLE)
+        {
+            continue;
+        }
+
+        if (arena->capacities[i] > arena->device->physical_device->max_memory_allocation_size)
+        {
+            fatal_error("Memory arena is larger than maxMemoryAllocationSize!");
+        }
+
+        VkMemoryAllocateInfo m_ai = { 0 };
+        m_ai.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        m_ai.allocationSize = arena->capacities[i];
+        m_ai.memoryTypeIndex = i;
+
+        uint64_t start_ticks = vkstats_stopwatch_get_ticks();
+        result = vkAllocateMemory(arena->device->device, &m_ai, NULL, &arena->memory[i]);
+        vkstats_trace_host_event("allocation", "vkAllocateMemory", start_ticks, vkstats_stopwatch_get_ticks(), arena->capacities[i]);
+        check_result(result, "Could not allocate memory!");
+    }
+}
+
+VkDeviceSize vkstats_memory_arena_bind_buffer(vkstats_memory_arena* arena, VkBuffer buffer, uint32_t memory_type_index)
+{
+    VkResult result;
+    VkDeviceSize offset;
+    VkMemoryRequirements requirements;
+
+    vkGetBufferMemoryRequirements(arena->device->device, buffer, &requirements);
+
+    if (!(requirements.memoryTypeBits & (1u << memory_type_index)))
+    {
+        fatal_error("Buffer does not support the arena memory type!");
+    }
+
+    offset = align_up(arena->offsets[memory_type_index], requirements.alignment);
+
+    if (arena->memory[memory_type_index] == VK_NULL_HANDLE || offset + requirements.size > arena->capacities[memory_type_index])
+    {
+        fatal_error("Memory arena is too small!");
+    }
+
+    result = vkBindBufferMemory(arena->device->device, buffer, arena->memory[memory_type_index], offset);
+    check_result(result, "Could not bind buffer memory!");
+
+    arena->offsets[memory_type_index] = offset + requirements.size;
+
+    return offset;
+}
+
+void* vkstats_memory_arena_map(vkstats_memory_arena* arena, uint32_t memory_type_index)
+{
+    VkResult result;
+
+    if (arena->mapped[memory_type_index] == NULL)
+    {
+        result = vkMapMemory(arena->device->device, arena->memory[memory_type_index], 0, VK_WHOLE_SIZE, 0, &arena->mapped[memory_type_index]);
+        check_result(result, "Could not map memory!");
+    }
+
+    return arena->mapped[memory_type_index];
+}
+
+void vkstats_memory_arena_reset(vkstats_memory_arena* arena)
+{
+    for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++)
+    {
+        arena->offsets[i] = 0;
+    }
+}
+
+void vkstats_memory_arena_destroy(vkstats_memory_arena* arena)
+{
+    for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++)
+    {
+        if (arena->mapped[i] != NULL)
+        {
+            vkUnmapMemory(arena->device->device, arena->memory[i]);
+        }
+
+        if (arena->memory[i] != VK_NULL_HANDLE)
+        {
+            vkFreeMemory(arena->device->device, arena->memory[i], NULL);
+        }
+    }
+
+    clear_struct(arena);
+}
@@ -0,0 +1,100 @@
+#if !defined(VKSTATS_MEMORY_ARENA_H)
+#define VKSTATS_MEMORY_ARENA_H
+
+#include <stdint.h>
+
+#include "vulkan/vulkan.h"
+
+#include "device.h"
+
+typedef struct
+{
+    vkstats_device*     device;
+    VkDeviceMemory      memory[VK_MAX_MEMORY_TYPES];
+    VkDeviceSize        capacities[VK_MAX_MEMORY_TYPES];
+    VkDeviceSize        offsets[VK_MAX_MEMORY_TYPES];
+    void*               mapped[VK_MAX_MEMORY_TYPES];
+} vkstats_memory_arena;
+
+/*
+* vkstats_memory_arena_init()
+*
+* Initialize a memory arena. Nothing is allocated until
+* vkstats_memory_arena_allocate() is called.
+*
+* arena: the arena to initialize.
+* device: the device to allocate memory from.
+*/
+void vkstats_memory_arena_init(vkstats_memory_arena* arena, vkstats_device* device);
+
+/*
+* vkstats_memory_arena_reserve()
+*
+* Reserves space in the arena for a buffer, including padding for its
+* alignment. Reservations for the same memory type accumulate into a single
+* block.
+*
+* arena: the arena to reserve space in.
+* buffer_ci: describes the largest buffer that will be bound.
+* memory_type_index: the memory type the buffer will be bound to.
+*/
+void vkstats_memory_arena_reserve(vkstats_memory_arena* arena, const VkBufferCreateInfo* buffer_ci, uint32_t memory_type_index);
+
+/*
+* vkstats_memory_arena_allocate()
+*
+* Allocates one block of device memory for each memory type that has space
+* reserved. Aborts the application if a block would be larger than
+* maxMemoryAllocationSize.
+*
+* arena: the arena to allocate.
+*/
+void vkstats_memory_arena_allocate(vkstats_memory_arena* arena);
+
+/*
+* vkstats_memory_arena_bind_buffer()
+*
+* Binds a buffer to the next suitably aligned range of the arena. Aborts the
+* application if the buffer can't use the memory type or doesn't fit.
+*
+* arena: the arena to bind from.
+* buffer: the buffer to bind.
+* memory_type_index: the memory type to bind the buffer to.
+*
+* Returns the offset of the buffer in the memory type's block.
+*/
+VkDeviceSize vkstats_memory_arena_bind_buffer(vkstats_memory_arena* arena, VkBuffer buffer, uint32_t memory_type_index);
+
+/*
+* vkstats_memory_arena_map()
+*
+* Maps a memory type's block. The mapping persists until the arena is
+* destroyed, so mapping again returns the same pointer.
+*
+* arena: the arena to map.
+* memory_type_index: the memory type to map. Must be host visible.
+*
+* Returns a pointer to the start of the block.
+*/
+void* vkstats_memory_arena_map(vkstats_memory_arena* arena, uint32_t memory_type_index);
+
+/*
+* vkstats_memory_arena_reset()
+*
+* Makes the whole arena available again. Buffers bound from it must be
+* destroyed or no longer used.
+*
+* arena: the arena to reset.
+*/
+void vkstats_memory_arena_reset(vkstats_memory_arena* arena);
+
+/*
+* vkstats_memory_arena_destroy()
+*
+* Frees the memory owned by an arena.
+*
+* arena: the arena to destroy.
+*/
+void vkstats_memory_arena_destroy(vkstats_memory_arena* arena);
+
+#endif
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "harness.h"
+#include "options.h"
+#include "util.h"
+
+static void print_usage(void);
+static uint32_t parse_uint(int argc, char** argv, int* i);
+static const char* parse_string(int argc, char** argv, int* i);
+
+void vkstats_options_parse(vkstats_options* options, int argc, char** argv)
+{
+    clear_struct(options);
+    options->warmup_count = 2;
+    options->trial_count = 10;
+    options->cpu = VKSTATS_NO_AFFINITY;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--warmup") == 0)
+        {
+            options->warmup_count = parse_uint(argc, argv, &i);
+        }
+        else if (strcmp(argv[i], "--trials") == 0)
+        {
+            options->trial_count = parse_uint(argc, argv, &i);
+        }
+        else if (strcmp(argv[i], "--pin-cpu") == 0)
+        {
+            options->cpu = (int32_t)parse_uint(argc, argv, &i);
+        }
+        else if (strcmp(argv[i], "--workgroup-size") == 0)
+        {
+            options->workgroup_size = parse_uint(argc, argv, &i);
+
+            if (options->workgroup_size == 0)
+            {
+                print_usage();
+                fatal_error("Workgroup size must not be zero!");
+            }
+        }
+        else if (strcmp(argv[i], "--device") == 0)
+        {
+            options->device_index = parse_uint(argc, argv, &i);
+        }
+        else if (strcmp(argv[i], "--all-devices") == 0)
+        {
+            options->all_devices = VK_TRUE;
+        }
+        else if (strcmp(argv[i], "--validation") == 0)
+        {
+            options->validation = VK_TRUE;
+        }
+        else if (strcmp(argv[i], "--json") == 0)
+        {
+            options->json_path = parse_string(argc, argv, &i);
+        }
+        else if (strcmp(argv[i], "--csv") == 0)
+        {
+            options->csv_path = parse_string(argc, argv, &i);
+        }
+        else if (strcmp(argv[i], "--compare") == 0)
+        {
+            options->compare_path = parse_string(argc, argv, &i);
+        }
+        else if (strcmp(argv[i], "--trace") == 0)
+        {
+            options->trace_path = parse_string(argc, argv, &i);
+        }
+        else if (strcmp(argv[i], "--startup-cycles") == 0)
+        {
+            options->startup_cycles = parse_uint(argc, argv, &i);
+
+            if (options->startup_cycles > MAX_TRIALS)
+            {
+                print_usage();
+                fatal_error("Startup cycles must not exceed MAX_TRIALS!");
+            }
+        }
+        /*
+        * Internal: the pipeline cache experiment starts a fresh copy of
+        * vkstats with these to load its cache.
+        */
+        else if (strcmp(argv[i], "--pipeline-cache-load") == 0)
+        {
+            options->pipeline_cache_load_path = parse_string(argc, argv, &i);
+        }
+        else if (strcmp(argv[i], "--pipeline-cache-result") == 0)
+        {
+            options->pipeline_cache_result_path = parse_string(argc, argv, &i);
+        }
+        /*
+        * Internal: the startup experiment starts a fresh copy of vkstats with
+        * this to time a cold start.
+        */
+        else if (strcmp(argv[i], "--startup-result") == 0)
+        {
+            options->startup_result_path = parse_string(argc, argv, &i);
+        }
+        else
+        {
+            print_usage();
+            fatal_error("Unknown argument!");
+        }
+    }
+}
+
+/*
+* print_usage()
+*
+* Prints the command line usage.
+*/
+static void print_usage(void)
+{
+    printf("Usage: vkstats [options]\n");
+    printf("  --warmup <count>      untimed runs before each measurement (default 2)\n");
+    printf("  --trials <count>      timed runs per measurement (default 10)\n");
+    printf("  --pin-cpu <cpu>       pin the timing thread to a CPU\n");
+    printf("  --workgroup-size <n>  compute workgroup size (default: sweep)\n");
+    printf("  --device <index>      the physical device to run on (default 0)\n");
+    printf("  --all-devices         run on every physical device at the same time\n");
+    printf("  --validation          enable the validation layer (skews timings)\n");
+    printf("  --json <file>         write results to a JSON file\n");
+    printf("  --csv <file>          write results to a CSV file\n");
+    printf("  --compare <file>      compare results to a JSON baseline, and exit with\n");
+    printf("                        an error if any regressed\n");
+    printf("  --trace <file>        write a Chrome Trace Event JSON timeline of the run\n");
+    printf("  --startup-cycles <n>  time instance and device creation over n cold\n");
+    printf("                        and n warm cycles (default 0, off)\n");
+}
+
+/*
+* parse_uint()
+*
+* Parses the value following an option as an unsigned integer. Aborts the
+* application if it is missing or invalid.
+*
+* argc: argument count.
+* argv: argument values.
+* i: the index of the option. Advanced past the value.
+*
+* Returns the parsed value.
+*/
+static uint32_t parse_uint(int argc, char** argv, int* i)
+{
+    char* end;
+    unsigned long value;
+
+    if (*i + 1 >= argc)
+    {
+        print_usage();
+        fatal_error("Missing value for argument!");
+    }
+
+    (*i)++;
+    value = strtoul(argv[*i], &end, 10);
+
+    if (*end != '\0' || end == argv[*i])
+    {
+        print_usage();
+        fatal_error("Invalid value for argument!");
+    }
+
+    return (uint32_t)value;
+}
+
+/*
+* parse_string()
+*
+* Gets the value following an option. Aborts the application if it is
+* missing.
+*
+* argc: argument count.
+* argv: argument values.
+* i: the index of the option. Advanced past the value.
+*
+* Returns the value.
+*/
+static const char* parse_string(int argc, char** argv, int* i)
+{
+    if (*i + 1 >= argc)
+    {
+        print_usage();
+        fatal_error("Missing value for argument!");
+    }
+
+    (*i)++;
+
+    return argv[*i];
+}
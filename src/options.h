@@ -0,0 +1,38 @@
+#if !defined(VKSTATS_OPTIONS_H)
+#define VKSTATS_OPTIONS_H
+
+#include <stdint.h>
+
+#include "vulkan/vulkan.h"
+
+typedef struct
+{
+    uint32_t        warmup_count;
+    uint32_t        trial_count;
+    int32_t         cpu;
+    uint32_t        workgroup_size;
+    uint32_t        device_index;
+    VkBool32        all_devices;
+    VkBool32        validation;
+    const char*     json_path;
+    const char*     csv_path;
+    const char*     compare_path;
+    const char*     trace_path;
+    uint32_t        startup_cycles;
+    const char*     pipeline_cache_load_path;
+    const char*     pipeline_cache_result_path;
+    const char*     startup_result_path;
+} vkstats_options;
+
+/*
+* vkstats_options_parse()
+*
+* Parses the command line. Aborts the application on invalid arguments.
+*
+* options: the parsed options will be placed here.
+* argc: argument count.
+* argv: argument values.
+*/
+void vkstats_options_parse(vkstats_options* options, int argc, char** argv);
+
+#endif
@@ -1,7 +1,11 @@
+#include <stdlib.h>
+#include <string.h>
+
 #include "vulkan/vulkan.h"
 
-#include "config.h"
 #include "util.h"
+#include "stopwatch.h"
+#include "trace.h"
 #include "physical_device.h"
 
 /*
@@ -17,27 +21,132 @@
 */
 void vkstats_physical_device_get(vkstats_physical_device* physical_device, VkInstance instance, uint32_t device_index)
 {
-    uint32_t physical_device_count;
-    VkPhysicalDevice physical_devices[MAX_PHYSICAL_DEVICES];
+    VkResult result;
+    double frequency = vkstats_stopwatch_get_frequency();
+    uint64_t start_ticks = vkstats_stopwatch_get_ticks();
+    uint32_t physical_device_count = vkstats_physical_device_get_count(instance);
+    VkPhysicalDevice* physical_devices;
+
+    if (device_index >= physical_device_count)
+    {
+        fatal_error("Invalid physical device!");
+    }
 
-    vkEnumeratePhysicalDevices(instance, &physical_device_count, NULL);
+    physical_devices = malloc(physical_device_count * sizeof(physical_devices[0]));
 
-    if (physical_device_count > MAX_PHYSICAL_DEVICES)
+    if (physical_devices == NULL)
     {
-        fatal_error("Maximum physical devices is too small!");
+        fatal_error("Could not allocate physical devices!");
     }
 
-    vkEnumeratePhysicalDevices(instance, &physical_device_count, physical_devices);
+    result = vkEnumeratePhysicalDevices(instance, &physical_device_count, physical_devices);
 
-    if (device_index < physical_device_count)
+    if (result != VK_SUCCESS && result != VK_INCOMPLETE)
     {
-         physical_device->physical_device = physical_devices[device_index];
+        fatal_error("Could not enumerate physical devices!");
     }
-    else
+
+    if (device_index >= physical_device_count)
     {
         fatal_error("Invalid physical device!");
     }
 
+    physical_device->instance = instance;
+    physical_device->physical_device = physical_devices[device_index];
+    free(physical_devices);
+
+    uint64_t end_ticks = vkstats_stopwatch_get_ticks();
+    physical_device->enumeration_time = (double)(end_ticks - start_ticks) / frequency * 1000.0;
+    vkstats_trace_host_event("startup", "Physical device enumeration", start_ticks, end_ticks, physical_device_count);
+
+    start_ticks = vkstats_stopwatch_get_ticks();
     vkGetPhysicalDeviceProperties(physical_device->physical_device, &physical_device->properties);
     vkGetPhysicalDeviceMemoryProperties(physical_device->physical_device, &physical_device->memory_properties);
+
+    /*
+    * The largest single allocation is a Vulkan 1.1 property, so it has to be
+    * queried through the properties chain.
+    */
+    VkPhysicalDeviceMaintenance3Properties maintenance3_properties = { 0 };
+    maintenance3_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MAINTENANCE_3_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 properties2 = { 0 };
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &maintenance3_properties;
+    vkGetPhysicalDeviceProperties2(physical_device->physical_device, &properties2);
+
+    physical_device->max_memory_allocation_size = maintenance3_properties.maxMemoryAllocationSize;
+
+    end_ticks = vkstats_stopwatch_get_ticks();
+    physical_device->query_time = (double)(end_ticks - start_ticks) / frequency * 1000.0;
+    vkstats_trace_host_event("startup", "Physical device queries", start_ticks, end_ticks, 0);
+}
+
+uint32_t vkstats_physical_device_get_count(VkInstance instance)
+{
+    VkResult result;
+    uint32_t physical_device_count = 0;
+
+    result = vkEnumeratePhysicalDevices(instance, &physical_device_count, NULL);
+    check_result(result, "Could not enumerate physical devices!");
+
+    return physical_device_count;
+}
+
+VkBool32 vkstats_physical_device_has_extension(vkstats_physical_device* physical_device, const char* extension_name)
+{
+    VkResult result;
+    uint32_t property_count = 0;
+    VkExtensionProperties* properties;
+    VkBool32 found = VK_FALSE;
+
+    result = vkEnumerateDeviceExtensionProperties(physical_device->physical_device, NULL, &property_count, NULL);
+    check_result(result, "Could not enumerate device extension properties!");
+    properties = malloc(property_count * sizeof(properties[0]));
+
+    if (properties == NULL)
+    {
+        fatal_error("Could not allocate device extension properties!");
+    }
+
+    result = vkEnumerateDeviceExtensionProperties(physical_device->physical_device, NULL, &property_count, properties);
+    check_result(result, "Could not enumerate device extension properties!");
+
+    for (uint32_t i = 0; i < property_count && !found; i++)
+    {
+        found = strcmp(extension_name, properties[i].extensionName) == 0;
+    }
+
+    free(properties);
+
+    return found;
+}
+
+VkDeviceSize vkstats_physical_device_get_heap_budget(vkstats_physical_device* physical_device, uint32_t heap_index)
+{
+    VkDeviceSize heap_size = physical_device->memory_properties.memoryHeaps[heap_index].size;
+
+    if (!vkstats_physical_device_has_extension(physical_device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+    {
+        return heap_size;
+    }
+
+    /*
+    * The budget includes what this process already uses, so that's taken
+    * off.
+    */
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties = { 0 };
+    budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 memory_properties2 = { 0 };
+    memory_properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    memory_properties2.pNext = &budget_properties;
+    vkGetPhysicalDeviceMemoryProperties2(physical_device->physical_device, &memory_properties2);
+
+    if (budget_properties.heapUsage[heap_index] >= budget_properties.heapBudget[heap_index])
+    {
+        return 0;
+    }
+
+    return budget_properties.heapBudget[heap_index] - budget_properties.heapUsage[heap_index];
 }
@@ -1,13 +1,23 @@
 #if !defined(VKSTATS_PHYSICAL_DEVICE_H)
 #define VKSTATS_PHYSICAL_DEVICE_H
 
+#include <stdint.h>
+
 #include "vulkan/vulkan.h"
 
+/*
+* The times record how long each phase of getting the physical device took,
+* in milliseconds.
+*/
 typedef struct
 {
+    VkInstance                          instance;
     VkPhysicalDevice                    physical_device;
     VkPhysicalDeviceProperties          properties;
     VkPhysicalDeviceMemoryProperties    memory_properties;
+    VkDeviceSize                        max_memory_allocation_size;
+    double                              enumeration_time;
+    double                              query_time;
 } vkstats_physical_device;
 
 /*
@@ -21,4 +31,40 @@ typedef struct
 */
 void vkstats_physical_device_get(vkstats_physical_device* physical_device, VkInstance instance, uint32_t device_index);
 
+/*
+* vkstats_physical_device_get_count()
+*
+* Gets the number of physical devices.
+*
+* instance: the instance to count the physical devices of.
+*
+* Returns the number of physical devices.
+*/
+uint32_t vkstats_physical_device_get_count(VkInstance instance);
+
+/*
+* vkstats_physical_device_has_extension()
+*
+* Checks whether the physical device supports a device extension.
+*
+* physical_device: the physical device to check.
+* extension_name: the extension to check for.
+*
+* Returns VK_TRUE if the extension is supported.
+*/
+VkBool32 vkstats_physical_device_has_extension(vkstats_physical_device* physical_device, const char* extension_name);
+
+/*
+* vkstats_physical_device_get_heap_budget()
+*
+* Gets how much more of a memory heap this process can expect to allocate.
+* Uses VK_EXT_memory_budget if it's supported, and the heap size otherwise.
+*
+* physical_device: the physical device to check.
+* heap_index: the index of the memory heap.
+*
+* Returns the remaining budget in bytes.
+*/
+VkDeviceSize vkstats_physical_device_get_heap_budget(vkstats_physical_device* physical_device, uint32_t heap_index);
+
 #endif
@@ -0,0 +1,21 @@
+#if !defined(VKSTATS_PROCESS_H)
+#define VKSTATS_PROCESS_H
+
+#include <stdint.h>
+
+#include "vulkan/vulkan.h"
+
+/*
+* vkstats_process_run_self()
+*
+* Runs another copy of this executable and waits for it to exit.
+*
+* arguments: the command line arguments, not including the executable.
+* argument_count: the number of arguments.
+* exit_code: the exit code of the process will be placed here.
+*
+* Returns VK_FALSE if the process couldn't be started.
+*/
+VkBool32 vkstats_process_run_self(const char* const* arguments, uint32_t argument_count, int* exit_code);
+
+#endif
\ No newline at end of file
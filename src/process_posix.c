@@ -0,0 +1,52 @@
+#include <spawn.h>
+#include <sys/wait.h>
+
+#include "config.h"
+#include "process.h"
+#include "util.h"
+
+extern char** environ;
+
+VkBool32 vkstats_process_run_self(const char* const* arguments, uint32_t argument_count, int* exit_code)
+{
+    char* argv[MAX_PROCESS_ARGUMENTS + 2];
+    pid_t pid;
+    int status;
+
+    if (argument_count > MAX_PROCESS_ARGUMENTS)
+    {
+        fatal_error("Too many process arguments!");
+    }
+
+    /*
+    * Only Linux has a path that always leads back to the running executable.
+    */
+#if defined(__linux__)
+    argv[0] = "/proc/self/exe";
+#else
+    (void)arguments;
+    (void)exit_code;
+    return VK_FALSE;
+#endif
+
+    for (uint32_t i = 0; i < argument_count; i++)
+    {
+        argv[i + 1] = (char*)arguments[i];
+    }
+
+    argv[argument_count + 1] = NULL;
+
+    if (posix_spawn(&pid, argv[0], NULL, NULL, argv, environ) != 0)
+    {
+        return VK_FALSE;
+    }
+
+    if (waitpid(pid, &status, 0) != pid)
+    {
+        fatal_error("Could not wait for process!");
+    }
+
+    *exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+
+    return VK_TRUE;
+}
@@ -0,0 +1,76 @@
+#include <string.h>
+
+#include "Windows.h"
+
+#include "config.h"
+#include "process.h"
+#include "util.h"
+
+#define MAX_COMMAND_LINE 4096
+
+VkBool32 vkstats_process_run_self(const char* const* arguments, uint32_t argument_count, int* exit_code)
+{
+    char command_line[MAX_COMMAND_LINE];
+    size_t length;
+    STARTUPINFOA startup_info = { 0 };
+    PROCESS_INFORMATION process_information = { 0 };
+    DWORD code;
+
+    if (argument_count > MAX_PROCESS_ARGUMENTS)
+    {
+        fatal_error("Too many process arguments!");
+    }
+
+    /*
+    * The command line is the quoted executable path followed by the quoted
+    * arguments. None of the arguments contain quotes.
+    */
+    command_line[0] = '"';
+    length = GetModuleFileNameA(NULL, command_line + 1, MAX_PATH);
+
+    if (length == 0 || length >= MAX_PATH)
+    {
+        return VK_FALSE;
+    }
+
+    length++;
+    command_line[length++] = '"';
+
+    for (uint32_t i = 0; i < argument_count; i++)
+    {
+        size_t argument_length = strlen(arguments[i]);
+
+        if (length + argument_length + 4 > MAX_COMMAND_LINE)
+        {
+            fatal_error("Process command line is too long!");
+        }
+
+        command_line[length++] = ' ';
+        command_line[length++] = '"';
+        memcpy(command_line + length, arguments[i], argument_length);
+        length += argument_length;
+        command_line[length++] = '"';
+    }
+
+    command_line[length] = '\0';
+    startup_info.cb = sizeof(startup_info);
+
+    if (!CreateProcessA(NULL, command_line, NULL, NULL, FALSE, 0, NULL, NULL, &startup_info, &process_information))
+    {
+        return VK_FALSE;
+    }
+
+    WaitForSingleObject(process_information.hProcess, INFINITE);
+
+    if (!GetExitCodeProcess(process_information.hProcess, &code))
+    {
+        fatal_error("Could not get process exit code!");
+    }
+
+    CloseHandle(process_information.hThread);
+    CloseHandle(process_information.hProcess);
+
+    *exit_code = (int)code;
+
+    return VK_TRUE;
+}
@@ -0,0 +1,138 @@
+#include "vulkan/vulkan.h"
+
+#include "device.h"
+#include "util.h"
+#include "stopwatch.h"
+#include "queue_timer.h"
+#include "calibration.h"
+#include "trace.h"
+
+void vkstats_queue_timer_init(vkstats_queue_timer* timer, vkstats_device* device, uint32_t queue_index)
+{
+    VkResult result;
+
+    clear_struct(timer);
+    timer->device = device;
+    timer->queue_index = queue_index;
+    timer->command_buffer = vkstats_device_allocate_command_buffer(device, queue_index);
+    timer->semaphore = vkstats_device_create_timeline_semaphore(device);
+    timer->metric_count = 1;
+    vkstats_stopwatch_init(&timer->stopwatch);
+
+    /*
+    * Queue families without valid timestamp bits can't write timestamps, so
+    * only the host time is reported for those.
+    */
+    if (device->queue_family_properties[queue_index].timestampValidBits > 0)
+    {
+        VkQueryPoolCreateInfo qp_ci = { 0 };
+        qp_ci.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        qp_ci.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        qp_ci.queryCount = 2;
+        result = vkCreateQueryPool(device->device, &qp_ci, NULL, &timer->query_pool);
+        check_result(result, "Could not create query pool!");
+
+        timer->metric_count = 2;
+    }
+
+    vkstats_calibration_init(&timer->calibration, device, queue_index);
+}
+
+void vkstats_queue_timer_begin(vkstats_queue_timer* timer)
+{
+    /*
+    * The command buffer is submitted once per trial, so it can't be
+    * one-time-submit.
+    */
+    VkCommandBufferBeginInfo cb_bi = { 0 };
+    cb_bi.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    vkBeginCommandBuffer(timer->command_buffer, &cb_bi);
+
+    if (timer->query_pool != VK_NULL_HANDLE)
+    {
+        vkCmdResetQueryPool(timer->command_buffer, timer->query_pool, 0, 2);
+        vkCmdWriteTimestamp(timer->command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timer->query_pool, 0);
+    }
+}
+
+void vkstats_queue_timer_end(vkstats_queue_timer* timer)
+{
+    if (timer->query_pool != VK_NULL_HANDLE)
+    {
+        vkCmdWriteTimestamp(timer->command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timer->query_pool, 1);
+    }
+
+    vkEndCommandBuffer(timer->command_buffer);
+}
+
+void vkstats_queue_timer_run(void* context, double* results)
+{
+    VkResult result;
+    vkstats_queue_timer* timer = context;
+    vkstats_device* device = timer->device;
+    VkBool32 trace_queue = vkstats_trace_is_enabled() && timer->calibration.supported;
+    uint64_t submit_ticks;
+
+    timer->semaphore_value++;
+
+    VkTimelineSemaphoreSubmitInfo ts_si = { 0 };
+    ts_si.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    ts_si.pSignalSemaphoreValues = &timer->semaphore_value;
+    ts_si.signalSemaphoreValueCount = 1;
+
+    VkSubmitInfo si = { 0 };
+    si.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    si.pNext = &ts_si;
+    si.pCommandBuffers = &timer->command_buffer;
+    si.commandBufferCount = 1;
+    si.pSignalSemaphores = &timer->semaphore;
+    si.signalSemaphoreCount = 1;
+
+    vkDeviceWaitIdle(device->device);
+
+    /*
+    * Placing the commands on the trace needs a fresh calibration, which
+    * isn't worth taking when nothing is traced.
+    */
+    if (trace_queue)
+    {
+        vkstats_calibration_update(&timer->calibration);
+    }
+
+    vkstats_stopwatch_start(&timer->stopwatch);
+    submit_ticks = vkstats_stopwatch_get_ticks();
+    result = vkQueueSubmit(device->queues[timer->queue_index], 1, &si, VK_NULL_HANDLE);
+    vkstats_trace_host_event("submit", "vkQueueSubmit", submit_ticks, vkstats_stopwatch_get_ticks(), 1);
+    check_result(result, "Could not submit queue!");
+    vkstats_device_wait_semaphore(device, timer->semaphore, timer->semaphore_value);
+    results[VKSTATS_QUEUE_TIMER_HOST] = vkstats_stopwatch_stop(&timer->stopwatch);
+
+    if (timer->query_pool != VK_NULL_HANDLE)
+    {
+        uint64_t timestamps[2];
+        result = vkGetQueryPoolResults(device->device, timer->query_pool, 0, 2, sizeof(timestamps), timestamps, sizeof(timestamps[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+        check_result(result, "Could not get query pool results!");
+
+        results[VKSTATS_QUEUE_TIMER_DEVICE] = vkstats_device_get_timestamp_elapsed(device, timer->queue_index, timestamps);
+
+        if (trace_queue)
+        {
+            vkstats_trace_queue_event("commands",
+                device->queues[timer->queue_index],
+                vkstats_calibration_get_host_ticks(&timer->calibration, timestamps[0]),
+                vkstats_calibration_get_host_ticks(&timer->calibration, timestamps[1]),
+                0);
+        }
+    }
+}
+
+void vkstats_queue_timer_destroy(vkstats_queue_timer* timer)
+{
+    if (timer->query_pool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(timer->device->device, timer->query_pool, NULL);
+    }
+
+    vkFreeCommandBuffers(timer->device->device, timer->device->command_pools[timer->queue_index], 1, &timer->command_buffer);
+    vkDestroySemaphore(timer->device->device, timer->semaphore, NULL);
+}
@@ -0,0 +1,88 @@
+#if !defined(VKSTATS_QUEUE_TIMER_H)
+#define VKSTATS_QUEUE_TIMER_H
+
+#include <stdint.h>
+
+#include "vulkan/vulkan.h"
+
+#include "device.h"
+#include "stopwatch.h"
+#include "calibration.h"
+
+/*
+* Metrics reported by vkstats_queue_timer_run(). The device time is only
+* reported when the queue supports timestamps.
+*/
+#define VKSTATS_QUEUE_TIMER_HOST 0
+#define VKSTATS_QUEUE_TIMER_DEVICE 1
+
+/*
+* Times a command buffer on a queue. Commands recorded between begin and end
+* are bracketed with timestamps if the queue supports them, and every run
+* submits the command buffer and waits for it on the host.
+*/
+typedef struct
+{
+    vkstats_device*         device;
+    uint32_t                queue_index;
+    VkCommandBuffer         command_buffer;
+    VkSemaphore             semaphore;
+    uint64_t                semaphore_value;
+    VkQueryPool             query_pool;
+    uint32_t                metric_count;
+    vkstats_stopwatch       stopwatch;
+    vkstats_calibration     calibration;
+} vkstats_queue_timer;
+
+/*
+* vkstats_queue_timer_init()
+*
+* Initialize a queue timer.
+*
+* timer: the timer to initialize.
+* device: the device to time on.
+* queue_index: the index of the queue in the device to time on.
+*/
+void vkstats_queue_timer_init(vkstats_queue_timer* timer, vkstats_device* device, uint32_t queue_index);
+
+/*
+* vkstats_queue_timer_begin()
+*
+* Begins recording the timer's command buffer. The commands to time should be
+* recorded into timer->command_buffer after this.
+*
+* timer: the timer to record.
+*/
+void vkstats_queue_timer_begin(vkstats_queue_timer* timer);
+
+/*
+* vkstats_queue_timer_end()
+*
+* Ends recording the timer's command buffer.
+*
+* timer: the timer to record.
+*/
+void vkstats_queue_timer_end(vkstats_queue_timer* timer);
+
+/*
+* vkstats_queue_timer_run()
+*
+* A vkstats_trial_function that submits the recorded command buffer and waits
+* for it. Run it with timer->metric_count metrics.
+*
+* context: a vkstats_queue_timer.
+* results: the host time from submission to completion, and the device time
+*          between the timestamps if the queue supports them.
+*/
+void vkstats_queue_timer_run(void* context, double* results);
+
+/*
+* vkstats_queue_timer_destroy()
+*
+* Destroys a queue timer.
+*
+* timer: the timer to destroy.
+*/
+void vkstats_queue_timer_destroy(vkstats_queue_timer* timer);
+
+#endif
\ No newline at end of file
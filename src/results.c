@@ -0,0 +1,573 @@
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "harness.h"
+#include "thread.h"
+#include "results.h"
+#include "util.h"
+
+/*
+* A result regresses if its median time gets worse than the baseline by more
+* than REGRESSION_THRESHOLD, and the t statistic of the difference in means
+* exceeds SIGNIFICANCE_THRESHOLD. A t of 3 is roughly 99% confidence at the
+* default trial count.
+*/
+#define REGRESSION_THRESHOLD 0.05
+#define SIGNIFICANCE_THRESHOLD 3.0
+
+#define MAX_LINE_LENGTH 2048
+
+static void write_json_string(FILE* file, const char* text);
+static void write_json_index(FILE* file, uint32_t index);
+static void write_csv_string(FILE* file, const char* text);
+static void write_csv_index(FILE* file, uint32_t index);
+static const char* find_json_field(const char* line, const char* key);
+static void read_json_string(const char* line, const char* key, char* text, size_t text_size);
+static VkBool32 read_json_number(const char* line, const char* key, double* value);
+static VkBool32 read_json_index(const char* line, const char* key, uint32_t none, uint32_t* index);
+static VkBool32 read_json_result(const char* line, vkstats_result* result);
+static const vkstats_result* find_result(vkstats_results* results, const vkstats_result* baseline);
+static VkBool32 is_regression(const vkstats_statistics* baseline, const vkstats_statistics* current);
+
+void vkstats_results_init(vkstats_results* results)
+{
+    clear_struct(results);
+    vkstats_mutex_init(&results->mutex);
+}
+
+void vkstats_results_open_json(vkstats_results* results, const char* path)
+{
+    results->json_file = fopen(path, "w");
+
+    if (results->json_file == NULL)
+    {
+        fatal_error("Could not create JSON results file!");
+    }
+
+    fprintf(results->json_file, "[\n");
+}
+
+void vkstats_results_open_csv(vkstats_results* results, const char* path)
+{
+    results->csv_file = fopen(path, "w");
+
+    if (results->csv_file == NULL)
+    {
+        fatal_error("Could not create CSV results file!");
+    }
+
+    fprintf(results->csv_file, "experiment,label,device,vendor_id,device_id,driver_version,queue_index,queue_family,source_memory_type,destination_memory_type,bytes,count,rejected,min_ms,max_ms,mean_ms,median_ms,p95_ms,p99_ms,stddev_ms,median_gbps\n");
+}
+
+void vkstats_results_add(vkstats_results* results, const vkstats_result* result)
+{
+    const vkstats_statistics* statistics = &result->statistics;
+
+    vkstats_mutex_lock(&results->mutex);
+
+    if (results->record_count == results->record_capacity)
+    {
+        results->record_capacity = results->record_capacity > 0 ? results->record_capacity * 2 : 256;
+        results->records = realloc(results->records, results->record_capacity * sizeof(results->records[0]));
+
+        if (results->records == NULL)
+        {
+            fatal_error("Could not allocate results!");
+        }
+    }
+
+    results->records[results->record_count] = *result;
+    results->record_count++;
+
+    /*
+    * Every record is flushed, so a run that aborts still leaves what it
+    * measured behind.
+    */
+    if (results->json_file != NULL)
+    {
+        FILE* file = results->json_file;
+
+        fprintf(file, "%s{\"experiment\": ", results->json_count > 0 ? ",\n" : "");
+        write_json_string(file, result->experiment);
+        fprintf(file, ", \"label\": ");
+        write_json_string(file, result->label);
+        fprintf(file, ", \"device\": ");
+        write_json_string(file, result->device_name);
+        fprintf(file, ", \"vendor_id\": %u, \"device_id\": %u, \"driver_version\": %u", result->vendor_id, result->device_id, result->driver_version);
+        fprintf(file, ", \"queue_index\": ");
+        write_json_index(file, result->queue_index);
+        fprintf(file, ", \"queue_family\": ");
+        write_json_index(file, result->queue_family);
+        fprintf(file, ", \"source_memory_type\": ");
+        write_json_index(file, result->source_memory_type);
+        fprintf(file, ", \"destination_memory_type\": ");
+        write_json_index(file, result->destination_memory_type);
+        fprintf(file, ", \"bytes\": %" PRIu64, result->bytes);
+        fprintf(file, ", \"count\": %u, \"rejected\": %u", statistics->count, statistics->rejected_count);
+        fprintf(file, ", \"min_ms\": %.9g, \"max_ms\": %.9g, \"mean_ms\": %.9g, \"median_ms\": %.9g", statistics->min, statistics->max, statistics->mean, statistics->median);
+        fprintf(file, ", \"p95_ms\": %.9g, \"p99_ms\": %.9g, \"stddev_ms\": %.9g", statistics->p95, statistics->p99, statistics->stddev);
+
+        if (result->bytes > 0)
+        {
+            fprintf(file, ", \"median_gbps\": %.9g", vkstats_get_bandwidth(result->bytes, statistics->median));
+        }
+
+        fprintf(file, "}");
+        fflush(file);
+        results->json_count++;
+    }
+
+    if (results->csv_file != NULL)
+    {
+        FILE* file = results->csv_file;
+
+        write_csv_string(file, result->experiment);
+        fprintf(file, ",");
+        write_csv_string(file, result->label);
+        fprintf(file, ",");
+        write_csv_string(file, result->device_name);
+        fprintf(file, ",%u,%u,%u,", result->vendor_id, result->device_id, result->driver_version);
+        write_csv_index(file, result->queue_index);
+        fprintf(file, ",");
+        write_csv_index(file, result->queue_family);
+        fprintf(file, ",");
+        write_csv_index(file, result->source_memory_type);
+        fprintf(file, ",");
+        write_csv_index(file, result->destination_memory_type);
+        fprintf(file, ",%" PRIu64 ",%u,%u", result->bytes, statistics->count, statistics->rejected_count);
+        fprintf(file, ",%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,", statistics->min, statistics->max, statistics->mean, statistics->median, statistics->p95, statistics->p99, statistics->stddev);
+
+        if (result->bytes > 0)
+        {
+            fprintf(file, "%.9g", vkstats_get_bandwidth(result->bytes, statistics->median));
+        }
+
+        fprintf(file, "\n");
+        fflush(file);
+    }
+
+    vkstats_mutex_unlock(&results->mutex);
+}
+
+uint32_t vkstats_results_compare(vkstats_results* results, const char* path)
+{
+    char line[MAX_LINE_LENGTH];
+    uint32_t compared_count = 0;
+    uint32_t missing_count = 0;
+    uint32_t invalid_count = 0;
+    uint32_t regression_count = 0;
+    FILE* file = fopen(path, "r");
+
+    if (file == NULL)
+    {
+        fatal_error("Could not open baseline results file!");
+    }
+
+    printf("\n");
+    printf("Comparing against baseline %s.\n", path);
+
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        vkstats_result baseline;
+
+        if (line[0] != '{')
+        {
+            continue;
+        }
+
+        /*
+        * Records with missing or unreadable fields can't be compared, so they
+        * are skipped rather than compared against garbage.
+        */
+        if (!read_json_result(line, &baseline))
+        {
+            invalid_count++;
+            continue;
+        }
+
+        const vkstats_result* current = find_result(results, &baseline);
+
+        if (current == NULL)
+        {
+            missing_count++;
+            continue;
+        }
+
+        compared_count++;
+
+        if (!is_regression(&baseline.statistics, &current->statistics))
+        {
+            continue;
+        }
+
+        regression_count++;
+
+        if (current->bytes > 0)
+        {
+            double baseline_bandwidth = vkstats_get_bandwidth(baseline.bytes, baseline.statistics.median);
+            double current_bandwidth = vkstats_get_bandwidth(current->bytes, current->statistics.median);
+
+            printf("Regression: %s: %s: median %.2f GB/s -> %.2f GB/s (%+.1f%%)\n",
+                current->experiment,
+                current->label,
+                baseline_bandwidth,
+                current_bandwidth,
+                (current_bandwidth / baseline_bandwidth - 1.0) * 100.0);
+        }
+        else
+        {
+            printf("Regression: %s: %s: median %.3f ms -> %.3f ms (%+.1f%%)\n",
+                current->experiment,
+                current->label,
+                baseline.statistics.median,
+                current->statistics.median,
+                (current->statistics.median / baseline.statistics.median - 1.0) * 100.0);
+        }
+    }
+
+    fclose(file);
+
+    printf("Compared %u results, %u regressions, %u missing from this run, %u invalid in the baseline.\n", compared_count, regression_count, missing_count, invalid_count);
+
+    return regression_count;
+}
+
+void vkstats_results_destroy(vkstats_results* results)
+{
+    if (results->json_file != NULL)
+    {
+        fprintf(results->json_file, "\n]\n");
+        fclose(results->json_file);
+    }
+
+    if (results->csv_file != NULL)
+    {
+        fclose(results->csv_file);
+    }
+
+    free(results->records);
+    vkstats_mutex_destroy(&results->mutex);
+}
+
+/*
+* write_json_string()
+*
+* Writes a quoted JSON string. Control characters are replaced with spaces,
+* so every record stays on one line.
+*
+* file: the file to write to.
+* text: the string to write.
+*/
+static void write_json_string(FILE* file, const char* text)
+{
+    fputc('"', file);
+
+    for (const char* c = text; *c != '\0'; c++)
+    {
+        if (*c == '"' || *c == '\\')
+        {
+            fputc('\\', file);
+            fputc(*c, file);
+        }
+        else if ((unsigned char)*c < 0x20)
+        {
+            fputc(' ', file);
+        }
+        else
+        {
+            fputc(*c, file);
+        }
+    }
+
+    fputc('"', file);
+}
+
+/*
+* write_json_index()
+*
+* Writes a queue or memory type index, or null for VKSTATS_NO_QUEUE and
+* VKSTATS_NO_MEMORY_TYPE.
+*
+* file: the file to write to.
+* index: the index to write.
+*/
+static void write_json_index(FILE* file, uint32_t index)
+{
+    if (index == UINT32_MAX)
+    {
+        fprintf(file, "null");
+    }
+    else
+    {
+        fprintf(file, "%u", index);
+    }
+}
+
+/*
+* write_csv_string()
+*
+* Writes a quoted CSV field.
+*
+* file: the file to write to.
+* text: the string to write.
+*/
+static void write_csv_string(FILE* file, const char* text)
+{
+    fputc('"', file);
+
+    for (const char* c = text; *c != '\0'; c++)
+    {
+        if (*c == '"')
+        {
+            fputc('"', file);
+        }
+
+        fputc(*c, file);
+    }
+
+    fputc('"', file);
+}
+
+/*
+* write_csv_index()
+*
+* Writes a queue or memory type index, or an empty field for VKSTATS_NO_QUEUE
+* and VKSTATS_NO_MEMORY_TYPE.
+*
+* file: the file to write to.
+* index: the index to write.
+*/
+static void write_csv_index(FILE* file, uint32_t index)
+{
+    if (index != UINT32_MAX)
+    {
+        fprintf(file, "%u", index);
+    }
+}
+
+/*
+* find_json_field()
+*
+* Finds a field in a JSON record written by vkstats_results_add(). This is
+* not a general JSON parser: it relies on every record being a flat object on
+* one line, with string values that never contain the text of a key.
+*
+* line: the record.
+* key: the field name.
+*
+* Returns a pointer to the start of the value, or NULL if the field is
+* missing.
+*/
+static const char* find_json_field(const char* line, const char* key)
+{
+    char pattern[64];
+    const char* value;
+
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+    value = strstr(line, pattern);
+
+    return value != NULL ? value + strlen(pattern) : NULL;
+}
+
+/*
+* read_json_string()
+*
+* Reads a string field from a JSON record. Missing fields read as empty.
+*
+* line: the record.
+* key: the field name.
+* text: the string will be placed here.
+* text_size: the size of the text buffer.
+*/
+static void read_json_string(const char* line, const char* key, char* text, size_t text_size)
+{
+    const char* c = find_json_field(line, key);
+    size_t length = 0;
+
+    if (c != NULL && *c == '"')
+    {
+        for (c++; *c != '\0' && *c != '"'; c++)
+        {
+            if (*c == '\\' && c[1] != '\0')
+            {
+                c++;
+            }
+
+            if (length + 1 < text_size)
+            {
+                text[length] = *c;
+                length++;
+            }
+        }
+    }
+
+    text[length] = '\0';
+}
+
+/*
+* read_json_number()
+*
+* Reads a numeric field from a JSON record.
+*
+* line: the record.
+* key: the field name.
+* value: the value will be placed here.
+*
+* Returns VK_FALSE if the field is missing, null or not a number.
+*/
+static VkBool32 read_json_number(const char* line, const char* key, double* value)
+{
+    const char* field = find_json_field(line, key);
+    char* end;
+
+    if (field == NULL)
+    {
+        return VK_FALSE;
+    }
+
+    *value = strtod(field, &end);
+
+    return end != field;
+}
+
+/*
+* read_json_index()
+*
+* Reads an index field from a JSON record, where null stands for no index.
+*
+* line: the record.
+* key: the field name.
+* none: the index to use for null.
+* index: the index will be placed here.
+*
+* Returns VK_FALSE if the field is missing or not a valid index.
+*/
+static VkBool32 read_json_index(const char* line, const char* key, uint32_t none, uint32_t* index)
+{
+    const char* field = find_json_field(line, key);
+    double value;
+
+    if (field != NULL && strncmp(field, "null", 4) == 0)
+    {
+        *index = none;
+        return VK_TRUE;
+    }
+
+    if (!read_json_number(line, key, &value) || value < 0.0 || value >= (double)UINT32_MAX)
+    {
+        return VK_FALSE;
+    }
+
+    *index = (uint32_t)value;
+
+    return VK_TRUE;
+}
+
+/*
+* read_json_result()
+*
+* Reads the fields of a result that comparisons need from a JSON record.
+*
+* line: the record.
+* result: the result will be placed here.
+*
+* Returns VK_FALSE if a field is missing or out of range.
+*/
+static VkBool32 read_json_result(const char* line, vkstats_result* result)
+{
+    double bytes;
+    double count;
+
+    clear_struct(result);
+    read_json_string(line, "experiment", result->experiment, sizeof(result->experiment));
+    read_json_string(line, "label", result->label, sizeof(result->label));
+    read_json_string(line, "device", result->device_name, sizeof(result->device_name));
+
+    if (!read_json_index(line, "queue_index", VKSTATS_NO_QUEUE, &result->queue_index) ||
+        !read_json_index(line, "source_memory_type", VKSTATS_NO_MEMORY_TYPE, &result->source_memory_type) ||
+        !read_json_index(line, "destination_memory_type", VKSTATS_NO_MEMORY_TYPE, &result->destination_memory_type) ||
+        !read_json_number(line, "bytes", &bytes) ||
+        !read_json_number(line, "count", &count) ||
+        !read_json_number(line, "mean_ms", &result->statistics.mean) ||
+        !read_json_number(line, "median_ms", &result->statistics.median) ||
+        !read_json_number(line, "stddev_ms", &result->statistics.stddev))
+    {
+        return VK_FALSE;
+    }
+
+    if (bytes < 0.0 || bytes >= (double)UINT64_MAX || count < 0.0 || count > (double)MAX_TRIALS)
+    {
+        return VK_FALSE;
+    }
+
+    result->bytes = (uint64_t)bytes;
+    result->statistics.count = (uint32_t)count;
+
+    return VK_TRUE;
+}
+
+/*
+* find_result()
+*
+* Finds the result of this run that matches a baseline result.
+*
+* results: the results of this run.
+* baseline: the baseline result.
+*
+* Returns the matching result, or NULL if there is none.
+*/
+static const vkstats_result* find_result(vkstats_results* results, const vkstats_result* baseline)
+{
+    for (uint32_t i = 0; i < results->record_count; i++)
+    {
+        const vkstats_result* result = &results->records[i];
+
+        if (result->queue_index == baseline->queue_index
+            && strcmp(result->device_name, baseline->device_name) == 0
+            && result->source_memory_type == baseline->source_memory_type
+            && result->destination_memory_type == baseline->destination_memory_type
+            && strcmp(result->experiment, baseline->experiment) == 0
+            && strcmp(result->label, baseline->label) == 0)
+        {
+            return result;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+* is_regression()
+*
+* Decides whether a result got significantly slower than its baseline.
+*
+* baseline: the baseline time statistics.
+* current: the time statistics of this run.
+*
+* Returns VK_TRUE if the result regressed.
+*/
+static VkBool32 is_regression(const vkstats_statistics* baseline, const vkstats_statistics* current)
+{
+    double variance;
+
+    if (current->median <= baseline->median * (1.0 + REGRESSION_THRESHOLD) || baseline->count == 0 || current->count == 0)
+    {
+        return VK_FALSE;
+    }
+
+    /*
+    * Welch's t-test, which doesn't assume the runs have equal variance. With
+    * no variance at all, the difference in medians alone decides.
+    */
+    variance = baseline->stddev * baseline->stddev / baseline->count + current->stddev * current->stddev / current->count;
+
+    if (variance <= 0.0)
+    {
+        return VK_TRUE;
+    }
+
+    return (current->mean - baseline->mean) / sqrt(variance) > SIGNIFICANCE_THRESHOLD;
+}
@@ -0,0 +1,114 @@
+#if !defined(VKSTATS_RESULTS_H)
+#define VKSTATS_RESULTS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "vulkan/vulkan.h"
+
+#include "harness.h"
+#include "thread.h"
+
+/*
+* One measurement, with what it was measured on. The queue and memory types
+* are VKSTATS_NO_QUEUE and VKSTATS_NO_MEMORY_TYPE when they don't apply.
+*/
+typedef struct
+{
+    char                experiment[64];
+    char                label[128];
+    char                device_name[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE];
+    uint32_t            vendor_id;
+    uint32_t            device_id;
+    uint32_t            driver_version;
+    uint32_t            queue_index;
+    uint32_t            queue_family;
+    uint32_t            source_memory_type;
+    uint32_t            destination_memory_type;
+    uint64_t            bytes;
+    vkstats_statistics  statistics;
+} vkstats_result;
+
+/*
+* Collects every result of a run, and writes them to JSON and/or CSV files
+* as they arrive. Safe to add to from several threads.
+*/
+typedef struct vkstats_results
+{
+    FILE*               json_file;
+    FILE*               csv_file;
+    uint32_t            json_count;
+    vkstats_result*     records;
+    uint32_t            record_count;
+    uint32_t            record_capacity;
+    vkstats_mutex       mutex;
+} vkstats_results;
+
+/*
+* vkstats_results_init()
+*
+* Initialize an empty results sink that writes no files.
+*
+* results: the results to initialize.
+*/
+void vkstats_results_init(vkstats_results* results);
+
+/*
+* vkstats_results_open_json()
+*
+* Starts writing results to a JSON file, as an array with one record per
+* line. Aborts the application if the file can't be created.
+*
+* results: the results to write.
+* path: the file to write.
+*/
+void vkstats_results_open_json(vkstats_results* results, const char* path);
+
+/*
+* vkstats_results_open_csv()
+*
+* Starts writing results to a CSV file with a header row. Aborts the
+* application if the file can't be created.
+*
+* results: the results to write.
+* path: the file to write.
+*/
+void vkstats_results_open_csv(vkstats_results* results, const char* path);
+
+/*
+* vkstats_results_add()
+*
+* Adds a result, writing it to any open files.
+*
+* results: the results to add to.
+* result: the result to add.
+*/
+void vkstats_results_add(vkstats_results* results, const vkstats_result* result);
+
+/*
+* vkstats_results_compare()
+*
+* Compares the results against a baseline written with
+* vkstats_results_open_json(), and prints every regression. A result has
+* regressed if its median time is more than 5% worse than the baseline and a
+* Welch's t-test on the means says the difference is significant. Results
+* are matched by experiment, device name, queue, memory types and label.
+* Aborts the application if the baseline can't be read.
+*
+* results: the results of this run.
+* path: the baseline JSON file.
+*
+* Returns the number of regressions.
+*/
+uint32_t vkstats_results_compare(vkstats_results* results, const char* path);
+
+/*
+* vkstats_results_destroy()
+*
+* Finishes and closes any open files and frees the results.
+*
+* results: the results to destroy.
+*/
+void vkstats_results_destroy(vkstats_results* results);
+
+#endif
\ No newline at end of file
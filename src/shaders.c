@@ -0,0 +1,238 @@
+#include <stdint.h>
+
+#include "shaders.h"
+
+/*
+* The compute bandwidth kernels. Each is one of the following GLSL shaders,
+* assembled to SPIR-V 1.0 and embedded so vkstats has no shader compiler
+* dependency:
+*
+*     #version 450
+*
+*     layout(local_size_x_id = 0) in;
+*
+*     layout(set = 0, binding = 0) buffer Source { uvec4 source[]; };
+*     layout(set = 0, binding = 1) buffer Destination { uvec4 destination[]; };
+*
+*     layout(push_constant) uniform Parameters
+*     {
+*         uint count;
+*         uint row_length;
+*         uint magic;
+*     };
+*
+*     void main()
+*     {
+*         uint i = gl_GlobalInvocationID.y * row_length + gl_GlobalInvocationID.x;
+*
+*         if (i < count)
+*         {
+*             KERNEL
+*         }
+*     }
+*
+* with KERNEL replaced by the body given above each array. Dispatches are two
+* dimensional because a single row of workgroups can't cover the largest
+* buffers, and row_length is the number of invocations in one row.
+*/
+
+/*
+* KERNEL:
+*
+*     uvec4 value = source[i];
+*
+*     // Never true in practice, but keeps the load alive.
+*     if ((value.x ^ value.y ^ value.z ^ value.w) == magic)
+*     {
+*         destination[i] = value;
+*     }
+*/
+const uint32_t vkstats_shader_read[] =
+{
+    0x07230203, 0x00010000, 0x00000000, 0x0000003b, 0x00000000, 0x00020011, 0x00000001, 0x0003000e,
+    0x00000000, 0x00000001, 0x0006000f, 0x00000005, 0x00000001, 0x6e69616d, 0x00000000, 0x00000002,
+    0x00060010, 0x00000001, 0x00000011, 0x00000001, 0x00000001, 0x00000001, 0x00040047, 0x00000002,
+    0x0000000b, 0x0000001c, 0x00040047, 0x00000003, 0x00000001, 0x00000000, 0x00040047, 0x00000004,
+    0x0000000b, 0x00000019, 0x00040047, 0x00000005, 0x00000006, 0x00000010, 0x00050048, 0x00000006,
+    0x00000000, 0x00000023, 0x00000000, 0x00030047, 0x00000006, 0x00000003, 0x00040047, 0x00000007,
+    0x00000022, 0x00000000, 0x00040047, 0x00000007, 0x00000021, 0x00000000, 0x00040047, 0x00000008,
+    0x00000022, 0x00000000, 0x00040047, 0x00000008, 0x00000021, 0x00000001, 0x00050048, 0x00000009,
+    0x00000000, 0x00000023, 0x00000000, 0x00050048, 0x00000009, 0x00000001, 0x00000023, 0x00000004,
+    0x00050048, 0x00000009, 0x00000002, 0x00000023, 0x00000008, 0x00030047, 0x00000009, 0x00000002,
+    0x00020013, 0x0000000a, 0x00030021, 0x0000000b, 0x0000000a, 0x00020014, 0x0000000c, 0x00040015,
+    0x0000000d, 0x00000020, 0x00000000, 0x00040015, 0x0000000e, 0x00000020, 0x00000001, 0x00040017,
+    0x0000000f, 0x0000000d, 0x00000003, 0x00040017, 0x00000010, 0x0000000d, 0x00000004, 0x0003001d,
+    0x00000005, 0x00000010, 0x0003001e, 0x00000006, 0x00000005, 0x00040020, 0x00000011, 0x00000002,
+    0x00000006, 0x00040020, 0x00000012, 0x00000002, 0x00000010, 0x00040020, 0x00000013, 0x00000001,
+    0x0000000f, 0x00040020, 0x00000014, 0x00000001, 0x0000000d, 0x0005001e, 0x00000009, 0x0000000d,
+    0x0000000d, 0x0000000d, 0x00040020, 0x00000015, 0x00000009, 0x00000009, 0x00040020, 0x00000016,
+    0x00000009, 0x0000000d, 0x0004002b, 0x0000000d, 0x00000017, 0x00000000, 0x0004002b, 0x0000000d,
+    0x00000018, 0x00000001, 0x0004002b, 0x0000000e, 0x00000019, 0x00000000, 0x0004002b, 0x0000000e,
+    0x0000001a, 0x00000001, 0x0004002b, 0x0000000e, 0x0000001b, 0x00000002, 0x0007002c, 0x00000010,
+    0x0000001c, 0x00000018, 0x00000018, 0x00000018, 0x00000018, 0x00040032, 0x0000000d, 0x00000003,
+    0x00000040, 0x00060033, 0x0000000f, 0x00000004, 0x00000003, 0x00000018, 0x00000018, 0x0004003b,
+    0x00000013, 0x00000002, 0x00000001, 0x0004003b, 0x00000011, 0x00000007, 0x00000002, 0x0004003b,
+    0x00000011, 0x00000008, 0x00000002, 0x0004003b, 0x00000015, 0x0000001d, 0x00000009, 0x00050036,
+    0x0000000a, 0x00000001, 0x00000000, 0x0000000b, 0x000200f8, 0x0000001e, 0x00050041, 0x00000014,
+    0x0000001f, 0x00000002, 0x00000017, 0x0004003d, 0x0000000d, 0x00000020, 0x0000001f, 0x00050041,
+    0x00000014, 0x00000021, 0x00000002, 0x00000018, 0x0004003d, 0x0000000d, 0x00000022, 0x00000021,
+    0x00050041, 0x00000016, 0x00000023, 0x0000001d, 0x0000001a, 0x0004003d, 0x0000000d, 0x00000024,
+    0x00000023, 0x00050084, 0x0000000d, 0x00000025, 0x00000022, 0x00000024, 0x00050080, 0x0000000d,
+    0x00000026, 0x00000025, 0x00000020, 0x00050041, 0x00000016, 0x00000027, 0x0000001d, 0x00000019,
+    0x0004003d, 0x0000000d, 0x00000028, 0x00000027, 0x000500b0, 0x0000000c, 0x00000029, 0x00000026,
+    0x00000028, 0x000300f7, 0x0000002a, 0x00000000, 0x000400fa, 0x00000029, 0x0000002b, 0x0000002a,
+    0x000200f8, 0x0000002b, 0x00060041, 0x00000012, 0x0000002c, 0x00000007, 0x00000019, 0x00000026,
+    0x0004003d, 0x00000010, 0x0000002d, 0x0000002c, 0x00050051, 0x0000000d, 0x0000002e, 0x0000002d,
+    0x00000000, 0x00050051, 0x0000000d, 0x0000002f, 0x0000002d, 0x00000001, 0x00050051, 0x0000000d,
+    0x00000030, 0x0000002d, 0x00000002, 0x00050051, 0x0000000d, 0x00000031, 0x0000002d, 0x00000003,
+    0x000500c6, 0x0000000d, 0x00000032, 0x0000002e, 0x0000002f, 0x000500c6, 0x0000000d, 0x00000033,
+    0x00000032, 0x00000030, 0x000500c6, 0x0000000d, 0x00000034, 0x00000033, 0x00000031, 0x00050041,
+    0x00000016, 0x00000035, 0x0000001d, 0x0000001b, 0x0004003d, 0x0000000d, 0x00000036, 0x00000035,
+    0x000500aa, 0x0000000c, 0x00000037, 0x00000034, 0x00000036, 0x000300f7, 0x00000038, 0x00000000,
+    0x000400fa, 0x00000037, 0x00000039, 0x00000038, 0x000200f8, 0x00000039, 0x00060041, 0x00000012,
+    0x0000003a, 0x00000008, 0x00000019, 0x00000026, 0x0003003e, 0x0000003a, 0x0000002d, 0x000200f9,
+    0x00000038, 0x000200f8, 0x00000038, 0x000200f9, 0x0000002a, 0x000200f8, 0x0000002a, 0x000100fd,
+    0x00010038,
+};
+
+const size_t vkstats_shader_read_size = sizeof(vkstats_shader_read);
+
+/*
+* KERNEL:
+*
+*     destination[i] = uvec4(i);
+*/
+const uint32_t vkstats_shader_write[] =
+{
+    0x07230203, 0x00010000, 0x00000000, 0x0000002e, 0x00000000, 0x00020011, 0x00000001, 0x0003000e,
+    0x00000000, 0x00000001, 0x0006000f, 0x00000005, 0x00000001, 0x6e69616d, 0x00000000, 0x00000002,
+    0x00060010, 0x00000001, 0x00000011, 0x00000001, 0x00000001, 0x00000001, 0x00040047, 0x00000002,
+    0x0000000b, 0x0000001c, 0x00040047, 0x00000003, 0x00000001, 0x00000000, 0x00040047, 0x00000004,
+    0x0000000b, 0x00000019, 0x00040047, 0x00000005, 0x00000006, 0x00000010, 0x00050048, 0x00000006,
+    0x00000000, 0x00000023, 0x00000000, 0x00030047, 0x00000006, 0x00000003, 0x00040047, 0x00000007,
+    0x00000022, 0x00000000, 0x00040047, 0x00000007, 0x00000021, 0x00000000, 0x00040047, 0x00000008,
+    0x00000022, 0x00000000, 0x00040047, 0x00000008, 0x00000021, 0x00000001, 0x00050048, 0x00000009,
+    0x00000000, 0x00000023, 0x00000000, 0x00050048, 0x00000009, 0x00000001, 0x00000023, 0x00000004,
+    0x00050048, 0x00000009, 0x00000002, 0x00000023, 0x00000008, 0x00030047, 0x00000009, 0x00000002,
+    0x00020013, 0x0000000a, 0x00030021, 0x0000000b, 0x0000000a, 0x00020014, 0x0000000c, 0x00040015,
+    0x0000000d, 0x00000020, 0x00000000, 0x00040015, 0x0000000e, 0x00000020, 0x00000001, 0x00040017,
+    0x0000000f, 0x0000000d, 0x00000003, 0x00040017, 0x00000010, 0x0000000d, 0x00000004, 0x0003001d,
+    0x00000005, 0x00000010, 0x0003001e, 0x00000006, 0x00000005, 0x00040020, 0x00000011, 0x00000002,
+    0x00000006, 0x00040020, 0x00000012, 0x00000002, 0x00000010, 0x00040020, 0x00000013, 0x00000001,
+    0x0000000f, 0x00040020, 0x00000014, 0x00000001, 0x0000000d, 0x0005001e, 0x00000009, 0x0000000d,
+    0x0000000d, 0x0000000d, 0x00040020, 0x00000015, 0x00000009, 0x00000009, 0x00040020, 0x00000016,
+    0x00000009, 0x0000000d, 0x0004002b, 0x0000000d, 0x00000017, 0x00000000, 0x0004002b, 0x0000000d,
+    0x00000018, 0x00000001, 0x0004002b, 0x0000000e, 0x00000019, 0x00000000, 0x0004002b, 0x0000000e,
+    0x0000001a, 0x00000001, 0x0004002b, 0x0000000e, 0x0000001b, 0x00000002, 0x0007002c, 0x00000010,
+    0x0000001c, 0x00000018, 0x00000018, 0x00000018, 0x00000018, 0x00040032, 0x0000000d, 0x00000003,
+    0x00000040, 0x00060033, 0x0000000f, 0x00000004, 0x00000003, 0x00000018, 0x00000018, 0x0004003b,
+    0x00000013, 0x00000002, 0x00000001, 0x0004003b, 0x00000011, 0x00000007, 0x00000002, 0x0004003b,
+    0x00000011, 0x00000008, 0x00000002, 0x0004003b, 0x00000015, 0x0000001d, 0x00000009, 0x00050036,
+    0x0000000a, 0x00000001, 0x00000000, 0x0000000b, 0x000200f8, 0x0000001e, 0x00050041, 0x00000014,
+    0x0000001f, 0x00000002, 0x00000017, 0x0004003d, 0x0000000d, 0x00000020, 0x0000001f, 0x00050041,
+    0x00000014, 0x00000021, 0x00000002, 0x00000018, 0x0004003d, 0x0000000d, 0x00000022, 0x00000021,
+    0x00050041, 0x00000016, 0x00000023, 0x0000001d, 0x0000001a, 0x0004003d, 0x0000000d, 0x00000024,
+    0x00000023, 0x00050084, 0x0000000d, 0x00000025, 0x00000022, 0x00000024, 0x00050080, 0x0000000d,
+    0x00000026, 0x00000025, 0x00000020, 0x00050041, 0x00000016, 0x00000027, 0x0000001d, 0x00000019,
+    0x0004003d, 0x0000000d, 0x00000028, 0x00000027, 0x000500b0, 0x0000000c, 0x00000029, 0x00000026,
+    0x00000028, 0x000300f7, 0x0000002a, 0x00000000, 0x000400fa, 0x00000029, 0x0000002b, 0x0000002a,
+    0x000200f8, 0x0000002b, 0x00060041, 0x00000012, 0x0000002c, 0x00000008, 0x00000019, 0x00000026,
+    0x00070050, 0x00000010, 0x0000002d, 0x00000026, 0x00000026, 0x00000026, 0x00000026, 0x0003003e,
+    0x0000002c, 0x0000002d, 0x000200f9, 0x0000002a, 0x000200f8, 0x0000002a, 0x000100fd, 0x00010038,
+};
+
+const size_t vkstats_shader_write_size = sizeof(vkstats_shader_write);
+
+/*
+* KERNEL:
+*
+*     destination[i] = source[i];
+*/
+const uint32_t vkstats_shader_copy[] =
+{
+    0x07230203, 0x00010000, 0x00000000, 0x0000002f, 0x00000000, 0x00020011, 0x00000001, 0x0003000e,
+    0x00000000, 0x00000001, 0x0006000f, 0x00000005, 0x00000001, 0x6e69616d, 0x00000000, 0x00000002,
+    0x00060010, 0x00000001, 0x00000011, 0x00000001, 0x00000001, 0x00000001, 0x00040047, 0x00000002,
+    0x0000000b, 0x0000001c, 0x00040047, 0x00000003, 0x00000001, 0x00000000, 0x00040047, 0x00000004,
+    0x0000000b, 0x00000019, 0x00040047, 0x00000005, 0x00000006, 0x00000010, 0x00050048, 0x00000006,
+    0x00000000, 0x00000023, 0x00000000, 0x00030047, 0x00000006, 0x00000003, 0x00040047, 0x00000007,
+    0x00000022, 0x00000000, 0x00040047, 0x00000007, 0x00000021, 0x00000000, 0x00040047, 0x00000008,
+    0x00000022, 0x00000000, 0x00040047, 0x00000008, 0x00000021, 0x00000001, 0x00050048, 0x00000009,
+    0x00000000, 0x00000023, 0x00000000, 0x00050048, 0x00000009, 0x00000001, 0x00000023, 0x00000004,
+    0x00050048, 0x00000009, 0x00000002, 0x00000023, 0x00000008, 0x00030047, 0x00000009, 0x00000002,
+    0x00020013, 0x0000000a, 0x00030021, 0x0000000b, 0x0000000a, 0x00020014, 0x0000000c, 0x00040015,
+    0x0000000d, 0x00000020, 0x00000000, 0x00040015, 0x0000000e, 0x00000020, 0x00000001, 0x00040017,
+    0x0000000f, 0x0000000d, 0x00000003, 0x00040017, 0x00000010, 0x0000000d, 0x00000004, 0x0003001d,
+    0x00000005, 0x00000010, 0x0003001e, 0x00000006, 0x00000005, 0x00040020, 0x00000011, 0x00000002,
+    0x00000006, 0x00040020, 0x00000012, 0x00000002, 0x00000010, 0x00040020, 0x00000013, 0x00000001,
+    0x0000000f, 0x00040020, 0x00000014, 0x00000001, 0x0000000d, 0x0005001e, 0x00000009, 0x0000000d,
+    0x0000000d, 0x0000000d, 0x00040020, 0x00000015, 0x00000009, 0x00000009, 0x00040020, 0x00000016,
+    0x00000009, 0x0000000d, 0x0004002b, 0x0000000d, 0x00000017, 0x00000000, 0x0004002b, 0x0000000d,
+    0x00000018, 0x00000001, 0x0004002b, 0x0000000e, 0x00000019, 0x00000000, 0x0004002b, 0x0000000e,
+    0x0000001a, 0x00000001, 0x0004002b, 0x0000000e, 0x0000001b, 0x00000002, 0x0007002c, 0x00000010,
+    0x0000001c, 0x00000018, 0x00000018, 0x00000018, 0x00000018, 0x00040032, 0x0000000d, 0x00000003,
+    0x00000040, 0x00060033, 0x0000000f, 0x00000004, 0x00000003, 0x00000018, 0x00000018, 0x0004003b,
+    0x00000013, 0x00000002, 0x00000001, 0x0004003b, 0x00000011, 0x00000007, 0x00000002, 0x0004003b,
+    0x00000011, 0x00000008, 0x00000002, 0x0004003b, 0x00000015, 0x0000001d, 0x00000009, 0x00050036,
+    0x0000000a, 0x00000001, 0x00000000, 0x0000000b, 0x000200f8, 0x0000001e, 0x00050041, 0x00000014,
+    0x0000001f, 0x00000002, 0x00000017, 0x0004003d, 0x0000000d, 0x00000020, 0x0000001f, 0x00050041,
+    0x00000014, 0x00000021, 0x00000002, 0x00000018, 0x0004003d, 0x0000000d, 0x00000022, 0x00000021,
+    0x00050041, 0x00000016, 0x00000023, 0x0000001d, 0x0000001a, 0x0004003d, 0x0000000d, 0x00000024,
+    0x00000023, 0x00050084, 0x0000000d, 0x00000025, 0x00000022, 0x00000024, 0x00050080, 0x0000000d,
+    0x00000026, 0x00000025, 0x00000020, 0x00050041, 0x00000016, 0x00000027, 0x0000001d, 0x00000019,
+    0x0004003d, 0x0000000d, 0x00000028, 0x00000027, 0x000500b0, 0x0000000c, 0x00000029, 0x00000026,
+    0x00000028, 0x000300f7, 0x0000002a, 0x00000000, 0x000400fa, 0x00000029, 0x0000002b, 0x0000002a,
+    0x000200f8, 0x0000002b, 0x00060041, 0x00000012, 0x0000002c, 0x00000007, 0x00000019, 0x00000026,
+    0x0004003d, 0x00000010, 0x0000002d, 0x0000002c, 0x00060041, 0x00000012, 0x0000002e, 0x00000008,
+    0x00000019, 0x00000026, 0x0003003e, 0x0000002e, 0x0000002d, 0x000200f9, 0x0000002a, 0x000200f8,
+    0x0000002a, 0x000100fd, 0x00010038,
+};
+
+const size_t vkstats_shader_copy_size = sizeof(vkstats_shader_copy);
+
+/*
+* KERNEL:
+*
+*     destination[i] += uvec4(1);
+*/
+const uint32_t vkstats_shader_read_modify_write[] =
+{
+    0x07230203, 0x00010000, 0x00000000, 0x0000002f, 0x00000000, 0x00020011, 0x00000001, 0x0003000e,
+    0x00000000, 0x00000001, 0x0006000f, 0x00000005, 0x00000001, 0x6e69616d, 0x00000000, 0x00000002,
+    0x00060010, 0x00000001, 0x00000011, 0x00000001, 0x00000001, 0x00000001, 0x00040047, 0x00000002,
+    0x0000000b, 0x0000001c, 0x00040047, 0x00000003, 0x00000001, 0x00000000, 0x00040047, 0x00000004,
+    0x0000000b, 0x00000019, 0x00040047, 0x00000005, 0x00000006, 0x00000010, 0x00050048, 0x00000006,
+    0x00000000, 0x00000023, 0x00000000, 0x00030047, 0x00000006, 0x00000003, 0x00040047, 0x00000007,
+    0x00000022, 0x00000000, 0x00040047, 0x00000007, 0x00000021, 0x00000000, 0x00040047, 0x00000008,
+    0x00000022, 0x00000000, 0x00040047, 0x00000008, 0x00000021, 0x00000001, 0x00050048, 0x00000009,
+    0x00000000, 0x00000023, 0x00000000, 0x00050048, 0x00000009, 0x00000001, 0x00000023, 0x00000004,
+    0x00050048, 0x00000009, 0x00000002, 0x00000023, 0x00000008, 0x00030047, 0x00000009, 0x00000002,
+    0x00020013, 0x0000000a, 0x00030021, 0x0000000b, 0x0000000a, 0x00020014, 0x0000000c, 0x00040015,
+    0x0000000d, 0x00000020, 0x00000000, 0x00040015, 0x0000000e, 0x00000020, 0x00000001, 0x00040017,
+    0x0000000f, 0x0000000d, 0x00000003, 0x00040017, 0x00000010, 0x0000000d, 0x00000004, 0x0003001d,
+    0x00000005, 0x00000010, 0x0003001e, 0x00000006, 0x00000005, 0x00040020, 0x00000011, 0x00000002,
+    0x00000006, 0x00040020, 0x00000012, 0x00000002, 0x00000010, 0x00040020, 0x00000013, 0x00000001,
+    0x0000000f, 0x00040020, 0x00000014, 0x00000001, 0x0000000d, 0x0005001e, 0x00000009, 0x0000000d,
+    0x0000000d, 0x0000000d, 0x00040020, 0x00000015, 0x00000009, 0x00000009, 0x00040020, 0x00000016,
+    0x00000009, 0x0000000d, 0x0004002b, 0x0000000d, 0x00000017, 0x00000000, 0x0004002b, 0x0000000d,
+    0x00000018, 0x00000001, 0x0004002b, 0x0000000e, 0x00000019, 0x00000000, 0x0004002b, 0x0000000e,
+    0x0000001a, 0x00000001, 0x0004002b, 0x0000000e, 0x0000001b, 0x00000002, 0x0007002c, 0x00000010,
+    0x0000001c, 0x00000018, 0x00000018, 0x00000018, 0x00000018, 0x00040032, 0x0000000d, 0x00000003,
+    0x00000040, 0x00060033, 0x0000000f, 0x00000004, 0x00000003, 0x00000018, 0x00000018, 0x0004003b,
+    0x00000013, 0x00000002, 0x00000001, 0x0004003b, 0x00000011, 0x00000007, 0x00000002, 0x0004003b,
+    0x00000011, 0x00000008, 0x00000002, 0x0004003b, 0x00000015, 0x0000001d, 0x00000009, 0x00050036,
+    0x0000000a, 0x00000001, 0x00000000, 0x0000000b, 0x000200f8, 0x0000001e, 0x00050041, 0x00000014,
+    0x0000001f, 0x00000002, 0x00000017, 0x0004003d, 0x0000000d, 0x00000020, 0x0000001f, 0x00050041,
+    0x00000014, 0x00000021, 0x00000002, 0x00000018, 0x0004003d, 0x0000000d, 0x00000022, 0x00000021,
+    0x00050041, 0x00000016, 0x00000023, 0x0000001d, 0x0000001a, 0x0004003d, 0x0000000d, 0x00000024,
+    0x00000023, 0x00050084, 0x0000000d, 0x00000025, 0x00000022, 0x00000024, 0x00050080, 0x0000000d,
+    0x00000026, 0x00000025, 0x00000020, 0x00050041, 0x00000016, 0x00000027, 0x0000001d, 0x00000019,
+    0x0004003d, 0x0000000d, 0x00000028, 0x00000027, 0x000500b0, 0x0000000c, 0x00000029, 0x00000026,
+    0x00000028, 0x000300f7, 0x0000002a, 0x00000000, 0x000400fa, 0x00000029, 0x0000002b, 0x0000002a,
+    0x000200f8, 0x0000002b, 0x00060041, 0x00000012, 0x0000002c, 0x00000008, 0x00000019, 0x00000026,
+    0x0004003d, 0x00000010, 0x0000002d, 0x0000002c, 0x00050080, 0x00000010, 0x0000002e, 0x0000002d,
+    0x0000001c, 0x0003003e, 0x0000002c, 0x0000002e, 0x000200f9, 0x0000002a, 0x000200f8, 0x0000002a,
+    0x000100fd, 0x00010038,
+};
+
+const size_t vkstats_shader_read_modify_write_size = sizeof(vkstats_shader_read_modify_write);
@@ -0,0 +1,38 @@
+#if !defined(VKSTATS_SHADERS_H)
+#define VKSTATS_SHADERS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+* SPIR-V for the compute bandwidth kernels. All of them take a source buffer
+* at binding 0, a destination buffer at binding 1, both arrays of uvec4, and
+* the count, row_length and magic push constants. The workgroup size is
+* specialization constant 0. See shaders.c for the GLSL.
+*/
+
+/*
+* Reads every element of the source buffer.
+*/
+extern const uint32_t vkstats_shader_read[];
+extern const size_t vkstats_shader_read_size;
+
+/*
+* Writes every element of the destination buffer.
+*/
+extern const uint32_t vkstats_shader_write[];
+extern const size_t vkstats_shader_write_size;
+
+/*
+* Copies the source buffer to the destination buffer.
+*/
+extern const uint32_t vkstats_shader_copy[];
+extern const size_t vkstats_shader_copy_size;
+
+/*
+* Increments every element of the destination buffer in place.
+*/
+extern const uint32_t vkstats_shader_read_modify_write[];
+extern const size_t vkstats_shader_read_modify_write_size;
+
+#endif
\ No newline at end of file
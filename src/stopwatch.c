@@ -1,29 +1,79 @@
-#include "Windows.h"
-
 #include "stopwatch.h"
+#include "harness.h"
 #include "util.h"
 
-void vkstats_stopwatch_init(vkstats_stopwatch* stopwatch)
+#define CALIBRATION_ITERATIONS 1000
+
+/*
+* Measured by vkstats_stopwatch_calibrate() and subtracted from every
+* stopwatch initialized afterwards.
+*/
+static double stopwatch_overhead = 0.0;
+
+void vkstats_stopwatch_calibrate(vkstats_stopwatch_calibration* calibration)
 {
-    LARGE_INTEGER frequency;
+    vkstats_stopwatch stopwatch;
+    vkstats_statistics statistics;
+    double samples[CALIBRATION_ITERATIONS];
+    double frequency = vkstats_stopwatch_get_frequency();
+    uint64_t smallest_step = UINT64_MAX;
+
+    /*
+    * Time an empty interval to find the cost of a start/stop pair. The median
+    * keeps an interrupt during calibration from skewing the result.
+    */
+    stopwatch_overhead = 0.0;
+    vkstats_stopwatch_init(&stopwatch);
+
+    for (uint32_t i = 0; i < CALIBRATION_ITERATIONS; i++)
+    {
+        vkstats_stopwatch_start(&stopwatch);
+        samples[i] = vkstats_stopwatch_stop(&stopwatch);
+    }
+
+    vkstats_statistics_compute(samples, CALIBRATION_ITERATIONS, &statistics);
+
+    /*
+    * The resolution is the smallest step the clock is seen to advance by,
+    * which may be coarser than its nominal frequency.
+    */
+    for (uint32_t i = 0; i < CALIBRATION_ITERATIONS; i++)
+    {
+        uint64_t first = vkstats_stopwatch_get_ticks();
+        uint64_t next = vkstats_stopwatch_get_ticks();
 
+        while (next == first)
+        {
+            next = vkstats_stopwatch_get_ticks();
+        }
+
+        if (next - first < smallest_step)
+        {
+            smallest_step = next - first;
+        }
+    }
+
+    stopwatch_overhead = statistics.median;
+    calibration->overhead = statistics.median;
+    calibration->resolution = (double)smallest_step / frequency * 1000.0;
+}
+
+void vkstats_stopwatch_init(vkstats_stopwatch* stopwatch)
+{
     clear_struct(stopwatch);
-    QueryPerformanceFrequency(&frequency);
-    stopwatch->frequency = (double)frequency.QuadPart;
+    stopwatch->frequency = vkstats_stopwatch_get_frequency();
+    stopwatch->overhead = stopwatch_overhead;
 }
 
 void vkstats_stopwatch_start(vkstats_stopwatch* stopwatch)
 {
-    LARGE_INTEGER now;
-
-    QueryPerformanceCounter(&now);
-    stopwatch->start_time = now.QuadPart;
+    stopwatch->start_time = vkstats_stopwatch_get_ticks();
 }
 
 double vkstats_stopwatch_stop(vkstats_stopwatch* stopwatch)
 {
-    LARGE_INTEGER now;
+    uint64_t now = vkstats_stopwatch_get_ticks();
+    double elapsed = (double)(now - stopwatch->start_time) / stopwatch->frequency * 1000.0;
 
-    QueryPerformanceCounter(&now);
-    return (double)(now.QuadPart - stopwatch->start_time) / stopwatch->frequency * 1000.0;
+    return elapsed > stopwatch->overhead ? elapsed - stopwatch->overhead : 0.0;
 }
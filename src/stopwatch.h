@@ -7,8 +7,27 @@ typedef struct
 {
     uint64_t    start_time;
     double      frequency;
+    double      overhead;
 } vkstats_stopwatch;
 
+typedef struct
+{
+    double      overhead;
+    double      resolution;
+} vkstats_stopwatch_calibration;
+
+/*
+* vkstats_stopwatch_calibrate()
+* 
+* Measures the cost of starting and stopping a stopwatch and the smallest
+* interval it can resolve. The overhead is subtracted from every stopwatch
+* initialized afterwards, so this should be called once at startup.
+* 
+* calibration: the measured overhead and resolution, in milliseconds, will be
+*              placed here.
+*/
+void vkstats_stopwatch_calibrate(vkstats_stopwatch_calibration* calibration);
+
 /*
 * vkstats_stopwatch_init()
 * 
@@ -39,4 +58,23 @@ void vkstats_stopwatch_start(vkstats_stopwatch* stopwatch);
 */
 double vkstats_stopwatch_stop(vkstats_stopwatch* stopwatch);
 
+/*
+* vkstats_stopwatch_get_ticks()
+*
+* Reads the monotonic clock the stopwatch is built on. Implemented by the
+* platform backend.
+*
+* Returns the current time in ticks.
+*/
+uint64_t vkstats_stopwatch_get_ticks(void);
+
+/*
+* vkstats_stopwatch_get_frequency()
+*
+* Implemented by the platform backend.
+*
+* Returns the number of ticks per second.
+*/
+double vkstats_stopwatch_get_frequency(void);
+
 #endif
@@ -0,0 +1,20 @@
+#include <time.h>
+
+#include "stopwatch.h"
+
+uint64_t vkstats_stopwatch_get_ticks(void)
+{
+    struct timespec now;
+
+    /*
+    * CLOCK_MONOTONIC_RAW isn't slewed by NTP, so short intervals aren't
+    * stretched or squeezed while the clock is being adjusted.
+    */
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    return (uint64_t)now.tv_sec * UINT64_C(1000000000) + (uint64_t)now.tv_nsec;
+}
+
+double vkstats_stopwatch_get_frequency(void)
+{
+    return 1000000000.0;
+}
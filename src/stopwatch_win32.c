@@ -0,0 +1,19 @@
+#include "Windows.h"
+
+#include "stopwatch.h"
+
+uint64_t vkstats_stopwatch_get_ticks(void)
+{
+    LARGE_INTEGER now;
+
+    QueryPerformanceCounter(&now);
+    return (uint64_t)now.QuadPart;
+}
+
+double vkstats_stopwatch_get_frequency(void)
+{
+    LARGE_INTEGER frequency;
+
+    QueryPerformanceFrequency(&frequency);
+    return (double)frequency.QuadPart;
+}
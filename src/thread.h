@@ -0,0 +1,161 @@
+#if !defined(VKSTATS_THREAD_H)
+#define VKSTATS_THREAD_H
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#include "Windows.h"
+#else
+#include <pthread.h>
+#endif
+
+/*
+* vkstats_thread_function
+*
+* Entry point of a thread.
+*
+* context: the context passed to vkstats_thread_create().
+*/
+typedef void (*vkstats_thread_function)(void* context);
+
+typedef struct
+{
+#if defined(_WIN32)
+    HANDLE                      handle;
+#else
+    pthread_t                   handle;
+#endif
+    vkstats_thread_function     function;
+    void*                       context;
+} vkstats_thread;
+
+typedef struct
+{
+#if defined(_WIN32)
+    SYNCHRONIZATION_BARRIER     barrier;
+#else
+    pthread_barrier_t           barrier;
+#endif
+} vkstats_barrier;
+
+typedef struct
+{
+#if defined(_WIN32)
+    CRITICAL_SECTION            section;
+#else
+    pthread_mutex_t             mutex;
+#endif
+} vkstats_mutex;
+
+/*
+* vkstats_thread_create()
+*
+* Starts a thread.
+*
+* thread: the thread to start. Must stay valid until it is joined.
+* function: the function to run on the thread.
+* context: passed to the function.
+*/
+void vkstats_thread_create(vkstats_thread* thread, vkstats_thread_function function, void* context);
+
+/*
+* vkstats_thread_join()
+*
+* Waits for a thread to finish.
+*
+* thread: the thread to wait for.
+*/
+void vkstats_thread_join(vkstats_thread* thread);
+
+/*
+* vkstats_barrier_init()
+*
+* Initialize a barrier.
+*
+* barrier: the barrier to initialize.
+* count: the number of threads that must reach the barrier before any of them
+*        continue.
+*/
+void vkstats_barrier_init(vkstats_barrier* barrier, uint32_t count);
+
+/*
+* vkstats_barrier_wait()
+*
+* Blocks until all threads have reached the barrier.
+*
+* barrier: the barrier to wait on.
+*/
+void vkstats_barrier_wait(vkstats_barrier* barrier);
+
+/*
+* vkstats_barrier_destroy()
+*
+* Destroys a barrier.
+*
+* barrier: the barrier to destroy.
+*/
+void vkstats_barrier_destroy(vkstats_barrier* barrier);
+
+/*
+* vkstats_mutex_init()
+*
+* Initialize a mutex.
+*
+* mutex: the mutex to initialize.
+*/
+void vkstats_mutex_init(vkstats_mutex* mutex);
+
+/*
+* vkstats_mutex_lock()
+*
+* Locks a mutex.
+*
+* mutex: the mutex to lock.
+*/
+void vkstats_mutex_lock(vkstats_mutex* mutex);
+
+/*
+* vkstats_mutex_unlock()
+*
+* Unlocks a mutex.
+*
+* mutex: the mutex to unlock.
+*/
+void vkstats_mutex_unlock(vkstats_mutex* mutex);
+
+/*
+* vkstats_mutex_destroy()
+*
+* Destroys a mutex.
+*
+* mutex: the mutex to destroy.
+*/
+void vkstats_mutex_destroy(vkstats_mutex* mutex);
+
+/*
+* vkstats_get_cpu_count()
+*
+* Returns the number of logical CPUs available to the process.
+*/
+uint32_t vkstats_get_cpu_count(void);
+
+/*
+* vkstats_get_thread_id()
+*
+* Returns an operating system identifier for the calling thread. Cheap
+* enough to call while measuring.
+*/
+uint64_t vkstats_get_thread_id(void);
+
+/*
+* vkstats_atomic_increment()
+*
+* Atomically increments a counter shared between threads.
+*
+* value: the counter to increment.
+*
+* Returns the incremented value.
+*/
+uint64_t vkstats_atomic_increment(volatile uint64_t* value);
+
+#endif
@@ -0,0 +1,114 @@
+#include <pthread.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#include "thread.h"
+#include "util.h"
+
+/*
+* Looking the id up is a system call on Linux, and the trace asks for it on
+* every event, so each thread keeps its own after the first lookup.
+*/
+static _Thread_local uint64_t thread_id = 0;
+
+static void* thread_entry(void* parameter);
+
+void vkstats_thread_create(vkstats_thread* thread, vkstats_thread_function function, void* context)
+{
+    thread->function = function;
+    thread->context = context;
+
+    if (pthread_create(&thread->handle, NULL, thread_entry, thread) != 0)
+    {
+        fatal_error("Could not create thread!");
+    }
+}
+
+void vkstats_thread_join(vkstats_thread* thread)
+{
+    pthread_join(thread->handle, NULL);
+}
+
+void vkstats_barrier_init(vkstats_barrier* barrier, uint32_t count)
+{
+    if (pthread_barrier_init(&barrier->barrier, NULL, count) != 0)
+    {
+        fatal_error("Could not create barrier!");
+    }
+}
+
+void vkstats_barrier_wait(vkstats_barrier* barrier)
+{
+    pthread_barrier_wait(&barrier->barrier);
+}
+
+void vkstats_barrier_destroy(vkstats_barrier* barrier)
+{
+    pthread_barrier_destroy(&barrier->barrier);
+}
+
+void vkstats_mutex_init(vkstats_mutex* mutex)
+{
+    pthread_mutex_init(&mutex->mutex, NULL);
+}
+
+void vkstats_mutex_lock(vkstats_mutex* mutex)
+{
+    pthread_mutex_lock(&mutex->mutex);
+}
+
+void vkstats_mutex_unlock(vkstats_mutex* mutex)
+{
+    pthread_mutex_unlock(&mutex->mutex);
+}
+
+void vkstats_mutex_destroy(vkstats_mutex* mutex)
+{
+    pthread_mutex_destroy(&mutex->mutex);
+}
+
+uint32_t vkstats_get_cpu_count(void)
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return count > 0 ? (uint32_t)count : 1;
+}
+
+uint64_t vkstats_get_thread_id(void)
+{
+    if (thread_id == 0)
+    {
+#if defined(__linux__)
+        thread_id = (uint64_t)syscall(SYS_gettid);
+#else
+        thread_id = (uint64_t)(uintptr_t)pthread_self();
+#endif
+    }
+
+    return thread_id;
+}
+
+uint64_t vkstats_atomic_increment(volatile uint64_t* value)
+{
+    return __atomic_add_fetch(value, 1, __ATOMIC_RELAXED);
+}
+
+/*
+* thread_entry()
+*
+* Adapts a vkstats_thread_function to the pthreads signature.
+*
+* parameter: the vkstats_thread being started.
+*
+* Returns NULL.
+*/
+static void* thread_entry(void* parameter)
+{
+    vkstats_thread* thread = parameter;
+
+    thread->function(thread->context);
+    return NULL;
+}
@@ -0,0 +1,97 @@
+#include "Windows.h"
+
+#include "thread.h"
+#include "util.h"
+
+static DWORD WINAPI thread_entry(LPVOID parameter);
+
+void vkstats_thread_create(vkstats_thread* thread, vkstats_thread_function function, void* context)
+{
+    thread->function = function;
+    thread->context = context;
+    thread->handle = CreateThread(NULL, 0, thread_entry, thread, 0, NULL);
+
+    if (thread->handle == NULL)
+    {
+        fatal_error("Could not create thread!");
+    }
+}
+
+void vkstats_thread_join(vkstats_thread* thread)
+{
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+}
+
+void vkstats_barrier_init(vkstats_barrier* barrier, uint32_t count)
+{
+    if (!InitializeSynchronizationBarrier(&barrier->barrier, (LONG)count, -1))
+    {
+        fatal_error("Could not create barrier!");
+    }
+}
+
+void vkstats_barrier_wait(vkstats_barrier* barrier)
+{
+    EnterSynchronizationBarrier(&barrier->barrier, 0);
+}
+
+void vkstats_barrier_destroy(vkstats_barrier* barrier)
+{
+    DeleteSynchronizationBarrier(&barrier->barrier);
+}
+
+void vkstats_mutex_init(vkstats_mutex* mutex)
+{
+    InitializeCriticalSection(&mutex->section);
+}
+
+void vkstats_mutex_lock(vkstats_mutex* mutex)
+{
+    EnterCriticalSection(&mutex->section);
+}
+
+void vkstats_mutex_unlock(vkstats_mutex* mutex)
+{
+    LeaveCriticalSection(&mutex->section);
+}
+
+void vkstats_mutex_destroy(vkstats_mutex* mutex)
+{
+    DeleteCriticalSection(&mutex->section);
+}
+
+uint32_t vkstats_get_cpu_count(void)
+{
+    SYSTEM_INFO system_info;
+
+    GetSystemInfo(&system_info);
+    return system_info.dwNumberOfProcessors;
+}
+
+uint64_t vkstats_get_thread_id(void)
+{
+    return GetCurrentThreadId();
+}
+
+uint64_t vkstats_atomic_increment(volatile uint64_t* value)
+{
+    return (uint64_t)InterlockedIncrement64((volatile LONG64*)value);
+}
+
+/*
+* thread_entry()
+*
+* Adapts a vkstats_thread_function to the Win32 thread signature.
+*
+* parameter: the vkstats_thread being started.
+*
+* Returns zero.
+*/
+static DWORD WINAPI thread_entry(LPVOID parameter)
+{
+    vkstats_thread* thread = parameter;
+
+    thread->function(thread->context);
+    return 0;
+}
@@ -0,0 +1,190 @@
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "vulkan/vulkan.h"
+
+#include "stopwatch.h"
+#include "thread.h"
+#include "trace.h"
+#include "util.h"
+
+/*
+* The most queues given their own track in the trace. Any more share the
+* last one.
+*/
+#define MAX_TRACE_QUEUES 32
+
+#define TRACE_HOST_PID 1
+#define TRACE_QUEUE_PID 2
+
+static vkstats_trace_event* trace_events = NULL;
+static uint32_t trace_capacity = 0;
+static volatile uint64_t trace_count = 0;
+
+static void record_event(const char* category, const char* name, double start_ticks, double end_ticks, uint64_t value, uint64_t track, VkBool32 queue);
+
+void vkstats_trace_init(uint32_t capacity)
+{
+    if (capacity == 0)
+    {
+        fatal_error("Trace capacity must not be zero!");
+    }
+
+    trace_events = calloc(capacity, sizeof(trace_events[0]));
+
+    if (trace_events == NULL)
+    {
+        fatal_error("Could not allocate trace events!");
+    }
+
+    trace_capacity = capacity;
+    trace_count = 0;
+}
+
+void vkstats_trace_destroy(void)
+{
+    free(trace_events);
+    trace_events = NULL;
+    trace_capacity = 0;
+}
+
+VkBool32 vkstats_trace_is_enabled(void)
+{
+    return trace_events != NULL;
+}
+
+void vkstats_trace_host_event(const char* category, const char* name, uint64_t start_ticks, uint64_t end_ticks, uint64_t value)
+{
+    if (trace_events == NULL)
+    {
+        return;
+    }
+
+    record_event(category, name, (double)start_ticks, (double)end_ticks, value, vkstats_get_thread_id(), VK_FALSE);
+}
+
+void vkstats_trace_queue_event(const char* name, VkQueue queue, double start_ticks, double end_ticks, uint64_t value)
+{
+    if (trace_events == NULL)
+    {
+        return;
+    }
+
+    record_event("queue", name, start_ticks, end_ticks, value, (uint64_t)(uintptr_t)queue, VK_TRUE);
+}
+
+void vkstats_trace_write(const char* path)
+{
+    FILE* file;
+    uint64_t count = trace_count;
+    uint64_t first = count > trace_capacity ? count - trace_capacity : 0;
+    uint64_t queues[MAX_TRACE_QUEUES];
+    uint32_t queue_count = 0;
+    double frequency = vkstats_stopwatch_get_frequency();
+    double origin = 0.0;
+
+    if (trace_events == NULL)
+    {
+        return;
+    }
+
+    file = fopen(path, "w");
+
+    if (file == NULL)
+    {
+        fatal_error("Could not open trace file!");
+    }
+
+    /*
+    * Timestamps are written in microseconds from the earliest event.
+    */
+    for (uint64_t i = first; i < count; i++)
+    {
+        double start_ticks = trace_events[i % trace_capacity].start_ticks;
+
+        if (i == first || start_ticks < origin)
+        {
+            origin = start_ticks;
+        }
+    }
+
+    fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"Host\"}},\n", TRACE_HOST_PID);
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"Queues\"}}", TRACE_QUEUE_PID);
+
+    for (uint64_t i = first; i < count; i++)
+    {
+        const vkstats_trace_event* event = &trace_events[i % trace_capacity];
+        uint64_t tid = event->track;
+        int pid = TRACE_HOST_PID;
+
+        /*
+        * Queue handles are replaced by small track numbers, named the first
+        * time they're seen.
+        */
+        if (event->queue)
+        {
+            uint32_t j;
+
+            for (j = 0; j < queue_count; j++)
+            {
+                if (queues[j] == event->track)
+                {
+                    break;
+                }
+            }
+
+            if (j == queue_count && queue_count < MAX_TRACE_QUEUES)
+            {
+                queues[queue_count] = event->track;
+                queue_count++;
+                fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"Queue %u\"}}", TRACE_QUEUE_PID, j, j);
+            }
+
+            pid = TRACE_QUEUE_PID;
+            tid = j < queue_count ? j : MAX_TRACE_QUEUES - 1;
+        }
+
+        fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%" PRIu64 ",\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"value\":%" PRIu64 "}}",
+            event->name,
+            event->category,
+            pid,
+            tid,
+            (event->start_ticks - origin) / frequency * 1000000.0,
+            (event->end_ticks - event->start_ticks) / frequency * 1000000.0,
+            event->value);
+    }
+
+    fprintf(file, "\n]}\n");
+    fclose(file);
+
+    printf("Wrote %" PRIu64 " trace events to %s (%" PRIu64 " overwritten).\n", count - first, path, first);
+}
+
+/*
+* record_event()
+*
+* Claims the next slot in the ring buffer and fills it in.
+*
+* category: the event's category.
+* name: the event's name.
+* start_ticks: stopwatch ticks when the span started.
+* end_ticks: stopwatch ticks when the span ended.
+* value: a number attached to the event.
+* track: the thread id, or queue handle, the event happened on.
+* queue: whether the track is a queue.
+*/
+static void record_event(const char* category, const char* name, double start_ticks, double end_ticks, uint64_t value, uint64_t track, VkBool32 queue)
+{
+    uint64_t index = vkstats_atomic_increment(&trace_count) - 1;
+    vkstats_trace_event* event = &trace_events[index % trace_capacity];
+
+    event->category = category;
+    event->name = name;
+    event->start_ticks = start_ticks;
+    event->end_ticks = end_ticks;
+    event->value = value;
+    event->track = track;
+    event->queue = queue;
+}
@@ -0,0 +1,91 @@
+#if !defined(VKSTATS_TRACE_H)
+#define VKSTATS_TRACE_H
+
+#include <stdint.h>
+
+#include "vulkan/vulkan.h"
+
+/*
+* The trace records spans of time into a ring buffer preallocated by
+* vkstats_trace_init(). Recording an event is an atomic increment and a
+* store, so it can stay on while measuring. When the buffer fills, the
+* oldest events are overwritten. Until vkstats_trace_init() is called,
+* recording does nothing.
+*/
+
+typedef struct
+{
+    const char*     category;
+    const char*     name;
+    double          start_ticks;
+    double          end_ticks;
+    uint64_t        value;
+    uint64_t        track;
+    VkBool32        queue;
+} vkstats_trace_event;
+
+/*
+* vkstats_trace_init()
+*
+* Allocates the ring buffer and starts recording.
+*
+* capacity: the number of events the ring buffer holds.
+*/
+void vkstats_trace_init(uint32_t capacity);
+
+/*
+* vkstats_trace_destroy()
+*
+* Stops recording and frees the ring buffer.
+*/
+void vkstats_trace_destroy(void);
+
+/*
+* vkstats_trace_is_enabled()
+*
+* Returns VK_TRUE if events are being recorded, for callers that need extra
+* work to produce an event.
+*/
+VkBool32 vkstats_trace_is_enabled(void);
+
+/*
+* vkstats_trace_host_event()
+*
+* Records a span of time on the calling thread.
+*
+* category: groups related events, such as "submit" or "wait". Must be a
+*           string literal or otherwise outlive the trace.
+* name: what happened. Must outlive the trace as well.
+* start_ticks: stopwatch ticks when the span started.
+* end_ticks: stopwatch ticks when the span ended.
+* value: a number to attach to the event, such as a size in bytes.
+*/
+void vkstats_trace_host_event(const char* category, const char* name, uint64_t start_ticks, uint64_t end_ticks, uint64_t value);
+
+/*
+* vkstats_trace_queue_event()
+*
+* Records a span of time on a queue, measured with device timestamps and
+* converted to stopwatch ticks with a calibration.
+*
+* name: what happened. Must be a string literal or otherwise outlive the
+*       trace.
+* queue: the queue the work ran on.
+* start_ticks: stopwatch ticks when the work started.
+* end_ticks: stopwatch ticks when the work ended.
+* value: a number to attach to the event, such as a size in bytes.
+*/
+void vkstats_trace_queue_event(const char* name, VkQueue queue, double start_ticks, double end_ticks, uint64_t value);
+
+/*
+* vkstats_trace_write()
+*
+* Writes the recorded events in the Chrome Trace Event JSON format, which
+* Perfetto and chrome://tracing can load. Host threads and queues each get
+* their own track. Must not be called while events are being recorded.
+*
+* path: the file to write.
+*/
+void vkstats_trace_write(const char* path);
+
+#endif
\ No newline at end of file
@@ -56,6 +56,21 @@ static void check_result(VkResult result, const char* message)
     }
 }
 
+/*
+* align_up()
+*
+* Rounds a value up to a multiple of an alignment.
+*
+* value: the value to round.
+* alignment: the alignment. Must be non-zero.
+*
+* Returns the aligned value.
+*/
+static VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
 /*
 * count_flags()
 *